@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \defgroup glossy-rounds Round-based scheduling of Glossy floods
+ *
+ *           This application runs Glossy in rounds of contiguous floods with different initiators,
+ *           similarly to the Low-power Wireless Bus (LWB).
+ *
+ *           Each round begins with a flood of the schedule (\link glossy_schedule_struct \endlink)
+ *           by the host, the node having nodeId \link HOST_NODE_ID \endlink. The schedule flood
+ *           provides time synchronization; it is the only one with the sync flag set.
+ *
+ *           The schedule assigns each of the following data slots to an initiator. The host assigns
+ *           the slots round-robin to the nodes with nodeIds from 1 to \link ROUNDS_N_NODES \endlink.
+ *           Data slot i begins \link SLOT_OFFSET \endlink(i) after the reference time of the round,
+ *           hence receivers can use the same, short guard-time \link SLOT_GUARD_TIME \endlink for all slots.
+ *
+ *           A receiver that misses the schedule does not take part in the data slots of the round.
+ *           After \link ROUND_MAX_MISSED \endlink consecutive misses it listens for the schedule
+ *           for \link ROUND_INIT_DURATION \endlink every \link ROUND_INIT_PERIOD \endlink,
+ *           as at startup.
+ *
+ * @{
+ */
+
+/**
+ * \file
+ *         An application that runs rounds of Glossy floods, source file.
+ */
+
+#include "glossy-rounds.h"
+
+/**
+ * \defgroup glossy-rounds-variables Application variables
+ * @{
+ */
+
+static glossy_schedule_struct schedule;    /**< \brief Schedule of the current round. */
+static glossy_rounds_data_struct glossy_data; /**< \brief Data of the current slot. */
+static struct rtimer rt;                   /**< \brief Rtimer used to schedule Glossy. */
+static struct pt pt;                       /**< \brief Protothread used to schedule Glossy. */
+static rtimer_clock_t t_round = 0;         /**< \brief Starting time (low-frequency clock)
+                                                of the current round. */
+static uint8_t synced = 0;                 /**< \brief Not zero if the node knows when rounds begin. */
+static uint8_t sync_missed = 0;            /**< \brief Current number of consecutive rounds without
+                                                schedule. */
+static uint8_t slot_idx;                   /**< \brief Index of the current data slot. */
+static unsigned long seq_no = 0;           /**< \brief Sequence number of the data of this node. */
+
+static uint8_t slots_received;             /**< \brief Data slots received in the last round. */
+static uint8_t slots_expected;             /**< \brief Data slots of other nodes in the last round. */
+static unsigned long slots_received_total = 0; /**< \brief Data slots received since startup. */
+static unsigned long slots_expected_total = 0; /**< \brief Data slots of other nodes since startup. */
+static unsigned long schedules_missed = 0; /**< \brief Schedules missed since startup. */
+
+/** @} */
+
+/**
+ * \defgroup glossy-rounds-processes Application processes and functions
+ * @{
+ */
+
+PROCESS(glossy_print_stats_process, "Glossy print stats");
+PROCESS_THREAD(glossy_print_stats_process, ev, data)
+{
+	PROCESS_BEGIN();
+
+	while(1) {
+		PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+		if (!synced) {
+			printf("Waiting for the schedule\n");
+			continue;
+		}
+		if (sync_missed) {
+			printf("Round: schedule NOT received (%u in a row)\n", sync_missed);
+		} else {
+			printf("Round %u: %u slots, received %u out of %u\n",
+					schedule.round_no, schedule.n_slots, slots_received, slots_expected);
+		}
+		if (slots_expected_total) {
+			// Compute current average reliability over the data slots of the other nodes.
+			unsigned long avg_rel = slots_received_total * 1e5 / slots_expected_total;
+			printf("average reliability %3lu.%03lu %% (missed %lu out of %lu slots, %lu schedules)\n",
+					avg_rel / 1000, avg_rel % 1000, slots_expected_total - slots_received_total,
+					slots_expected_total, schedules_missed);
+		}
+	}
+
+	PROCESS_END();
+}
+
+static inline void compute_schedule(void) {
+	uint8_t i;
+	schedule.round_no++;
+	schedule.n_slots = (ROUNDS_N_NODES < ROUNDS_MAX_SLOTS) ? ROUNDS_N_NODES : ROUNDS_MAX_SLOTS;
+	// Assign the slots round-robin, starting where the last round stopped.
+	for (i = 0; i < schedule.n_slots; i++) {
+		schedule.slot[i] = 1 + ((unsigned long)schedule.round_no * schedule.n_slots + i) % ROUNDS_N_NODES;
+	}
+}
+
+/**
+ * \defgroup glossy-rounds-scheduler Round scheduling
+ * @{
+ */
+
+char glossy_scheduler(struct rtimer *t, void *ptr) {
+	PT_BEGIN(&pt);
+
+	while (1) {
+		// Schedule flood.
+		leds_on(LEDS_BLUE);
+		if (IS_HOST()) {
+			compute_schedule();
+			t_round = RTIMER_TIME(t);
+			// Start Glossy.
+			glossy_start((uint8_t *)&schedule, SCHEDULE_LEN(schedule.n_slots), GLOSSY_INITIATOR, GLOSSY_SYNC,
+					N_TX, HEADER_SCHEDULE, t_round + SCHEDULE_DURATION,
+					(rtimer_callback_t)glossy_scheduler, t, ptr, node_id);
+		} else {
+			// The length of the schedule is not known in advance.
+			glossy_start((uint8_t *)&schedule, 0, GLOSSY_RECEIVER, GLOSSY_SYNC,
+					N_TX, HEADER_SCHEDULE, RTIMER_TIME(t) + ((synced) ?
+							ROUND_GUARD_TIME * (1 + sync_missed) + SCHEDULE_DURATION : ROUND_INIT_DURATION),
+					(rtimer_callback_t)glossy_scheduler, t, ptr, node_id);
+		}
+		// Yield the protothread. It will be resumed when Glossy terminates.
+		PT_YIELD(&pt);
+
+		leds_off(LEDS_BLUE);
+		// Stop Glossy.
+		glossy_stop();
+		slots_received = 0;
+		slots_expected = 0;
+		if (!IS_HOST()) {
+			if (is_t_ref_l_updated()) {
+				// The schedule has been received: the round begins at the reference time.
+				t_round = get_t_ref_l();
+				synced = 1;
+				sync_missed = 0;
+			} else {
+				if (synced) {
+					schedules_missed++;
+					if (++sync_missed > ROUND_MAX_MISSED) {
+						// Too many schedules missed: listen for it again as at startup.
+						synced = 0;
+					} else {
+						// Skip the data slots of this round.
+						t_round += ROUND_PERIOD;
+						rtimer_set(t, t_round - ROUND_GUARD_TIME * (1 + sync_missed), 1,
+								(rtimer_callback_t)glossy_scheduler, ptr);
+						process_poll(&glossy_print_stats_process);
+						PT_YIELD(&pt);
+						continue;
+					}
+				}
+				if (!synced) {
+					// Listen for the schedule again later.
+					rtimer_set(t, RTIMER_TIME(t) + ROUND_INIT_PERIOD, 1,
+							(rtimer_callback_t)glossy_scheduler, ptr);
+					process_poll(&glossy_print_stats_process);
+					PT_YIELD(&pt);
+					continue;
+				}
+			}
+		}
+
+		// Data slots, all aligned to the beginning of the round.
+		for (slot_idx = 0; slot_idx < schedule.n_slots; slot_idx++) {
+			if (schedule.slot[slot_idx] == (uint8_t)node_id) {
+				// Initiator of the slot: start exactly at the beginning of the slot.
+				rtimer_set(t, t_round + SLOT_OFFSET(slot_idx), 1,
+						(rtimer_callback_t)glossy_scheduler, ptr);
+				PT_YIELD(&pt);
+				leds_on(LEDS_GREEN);
+				glossy_data.node_id = node_id;
+				glossy_data.round_no = schedule.round_no;
+				glossy_data.seq_no = ++seq_no;
+				glossy_start((uint8_t *)&glossy_data, DATA_LEN, GLOSSY_INITIATOR, GLOSSY_NO_SYNC,
+						N_TX, HEADER_DATA, t_round + SLOT_OFFSET(slot_idx) + SLOT_DURATION,
+						(rtimer_callback_t)glossy_scheduler, t, ptr, node_id);
+				PT_YIELD(&pt);
+				glossy_stop();
+			} else {
+				// Receiver: start a guard-time before the beginning of the slot.
+				rtimer_set(t, t_round + SLOT_OFFSET(slot_idx) - SLOT_GUARD_TIME, 1,
+						(rtimer_callback_t)glossy_scheduler, ptr);
+				PT_YIELD(&pt);
+				leds_on(LEDS_GREEN);
+				glossy_start((uint8_t *)&glossy_data, DATA_LEN, GLOSSY_RECEIVER, GLOSSY_NO_SYNC,
+						N_TX, HEADER_DATA, t_round + SLOT_OFFSET(slot_idx) + SLOT_DURATION,
+						(rtimer_callback_t)glossy_scheduler, t, ptr, node_id);
+				PT_YIELD(&pt);
+				slots_expected++;
+				if ((glossy_stop()) && (glossy_data.round_no == schedule.round_no) &&
+						((uint8_t)glossy_data.node_id == schedule.slot[slot_idx])) {
+					slots_received++;
+				}
+			}
+			leds_off(LEDS_GREEN);
+		}
+		slots_received_total += slots_received;
+		slots_expected_total += slots_expected;
+
+		// Schedule the beginning of the next round.
+		t_round += ROUND_PERIOD;
+		rtimer_set(t, (IS_HOST()) ? t_round : t_round - ROUND_GUARD_TIME, 1,
+				(rtimer_callback_t)glossy_scheduler, ptr);
+		// Poll the process that prints statistics (will be activated later by Contiki).
+		process_poll(&glossy_print_stats_process);
+		// Yield the protothread.
+		PT_YIELD(&pt);
+	}
+
+	PT_END(&pt);
+}
+
+/** @} */
+
+/**
+ * \defgroup glossy-rounds-init Initialization
+ * @{
+ */
+
+PROCESS(glossy_rounds, "Glossy rounds");
+AUTOSTART_PROCESSES(&glossy_rounds);
+PROCESS_THREAD(glossy_rounds, ev, data)
+{
+	PROCESS_BEGIN();
+
+	// Start print stats processes.
+	process_start(&glossy_print_stats_process, NULL);
+	// Start Glossy busy-waiting process.
+	process_start(&glossy_process, NULL);
+	// Start the first round in one second.
+	rtimer_set(&rt, RTIMER_NOW() + RTIMER_SECOND, 1, (rtimer_callback_t)glossy_scheduler, NULL);
+
+	PROCESS_END();
+}
+
+/** @} */
+/** @} */
+/** @} */
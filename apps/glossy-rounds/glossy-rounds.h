@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \defgroup glossy-rounds Round-based scheduling of Glossy floods
+ * @{
+ */
+
+/**
+ * \file
+ *         An application that runs rounds of Glossy floods, header file.
+ *
+ *         At the beginning of each round the host floods a schedule,
+ *         which also synchronizes the nodes. The schedule assigns the
+ *         following data slots to initiators; all the slots of a round
+ *         are aligned to the reference time of the schedule flood.
+ *         The period of the rounds is \link ROUND_PERIOD \endlink.
+ */
+
+#ifndef GLOSSY_ROUNDS_H_
+#define GLOSSY_ROUNDS_H_
+
+#include <stddef.h>
+
+#include "glossy.h"
+#include "node-id.h"
+
+/**
+ * \defgroup glossy-rounds-settings Application settings
+ * @{
+ */
+
+/**
+ * \brief NodeId of the host, which computes and floods the schedule.
+ *        Default value: 1
+ */
+#define HOST_NODE_ID            1
+
+/**
+ * \brief Number of nodes the host assigns data slots to (nodeIds from 1 to ROUNDS_N_NODES).
+ *        Default value: 30
+ */
+#define ROUNDS_N_NODES          30
+
+/**
+ * \brief Maximum number of data slots per round.
+ *        Default value: 30
+ */
+#define ROUNDS_MAX_SLOTS        30
+
+/**
+ * \brief Application-specific header of schedule and data floods.
+ */
+#define HEADER_SCHEDULE         0x1
+#define HEADER_DATA             0x2
+
+/**
+ * \brief Maximum number of transmissions N.
+ *        Default value: 3.
+ */
+#define N_TX                    3
+
+/**
+ * \brief Period of the rounds.
+ *        It must be shorter than the wrap-around time of the low-frequency clock (2 s).
+ *        Default value: 1 s.
+ */
+#define ROUND_PERIOD            (RTIMER_SECOND)          // 1 s
+
+/**
+ * \brief Duration of the schedule flood.
+ *        Default value: 20 ms.
+ */
+#define SCHEDULE_DURATION       (RTIMER_SECOND / 50)     // 20 ms
+
+/**
+ * \brief Duration of each data slot.
+ *        Default value: 10 ms.
+ */
+#define SLOT_DURATION           (RTIMER_SECOND / 100)    // 10 ms
+
+/**
+ * \brief Gap between consecutive slots, to process the last flood and prepare the next one.
+ *        Default value: 2 ms.
+ */
+#define SLOT_GAP                (RTIMER_SECOND / 500)    //  2 ms
+
+/**
+ * \brief Guard-time at receivers before each data slot.
+ *        All the slots of a round refer to the same reference time, hence the guard-time
+ *        does not grow with the index of the slot (drift within a round is a few tens of us).
+ *        Default value: 244 us.
+ */
+#define SLOT_GUARD_TIME         (RTIMER_SECOND / 4096)   // 244 us
+
+/**
+ * \brief Guard-time at receivers before the schedule flood.
+ *        Default value: 526 us.
+ */
+#if COOJA
+#define ROUND_GUARD_TIME        (RTIMER_SECOND / 1000)
+#else
+#define ROUND_GUARD_TIME        (RTIMER_SECOND / 1900)   // 526 us
+#endif /* COOJA */
+
+/**
+ * \brief Period with which unsynchronized receivers listen for the schedule.
+ *        It should not be an exact fraction of \link ROUND_PERIOD \endlink.
+ *        Default value: 1.2 s.
+ */
+#define ROUND_INIT_PERIOD       (ROUND_INIT_DURATION + RTIMER_SECOND / 5)
+
+/**
+ * \brief Duration during which unsynchronized receivers listen for the schedule.
+ *        Default value: 1 s.
+ */
+#define ROUND_INIT_DURATION     (RTIMER_SECOND)
+
+/**
+ * \brief Number of consecutive schedules a receiver may miss before it goes back to listening
+ *        for the schedule with \link ROUND_INIT_DURATION \endlink.
+ *        Default value: 3.
+ */
+#define ROUND_MAX_MISSED        3
+
+/**
+ * \brief Schedule flooded by the host at the beginning of each round.
+ */
+typedef struct {
+	unsigned short round_no;           /**< Round number, incremented by the host at each round. */
+	uint8_t n_slots;                   /**< Number of data slots in the round. */
+	uint8_t slot[ROUNDS_MAX_SLOTS];    /**< NodeId (truncated to one byte) of the initiator of each slot. */
+} glossy_schedule_struct;
+
+/**
+ * \brief Data flooded in a data slot.
+ */
+typedef struct {
+	unsigned short node_id;            /**< NodeId of the initiator. */
+	unsigned short round_no;           /**< Round number. */
+	unsigned long seq_no;              /**< Sequence number, incremented by the initiator at each of its slots. */
+} glossy_rounds_data_struct;
+
+/** @} */
+
+/**
+ * \defgroup glossy-rounds-defines Application internal defines
+ * @{
+ */
+
+/**
+ * \brief Length of the schedule with n data slots.
+ */
+#define SCHEDULE_LEN(n)             (offsetof(glossy_schedule_struct, slot) + (n))
+
+/**
+ * \brief Length of data structure.
+ */
+#define DATA_LEN                    sizeof(glossy_rounds_data_struct)
+
+/**
+ * \brief Check if the nodeId matches the one of the host.
+ */
+#define IS_HOST()                   (node_id == HOST_NODE_ID)
+
+/**
+ * \brief Offset of data slot i from the beginning of the round, in ticks of the low-frequency clock.
+ */
+#define SLOT_OFFSET(i)              (SCHEDULE_DURATION + SLOT_GAP + (rtimer_clock_t)(i) * (SLOT_DURATION + SLOT_GAP))
+
+#if (SCHEDULE_DURATION + SLOT_GAP + ROUNDS_MAX_SLOTS * (SLOT_DURATION + SLOT_GAP)) > ROUND_PERIOD
+#error "The data slots do not fit in a round: decrease ROUNDS_MAX_SLOTS or the slot duration"
+#endif
+
+/** @} */
+
+/** @} */
+
+#endif /* GLOSSY_ROUNDS_H_ */
@@ -81,6 +81,30 @@
  *           Receivers exit the bootstrapping phase when they have computed the reference time for
  *           \link GLOSSY_BOOTSTRAP_PERIODS \endlink consecutive Glossy phases.
  *
+ *           With \link SKEW_REGRESSION \endlink, receivers fit a line through their last reference
+ *           times to estimate the clock skew, and set their guard-time according to how well the
+ *           reference times fit the line.
+ *
+ *           With \link SYNC_CHECKPOINT \endlink, receivers periodically store the slot length, the clock
+ *           skew and their hop distance in the external flash. After a reboot, they restore them and
+ *           exit the bootstrapping phase as soon as they compute the reference time once.
+ *
+ *           With \link CHANNEL_HOPPING \endlink, each Glossy phase runs on a channel derived from
+ *           the sequence number; receivers that have not received any packet yet wait on a fixed channel.
+ *           The initiator distributes the channel blacklist in the packet.
+ *
+ *           With \link ADAPTIVE_N_TX \endlink, receivers adapt their maximum number of transmissions
+ *           to the redundancy they observe, within a reliability floor, and print an estimation of
+ *           the radio-on time saved with respect to \link N_TX \endlink.
+ *
+ *           With \link HOP_AWARE_WAKEUP \endlink, receivers delay the start of each Glossy phase
+ *           by the number of slots the flood takes to reach them, minus a safety margin learned
+ *           from the previous phases. The end of the phase is not delayed.
+ *
+ *           With \link NETWORK_TIME \endlink, nodes align a network-wide time with each reference time
+ *           they compute, taking the sequence number times \link GLOSSY_PERIOD \endlink as the time
+ *           of the reference, and correct it with their clock skew.
+ *
  * @{
  */
 
@@ -94,6 +118,9 @@
 
 #include "glossy-test.h"
 #include "node-id.h"
+#include "dev/xmem.h"
+#include <stddef.h>
+#include <string.h>
 
 /**
  * \defgroup glossy-test-variables Application variables
@@ -109,16 +136,45 @@ static unsigned short id = 2;
 static glossy_data_struct glossy_data;     /**< \brief Flooding data. */
 static struct rtimer rt;                   /**< \brief Rtimer used to schedule Glossy. */
 static struct pt pt;                       /**< \brief Protothread used to schedule Glossy. */
-static rtimer_clock_t t_ref_l_old = 0;     /**< \brief Reference time computed from the Glossy
-                                                phase before the last one. \sa get_t_ref_l */
+static rtimer_ext_clock_t t_ref_old = 0;   /**< \brief Reference time computed from the Glossy
+                                                phase before the last one. \sa get_t_ref_ext */
 static uint8_t skew_estimated = 0;         /**< \brief Not zero if the clock skew over a period of length
                                                 \link GLOSSY_PERIOD \endlink has already been estimated. */
 static uint8_t sync_missed = 0;            /**< \brief Current number of consecutive phases without
                                                 synchronization (reference time not computed). */
-static rtimer_clock_t t_start = 0;         /**< \brief Starting time (low-frequency clock)
+static rtimer_ext_clock_t t_start = 0;     /**< \brief Starting time (extended low-frequency clock)
                                                 of the last Glossy phase. */
 static int period_skew = 0;                /**< \brief Current estimation of clock skew over a period
                                                 of length \link GLOSSY_PERIOD \endlink. */
+static rtimer_clock_t guard_time = GLOSSY_GUARD_TIME; /**< \brief Current guard-time at receivers. */
+static uint8_t warm_start = 0;             /**< \brief Not zero until the first reference time after the
+                                                synchronization state was restored from the flash. */
+#if SYNC_CHECKPOINT
+static uint16_t checkpoint_next = 0;       /**< \brief Index of the next free checkpoint record
+                                                in the current sector. */
+static uint8_t checkpoint_sector = 0;      /**< \brief Sector the checkpoints are currently appended to. */
+static uint16_t checkpoint_seq = 0;        /**< \brief Sequence number of the next checkpoint record. */
+static uint8_t checkpoint_cnt = 0;         /**< \brief Number of Glossy phases since the last checkpoint. */
+#endif /* SYNC_CHECKPOINT */
+#if SKEW_REGRESSION
+static uint8_t skew_n = 0;                 /**< \brief Number of reference times in the regression window. */
+static uint8_t skew_gap = 0;               /**< \brief Number of periods since the last reference time
+                                                in the window. */
+static rtimer_ext_clock_t skew_t_last = 0; /**< \brief Last reference time in the window. */
+static int skew_x[SKEW_WINDOW];            /**< \brief Periods of the reference times in the window,
+                                                relative to the last one. */
+static long skew_y[SKEW_WINDOW];           /**< \brief Deviations of the reference times in the window
+                                                from the nominal period, relative to the last one,
+                                                in 1/256 ticks of low-frequency clock. */
+static unsigned int skew_sigma = 0;        /**< \brief Standard deviation of the residuals of the
+                                                regression, in 1/256 ticks of low-frequency clock. */
+static long skew_b = 0;                    /**< \brief Slope of the regression, in 1/256 ticks
+                                                of low-frequency clock per period. */
+#endif /* SKEW_REGRESSION */
+#if CHANNEL_HOPPING
+static unsigned long hop_seq_no = 0;       /**< \brief Sequence number expected in the next Glossy phase
+                                                (receivers). */
+#endif /* CHANNEL_HOPPING */
 
 /** @} */
 
@@ -132,10 +188,138 @@ static unsigned long packets_missed = 0;   /**< \brief Current number of missed
 static unsigned long latency = 0;          /**< \brief Latency of last Glossy phase, in us. */
 static unsigned long sum_latency = 0;      /**< \brief Current sum of latencies, in ticks of low-frequency
                                                 clock (used to compute average). */
+#if ADAPTIVE_N_TX
+static unsigned long sum_ntx = 0;          /**< \brief Current sum of the numbers of transmissions
+                                                (used to compute average). */
+static unsigned long sum_saved = 0;        /**< \brief Current sum of the radio-on times saved
+                                                with respect to \link N_TX \endlink, in us. */
+#endif /* ADAPTIVE_N_TX */
+#if HOP_AWARE_WAKEUP
+static rtimer_clock_t wakeup_offset = 0;   /**< \brief Delay of the start of the current Glossy phase,
+                                                in ticks of low-frequency clock. */
+static unsigned long sum_wakeup_slots = 0; /**< \brief Current sum of the wake-up delays, in slots
+                                                (used to compute average). */
+#endif /* HOP_AWARE_WAKEUP */
+#if LATENCY_QUANTILES
+static uint16_t lat_hist[LATENCY_BUCKETS];     /**< \brief Histogram of all latencies, halved whenever a
+                                                bucket is about to overflow. */
+static uint8_t lat_win_hist[LATENCY_BUCKETS];   /**< \brief Histogram of the latencies in the window. */
+static uint8_t lat_win[LATENCY_WINDOW];    /**< \brief Buckets of the latencies in the window (ring). */
+static uint8_t lat_win_idx = 0;            /**< \brief Position of the oldest latency in the window. */
+static uint8_t lat_win_n = 0;              /**< \brief Number of latencies in the window. */
+static rtimer_clock_t lat_max = 0;         /**< \brief Maximum latency, in ticks of low-frequency clock. */
+#endif /* LATENCY_QUANTILES */
 
 /** @} */
 /** @} */
 
+/**
+ * \defgroup glossy-test-checkpoint Checkpoints of the synchronization state
+ * @{
+ */
+
+#if SYNC_CHECKPOINT
+static uint16_t sync_checkpoint_checksum(const sync_checkpoint_struct *rec) {
+	const uint8_t *p = (const uint8_t *)rec;
+	uint16_t sum = 0;
+	uint8_t i;
+	for (i = 0; i < offsetof(sync_checkpoint_struct, checksum); i++) {
+		sum = ((sum << 1) | (sum >> 15)) ^ p[i];
+	}
+	return sum;
+}
+
+static inline void sync_checkpoint_erase(uint8_t sector) {
+	xmem_erase(XMEM_ERASE_UNIT_SIZE, SYNC_CHECKPOINT_XMEM_OFFSET + sector * XMEM_ERASE_UNIT_SIZE);
+}
+
+static inline void sync_checkpoint_store(void) {
+	sync_checkpoint_struct rec;
+	// (clear the padding, it is part of the checksum)
+	memset(&rec, 0, sizeof(rec));
+	rec.magic = SYNC_CHECKPOINT_MAGIC;
+	rec.version = SYNC_CHECKPOINT_VERSION;
+	rec.hop = get_relay_cnt();
+	rec.period = GLOSSY_PERIOD;
+	rec.T_slot_h = get_T_slot_h();
+	rec.period_skew = period_skew;
+	rec.seq = checkpoint_seq++;
+	rec.checksum = sync_checkpoint_checksum(&rec);
+	if (checkpoint_next >= SYNC_CHECKPOINT_RECORDS) {
+		// The sector is full: continue in the other one, erased when we switched to this one.
+		checkpoint_sector ^= 1;
+		checkpoint_next = 0;
+	}
+	xmem_pwrite(&rec, sizeof(rec), SYNC_CHECKPOINT_RECORD_ADDR(checkpoint_sector, checkpoint_next));
+	if (checkpoint_next++ == 0) {
+		// The first record of this sector is written: erase the other one.
+		// xmem_erase() only starts the erase, which completes well before the next checkpoint,
+		// without blocking this process (and the watchdog) for up to 3 s.
+		sync_checkpoint_erase(checkpoint_sector ^ 1);
+	}
+}
+
+static uint8_t sync_checkpoint_last(uint8_t sector, sync_checkpoint_struct *rec, uint16_t *cnt) {
+	uint16_t lo = 0, hi = SYNC_CHECKPOINT_RECORDS;
+	uint8_t i;
+	// Records are appended to the sector: binary search for the first free one.
+	while (lo < hi) {
+		uint16_t mid = (lo + hi) / 2;
+		xmem_pread(rec, sizeof(*rec), SYNC_CHECKPOINT_RECORD_ADDR(sector, mid));
+		if (rec->magic) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	*cnt = lo;
+	// Use the last record, or the one before if the last one was not completely written.
+	for (i = 0; (i < 2) && (lo > 0); i++) {
+		lo--;
+		xmem_pread(rec, sizeof(*rec), SYNC_CHECKPOINT_RECORD_ADDR(sector, lo));
+		if ((rec->magic == SYNC_CHECKPOINT_MAGIC) && (rec->version == SYNC_CHECKPOINT_VERSION) &&
+				(rec->checksum == sync_checkpoint_checksum(rec))) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static inline uint8_t sync_checkpoint_restore(void) {
+	sync_checkpoint_struct rec[2];
+	uint16_t cnt[2];
+	uint8_t valid[2];
+	valid[0] = sync_checkpoint_last(0, &rec[0], &cnt[0]);
+	valid[1] = sync_checkpoint_last(1, &rec[1], &cnt[1]);
+	// Normally one of the sectors is erased. If the node rebooted before the erase of the
+	// sector it had just left completed, the newest record tells which one is current.
+	checkpoint_sector = (valid[1] && ((!valid[0]) || ((int16_t)(rec[1].seq - rec[0].seq) > 0))) ? 1 : 0;
+	checkpoint_next = cnt[checkpoint_sector];
+	if (cnt[checkpoint_sector ^ 1]) {
+		// Complete the interrupted erase (see sync_checkpoint_store).
+		sync_checkpoint_erase(checkpoint_sector ^ 1);
+	}
+	if (!valid[checkpoint_sector]) {
+		return 0;
+	}
+	checkpoint_seq = rec[checkpoint_sector].seq + 1;
+	if (rec[checkpoint_sector].period != GLOSSY_PERIOD) {
+		// The clock skew refers to another period.
+		return 0;
+	}
+	set_T_slot_h(rec[checkpoint_sector].T_slot_h);
+	period_skew = rec[checkpoint_sector].period_skew;
+#if HOP_AWARE_WAKEUP
+	glossy_wakeup_set_hop(rec[checkpoint_sector].hop);
+#endif /* HOP_AWARE_WAKEUP */
+	printf("warm start: T_slot_h %u, skew %d, hop %u\n", rec[checkpoint_sector].T_slot_h,
+			rec[checkpoint_sector].period_skew, rec[checkpoint_sector].hop);
+	return 1;
+}
+#endif /* SYNC_CHECKPOINT */
+
+/** @} */
+
 /**
  * \defgroup glossy-test-processes Application processes and functions
  * @{
@@ -146,13 +330,264 @@ static unsigned long sum_latency = 0;      /**< \brief Current sum of latencies,
  * @{
  */
 
+static inline void print_path(void) {
+	uint8_t i;
+	// Print the id recorded in each slot, skipping the slots nobody recorded.
+	printf("Logs: ");
+	for (i = 0; i < GLOSSY_PATH_LEN; i++) {
+		if (glossy_data.path[i]) {
+			printf(" %u", glossy_data.path[i]);
+		}
+	}
+	printf("\n");
+}
+
+static unsigned long scale(unsigned long a, unsigned long b, unsigned long c) {
+	// a * b / c without overflow (as long as the result fits), with 16 fractional bits for a / c
+	unsigned long q = a / c, r = a % c, frac = 0;
+	uint8_t i;
+	while (c & 0x80000000UL) {
+		// keep the remainder below 2^31, it is doubled below
+		r >>= 1;
+		c >>= 1;
+	}
+	for (i = 0; i < 16; i++) {
+		r <<= 1;
+		frac <<= 1;
+		if (r >= c) {
+			r -= c;
+			frac |= 1;
+		}
+	}
+	return q * b + (b >> 16) * frac + (((b & 0xffff) * frac) >> 16);
+}
+
+#if LATENCY_QUANTILES
+static uint8_t latency_bucket(rtimer_clock_t t) {
+	uint8_t e = 3;
+	if (t < 8) {
+		return t;
+	}
+	if (t >= LATENCY_MAX_TICKS) {
+		return LATENCY_BUCKETS - 1;
+	}
+	// exponent (2^e <= t < 2^(e+1)) and the 3 bits that follow the leading one
+	while (t >> (e + 1)) {
+		e++;
+	}
+	return ((e - 2) << 3) | ((t >> (e - 3)) & 7);
+}
+
+static rtimer_clock_t latency_bucket_max(uint8_t b) {
+	uint8_t e = (b >> 3) + 2;
+	if (b < 8) {
+		return b;
+	}
+	return ((rtimer_clock_t)(8 + (b & 7)) << (e - 3)) + (1 << (e - 3)) - 1;
+}
+
+static inline void latency_add(rtimer_clock_t t) {
+	uint8_t b = latency_bucket(t);
+	uint8_t i;
+	if (lat_hist[b] == 0xffff) {
+		// halve all the buckets, which keeps the percentiles
+		for (i = 0; i < LATENCY_BUCKETS; i++) {
+			lat_hist[i] >>= 1;
+		}
+	}
+	lat_hist[b]++;
+	if (t > lat_max) {
+		lat_max = t;
+	}
+	if (lat_win_n == LATENCY_WINDOW) {
+		// the window is full: replace the oldest latency
+		lat_win_hist[lat_win[lat_win_idx]]--;
+	} else {
+		lat_win_n++;
+	}
+	lat_win[lat_win_idx] = b;
+	lat_win_hist[b]++;
+	if (++lat_win_idx == LATENCY_WINDOW) {
+		lat_win_idx = 0;
+	}
+}
+
+static void latency_quantiles(uint8_t window, unsigned long *q) {
+	// ranks of the 50th, 90th and 99th percentiles, then of the maximum
+	unsigned long rank[4];
+	unsigned long n = 0, cnt = 0;
+	uint8_t b, k = 0;
+	for (b = 0; b < LATENCY_BUCKETS; b++) {
+		n += (window) ? lat_win_hist[b] : lat_hist[b];
+	}
+	rank[0] = (n * 50 + 99) / 100;
+	rank[1] = (n * 90 + 99) / 100;
+	rank[2] = (n * 99 + 99) / 100;
+	rank[3] = n;
+	for (b = 0; (b < LATENCY_BUCKETS) && (k < 4); b++) {
+		cnt += (window) ? lat_win_hist[b] : lat_hist[b];
+		while ((k < 4) && (cnt >= rank[k])) {
+			q[k++] = TICKS_TO_US(latency_bucket_max(b));
+		}
+	}
+}
+#endif /* LATENCY_QUANTILES */
+
+static inline void compute_stats(glossy_stats_struct *s) {
+	unsigned long phases = packets_received + packets_missed;
+	memset(s, 0, sizeof(*s));
+	s->seq_no = glossy_data.seq_no;
+	s->rx_cnt = get_rx_cnt();
+	s->latency_us = latency;
+	s->packets_received = packets_received;
+	s->packets_missed = packets_missed;
+	s->avg_rel = scale(packets_received, 100000, phases);
+	if (packets_received) {
+		s->avg_latency_us = scale(sum_latency, 1000000UL / 64, packets_received) / (RTIMER_SECOND / 64);
+#if LATENCY_QUANTILES
+		latency_quantiles(1, s->lat_win_us);
+		latency_quantiles(0, s->lat_all_us);
+		s->lat_all_us[3] = TICKS_TO_US(lat_max);
+#endif /* LATENCY_QUANTILES */
+	}
+#if ENERGEST_CONF_ON
+	s->avg_radio_on_us = scale(energest_type_time(ENERGEST_TYPE_LISTEN) + energest_type_time(ENERGEST_TYPE_TRANSMIT),
+			TICKS_TO_US(GLOSSY_PERIOD),
+			energest_type_time(ENERGEST_TYPE_CPU) + energest_type_time(ENERGEST_TYPE_LPM));
+#endif /* ENERGEST_CONF_ON */
+#if ADAPTIVE_N_TX
+	s->avg_ntx = scale(sum_ntx, 100, phases);
+	s->avg_saved_us = sum_saved / phases;
+#endif /* ADAPTIVE_N_TX */
+#if HOP_AWARE_WAKEUP
+	s->avg_wakeup_slots = scale(sum_wakeup_slots, 100, phases);
+#endif /* HOP_AWARE_WAKEUP */
+	s->period_skew = period_skew;
+	s->guard_us = TICKS_TO_US(guard_time);
+}
+
+#if STATS_BINARY
+static void stats_put(unsigned long value, uint8_t len, uint16_t *sum) {
+	// little endian, SLIP escaping
+	while (len--) {
+		uint8_t c = value & 0xff;
+		value >>= 8;
+		*sum += c;
+		if (c == SLIP_END) {
+			putchar(SLIP_ESC);
+			putchar(SLIP_ESC_END);
+		} else if (c == SLIP_ESC) {
+			putchar(SLIP_ESC);
+			putchar(SLIP_ESC_ESC);
+		} else {
+			putchar(c);
+		}
+	}
+}
+
+static inline void send_stats(const glossy_stats_struct *s) {
+	uint16_t sum = 0;
+	uint8_t i;
+	putchar(SLIP_END);
+	stats_put('S', 1, &sum);
+	stats_put(STATS_VERSION, 1, &sum);
+	stats_put(node_id, 2, &sum);
+	stats_put(s->seq_no, 4, &sum);
+	stats_put(s->rx_cnt, 1, &sum);
+	stats_put(s->latency_us, 4, &sum);
+	stats_put(s->packets_received, 4, &sum);
+	stats_put(s->packets_missed, 4, &sum);
+	stats_put(s->avg_rel, 4, &sum);
+	stats_put(s->avg_latency_us, 4, &sum);
+	stats_put(s->avg_radio_on_us, 4, &sum);
+	stats_put(s->avg_ntx, 2, &sum);
+	stats_put(s->avg_saved_us, 4, &sum);
+	stats_put(s->avg_wakeup_slots, 2, &sum);
+	stats_put((uint16_t)s->period_skew, 2, &sum);
+	stats_put(s->guard_us, 2, &sum);
+	for (i = 0; i < 4; i++) {
+		stats_put(s->lat_win_us[i], 4, &sum);
+	}
+	for (i = 0; i < 4; i++) {
+		stats_put(s->lat_all_us[i], 4, &sum);
+	}
+	stats_put(sum, 2, &sum);
+	putchar(SLIP_END);
+}
+#else
+static inline void print_stats(const glossy_stats_struct *s) {
+	if (s->rx_cnt) {
+		// Print information about last packet and related latency.
+		printf("Glossy received %u time%s: seq_no %lu, latency %lu.%03lu ms\n",
+				s->rx_cnt, (s->rx_cnt > 1) ? "s" : "", s->seq_no,
+				s->latency_us / 1000, s->latency_us % 1000);
+		printf("Node's ID:%d\n", node_id);
+#if GLOSSY_PATH_TRACE
+		print_path();
+#endif /* GLOSSY_PATH_TRACE */
+	} else {
+		// Print failed reception.
+		printf("Glossy NOT received\n");
+	}
+#if GLOSSY_DEBUG
+	printf("high_T_irq %u, rx_timeout %u, bad_length %u, bad_header %u, bad_crc %u\n",
+			high_T_irq, rx_timeout, bad_length, bad_header, bad_crc);
+#endif /* GLOSSY_DEBUG */
+	// Print information about average reliability.
+	printf("average reliability %3lu.%03lu %% (missed %lu out of %lu packets)\n",
+			s->avg_rel / 1000, s->avg_rel % 1000,
+			s->packets_missed, s->packets_received + s->packets_missed);
+#if ENERGEST_CONF_ON
+	// Print information about average radio-on time.
+	printf("average radio-on time %lu.%03lu ms\n",
+			s->avg_radio_on_us / 1000, s->avg_radio_on_us % 1000);
+#endif /* ENERGEST_CONF_ON */
+	if (!IS_INITIATOR()) {
+#if ADAPTIVE_N_TX
+		// Radio-on time saved by adapting the number of transmissions (estimation).
+		printf("average N_TX %u.%02u (instead of %u), radio-on time saved %lu.%03lu ms\n",
+				s->avg_ntx / 100, s->avg_ntx % 100, N_TX, s->avg_saved_us / 1000, s->avg_saved_us % 1000);
+#endif /* ADAPTIVE_N_TX */
+#if HOP_AWARE_WAKEUP
+		printf("average wake-up delay %u.%02u slots\n", s->avg_wakeup_slots / 100, s->avg_wakeup_slots % 100);
+#endif /* HOP_AWARE_WAKEUP */
+#if SKEW_REGRESSION
+		// Print current skew estimation and guard-time.
+		printf("skew %d ticks per period, residuals %u.%02u ticks, guard-time %u us\n",
+				s->period_skew, skew_sigma / 256, (skew_sigma % 256) * 100 / 256, s->guard_us);
+#endif /* SKEW_REGRESSION */
+	}
+	// Print information about average latency.
+	printf("average latency %lu.%03lu ms\n",
+			s->avg_latency_us / 1000, s->avg_latency_us % 1000);
+#if LATENCY_QUANTILES
+	printf("latency P50/P90/P99/max, last %u: %lu/%lu/%lu/%lu us, all: %lu/%lu/%lu/%lu us\n",
+			lat_win_n, s->lat_win_us[0], s->lat_win_us[1], s->lat_win_us[2], s->lat_win_us[3],
+			s->lat_all_us[0], s->lat_all_us[1], s->lat_all_us[2], s->lat_all_us[3]);
+#endif /* LATENCY_QUANTILES */
+#if NETWORK_TIME
+	struct glossy_time nt;
+	if (glossy_time_now(&nt)) {
+		printf("network time %lu.%06lu s\n", nt.ticks / RTIMER_SECOND,
+				TICKS_TO_US(nt.ticks % RTIMER_SECOND) + (nt.frac * 1000000UL / 256) / RTIMER_SECOND);
+	}
+#endif /* NETWORK_TIME */
+}
+#endif /* STATS_BINARY */
+
 PROCESS(glossy_print_stats_process, "Glossy print stats");
 PROCESS_THREAD(glossy_print_stats_process, ev, data)
 {
+	static glossy_stats_struct stats;
+
 	PROCESS_BEGIN();
 
 	while(1) {
 		PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+#if GLOSSY_TRACE
+		// Dump the event trace of the last Glossy phase (tools/sky/glossy-trace decodes it).
+		glossy_trace_dump();
+#endif /* GLOSSY_TRACE */
 		// Print statistics only if Glossy is not still bootstrapping.
 		if (!GLOSSY_IS_BOOTSTRAPPING()) {
 			if (get_rx_cnt()) {	// Packet received at least once.
@@ -162,57 +597,42 @@ PROCESS_THREAD(glossy_print_stats_process, ev, data)
 				rtimer_clock_t lat = get_t_first_rx_l() - get_t_ref_l();
 				// Add last latency to sum of latencies.
 				sum_latency += lat;
+#if LATENCY_QUANTILES
+				// Add it to the latency histograms.
+				latency_add(lat);
+#endif /* LATENCY_QUANTILES */
 				// Convert latency to microseconds.
-				latency = (unsigned long)(lat) * 1e6 / RTIMER_SECOND;
-				// Print information about last packet and related latency.
-				printf("Glossy received %u time%s: seq_no %lu, latency %lu.%03lu ms\n",
-						get_rx_cnt(), (get_rx_cnt() > 1) ? "s" : "", glossy_data.seq_no,
-								latency / 1000, latency % 1000);
-
-                printf("Node's ID:%d\n",node_id);
-
-				printf("Logs: ");
-                int i=0;
-
-                while(glossy_data.logs[i]!=0)
-                {
-                printf(" %d",glossy_data.logs[i]);
-                i++;
-                }
-
-                printf("\n");
+				latency = TICKS_TO_US(lat);
 			} else {	// Packet not received.
 				// Increment number of missed packets.
 				packets_missed++;
-				// Print failed reception.
-				printf("Glossy NOT received\n");
 			}
-#if GLOSSY_DEBUG
-//			printf("skew %ld ppm\n", (long)(period_skew * 1e6) / GLOSSY_PERIOD);
-			printf("high_T_irq %u, rx_timeout %u, bad_length %u, bad_header %u, bad_crc %u\n",
-					high_T_irq, rx_timeout, bad_length, bad_header, bad_crc);
-#endif /* GLOSSY_DEBUG */
-			// Compute current average reliability.
-			unsigned long avg_rel = packets_received * 1e5 / (packets_received + packets_missed);
-			// Print information about average reliability.
-			printf("average reliability %3lu.%03lu %% ",
-					avg_rel / 1000, avg_rel % 1000);
-			printf("(missed %lu out of %lu packets)\n",
-					packets_missed, packets_received + packets_missed);
-#if ENERGEST_CONF_ON
-			// Compute average radio-on time, in microseconds.
-			unsigned long avg_radio_on = (unsigned long)GLOSSY_PERIOD * 1e6 / RTIMER_SECOND *
-					(energest_type_time(ENERGEST_TYPE_LISTEN) + energest_type_time(ENERGEST_TYPE_TRANSMIT)) /
-					(energest_type_time(ENERGEST_TYPE_CPU) + energest_type_time(ENERGEST_TYPE_LPM));
-			// Print information about average radio-on time.
-			printf("average radio-on time %lu.%03lu ms\n",
-					avg_radio_on / 1000, avg_radio_on % 1000);
-#endif /* ENERGEST_CONF_ON */
-			// Compute average latency, in microseconds.
-			unsigned long avg_latency = sum_latency * 1e6 / (RTIMER_SECOND * packets_received);
-			// Print information about average latency.
-			printf("average latency %lu.%03lu ms\n",
-					avg_latency / 1000, avg_latency % 1000);
+			if (!IS_INITIATOR()) {
+#if ADAPTIVE_N_TX
+				sum_ntx += glossy_ntx_get();
+				sum_saved += glossy_ntx_get_saved_us();
+#endif /* ADAPTIVE_N_TX */
+#if HOP_AWARE_WAKEUP
+				sum_wakeup_slots += glossy_wakeup_slots();
+#endif /* HOP_AWARE_WAKEUP */
+			}
+#if SYNC_CHECKPOINT
+			if ((!IS_INITIATOR()) && (get_rx_cnt()) && (!sync_missed) &&
+					(++checkpoint_cnt >= SYNC_CHECKPOINT_PERIOD)) {
+				// Store the synchronization state (between two Glossy phases,
+				// the radio does not use the SPI bus).
+				checkpoint_cnt = 0;
+				sync_checkpoint_store();
+			}
+#endif /* SYNC_CHECKPOINT */
+			// Compute the statistics with integer arithmetic only.
+			compute_stats(&stats);
+#if STATS_BINARY
+			// Send them as a binary record (tools/sky/glossy-stats decodes it).
+			send_stats(&stats);
+#else
+			print_stats(&stats);
+#endif /* STATS_BINARY */
 		}
 	}
 
@@ -226,13 +646,114 @@ PROCESS_THREAD(glossy_print_stats_process, ev, data)
  * @{
  */
 
+#if SKEW_REGRESSION
+static unsigned int isqrt(unsigned long x) {
+	unsigned long r = 0, bit = 1UL << 30;
+	while (bit > x) {
+		bit >>= 2;
+	}
+	while (bit) {
+		if (x >= r + bit) {
+			x -= r + bit;
+			r = (r >> 1) + bit;
+		} else {
+			r >>= 1;
+		}
+		bit >>= 2;
+	}
+	return r;
+}
+
+static inline long div_round(long a, long b) {
+	return (a >= 0) ? (a + b / 2) / b : -((-a + b / 2) / b);
+}
+
+static inline void estimate_skew_regression(void) {
+	uint8_t i, j;
+	if (sync_missed) {
+		// The reference time was extrapolated, not measured.
+		if (skew_gap < 0xff) {
+			skew_gap++;
+		}
+		return;
+	}
+	if (skew_n) {
+		// Deviation of this reference time from the nominal period(s), in 1/256 ticks.
+		long dev = (long)(get_t_ref_ext() - skew_t_last -
+				(skew_gap + 1) * (unsigned long)GLOSSY_PERIOD) << 8;
+		// Make the window relative to this reference time and drop old entries.
+		for (i = 0, j = 0; i < skew_n; i++) {
+			int x = skew_x[i] - (skew_gap + 1);
+			if ((x > -2 * SKEW_WINDOW) && (i + SKEW_WINDOW > skew_n)) {
+				skew_x[j] = x;
+				skew_y[j] = skew_y[i] - dev;
+				j++;
+			}
+		}
+		skew_n = j;
+	}
+	skew_x[skew_n] = 0;
+	skew_y[skew_n] = 0;
+	skew_n++;
+	skew_gap = 0;
+	skew_t_last = get_t_ref_ext();
+	if (skew_n < 2) {
+		return;
+	}
+	// Least-squares fit y = a + b * x (a and b in 1/256 ticks).
+	long sx = 0, sxx = 0, sy = 0, sxy = 0;
+	for (i = 0; i < skew_n; i++) {
+		sx += skew_x[i];
+		sxx += (long)skew_x[i] * skew_x[i];
+		sy += skew_y[i];
+		sxy += skew_x[i] * skew_y[i];
+	}
+	long b = div_round(skew_n * sxy - sx * sy, skew_n * sxx - sx * sx);
+	long a = div_round(sy - b * sx, skew_n);
+	skew_b = b;
+	// The next reference time is expected one period after the last one, on the line.
+	period_skew = div_round(a + b, 256);
+	if (skew_n < 4) {
+		// Too few points to trust the residuals.
+		guard_time = GLOSSY_GUARD_TIME;
+		return;
+	}
+	unsigned long sum_r2 = 0;
+	for (i = 0; i < skew_n; i++) {
+		long r = skew_y[i] - (a + b * skew_x[i]);
+		// (bound the contribution of outliers, 32 ticks at most)
+		if (r > 8191) {
+			r = 8191;
+		} else if (r < -8191) {
+			r = -8191;
+		}
+		sum_r2 += r * r;
+	}
+	skew_sigma = isqrt(sum_r2 / (skew_n - 2));
+	unsigned long guard = GLOSSY_GUARD_TIME_MIN + ((unsigned long)SKEW_GUARD_SIGMAS * skew_sigma + 255) / 256;
+	guard_time = (guard < GLOSSY_GUARD_TIME) ? guard : GLOSSY_GUARD_TIME;
+}
+#endif /* SKEW_REGRESSION */
+
 static inline void estimate_period_skew(void) {
 	// Estimate clock skew over a period only if the reference time has been updated.
 	if (GLOSSY_IS_SYNCED()) {
-		// Estimate clock skew based on previous reference time and the Glossy period.
-		period_skew = get_t_ref_l() - (t_ref_l_old + (rtimer_clock_t)GLOSSY_PERIOD);
+		if (warm_start) {
+			// Warm start: the clock skew and the slot length are already known.
+			skew_estimated = GLOSSY_BOOTSTRAP_PERIODS - 1;
+		}
+#if SKEW_REGRESSION
+		// Estimate clock skew based on the reference times of the last periods.
+		estimate_skew_regression();
+#else
+		if (!warm_start) {
+			// Estimate clock skew based on previous reference time and the Glossy period.
+			period_skew = (long)(get_t_ref_ext() - (t_ref_old + GLOSSY_PERIOD));
+		}
+#endif /* SKEW_REGRESSION */
+		warm_start = 0;
 		// Update old reference time with the newer one.
-		t_ref_l_old = get_t_ref_l();
+		t_ref_old = get_t_ref_ext();
 		// If Glossy is still bootstrapping, count the number of consecutive updates of the reference time.
 		if (GLOSSY_IS_BOOTSTRAPPING()) {
 			// Increment number of consecutive updates of the reference time.
@@ -255,6 +776,38 @@ static inline void estimate_period_skew(void) {
 	}
 }
 
+#if NETWORK_TIME
+static inline void sync_network_time(void) {
+	// Only reference times computed by Glossy in this phase, not extrapolated ones.
+	if (get_rx_cnt() && GLOSSY_IS_SYNCED() && !sync_missed) {
+		glossy_time_sync(glossy_data.seq_no * GLOSSY_PERIOD);
+		if (!IS_INITIATOR()) {
+#if SKEW_REGRESSION
+			glossy_time_set_skew(skew_b, GLOSSY_PERIOD);
+#else
+			glossy_time_set_skew((long)period_skew * 256, GLOSSY_PERIOD);
+#endif /* SKEW_REGRESSION */
+		}
+	}
+}
+#endif /* NETWORK_TIME */
+
+/** @} */
+
+/**
+ * \defgroup glossy-test-hopping Channel hopping
+ * @{
+ */
+
+#if CHANNEL_HOPPING
+static inline void update_blacklist(uint16_t blacklist) {
+	// Announce the new blacklist in the next BLACKLIST_ANNOUNCE floods, then use it.
+	glossy_data.blacklist = blacklist;
+	glossy_data.blacklist_seq = glossy_data.seq_no + 1 + BLACKLIST_ANNOUNCE;
+	glossy_hopping_set_blacklist(glossy_data.blacklist, glossy_data.blacklist_seq);
+}
+#endif /* CHANNEL_HOPPING */
+
 /** @} */
 
 /**
@@ -269,7 +822,10 @@ char glossy_scheduler(struct rtimer *t, void *ptr) {
 		while (1) {
 			// Increment sequence number.
 			glossy_data.seq_no++;
-			glossy_data.logs[0]=1;
+#if CHANNEL_HOPPING
+			// The sequence number selects the channel.
+			glossy_hopping_set_seq(glossy_data.seq_no);
+#endif /* CHANNEL_HOPPING */
 
 			// Glossy phase.
 			leds_on(LEDS_BLUE);
@@ -278,7 +834,7 @@ char glossy_scheduler(struct rtimer *t, void *ptr) {
 			glossy_start((uint8_t *)&glossy_data, DATA_LEN, GLOSSY_INITIATOR, GLOSSY_SYNC, N_TX,
 					APPLICATION_HEADER, t_stop, (rtimer_callback_t)glossy_scheduler, t, ptr, id);
 			// Store time at which Glossy has started.
-			t_start = RTIMER_TIME(t);
+			t_start = RTIMER_TIME_EXT(t);
 			// Yield the protothread. It will be resumed when Glossy terminates.
 			PT_YIELD(&pt);
 
@@ -290,14 +846,18 @@ char glossy_scheduler(struct rtimer *t, void *ptr) {
 				// Glossy has already successfully bootstrapped.
 				if (!GLOSSY_IS_SYNCED()) {
 					// The reference time was not updated: increment reference time by GLOSSY_PERIOD.
-					set_t_ref_l(GLOSSY_REFERENCE_TIME + GLOSSY_PERIOD);
+					set_t_ref_ext(GLOSSY_REFERENCE_TIME + GLOSSY_PERIOD);
 					set_t_ref_l_updated(1);
 				}
 			}
 			// Schedule begin of next Glossy phase based on GLOSSY_PERIOD.
-			rtimer_set(t, t_start + GLOSSY_PERIOD, 1, (rtimer_callback_t)glossy_scheduler, ptr);
+			rtimer_set_ext(t, t_start + GLOSSY_PERIOD, 1, (rtimer_callback_t)glossy_scheduler, ptr);
 			// Estimate the clock skew over the last period.
 			estimate_period_skew();
+#if NETWORK_TIME
+			// Align the network time with the reference time.
+			sync_network_time();
+#endif /* NETWORK_TIME */
 			// Poll the process that prints statistics (will be activated later by Contiki).
 			process_poll(&glossy_print_stats_process);
 			// Yield the protothread.
@@ -305,18 +865,6 @@ char glossy_scheduler(struct rtimer *t, void *ptr) {
 		}
 	} else {	// Glossy receiver.
 		while (1) {
-		 printf("Glossy_receiver\n");
-
-            printf("Logs: ");
-
-            int i=0;
-            while(glossy_data.logs[i]!=0)
-            {
-                printf(" %d",glossy_data.logs[i]);
-                i++;
-            }
-            printf("\n");
-
 			// Glossy phase.
 			leds_on(LEDS_GREEN);
 			rtimer_clock_t t_stop;
@@ -328,10 +876,24 @@ char glossy_scheduler(struct rtimer *t, void *ptr) {
 				// Glossy has already successfully bootstrapped:
 				// Schedule end of Glossy phase based on GLOSSY_DURATION.
 				t_stop = RTIMER_TIME(t) + GLOSSY_DURATION;
+#if HOP_AWARE_WAKEUP
+				// The start of the phase was delayed, not its end.
+				t_stop -= wakeup_offset;
+#endif /* HOP_AWARE_WAKEUP */
 			}
+#if CHANNEL_HOPPING
+			// Before the first reception, wait on the channel of a fixed sequence number
+			// (the initiator visits it from time to time).
+			glossy_hopping_set_seq((skew_estimated) ? hop_seq_no : 0);
+#endif /* CHANNEL_HOPPING */
 			// Start Glossy.
+#if ADAPTIVE_N_TX
+			glossy_start((uint8_t *)&glossy_data, DATA_LEN, GLOSSY_RECEIVER, GLOSSY_SYNC, glossy_ntx_get(),
+					APPLICATION_HEADER, t_stop, (rtimer_callback_t)glossy_scheduler, t, ptr, id);
+#else
 			glossy_start((uint8_t *)&glossy_data, DATA_LEN, GLOSSY_RECEIVER, GLOSSY_SYNC, N_TX,
 					APPLICATION_HEADER, t_stop, (rtimer_callback_t)glossy_scheduler, t, ptr, id);
+#endif /* ADAPTIVE_N_TX */
 			// Yield the protothread. It will be resumed when Glossy terminates.
 			PT_YIELD(&pt);
 
@@ -339,18 +901,43 @@ char glossy_scheduler(struct rtimer *t, void *ptr) {
 			leds_off(LEDS_GREEN);
 			// Stop Glossy.
 			glossy_stop();
+#if CHANNEL_HOPPING
+			if (get_rx_cnt()) {
+				// Follow the sequence number and the blacklist of the initiator.
+				hop_seq_no = glossy_data.seq_no + 1;
+				glossy_hopping_set_blacklist(glossy_data.blacklist, glossy_data.blacklist_seq);
+			} else {
+				hop_seq_no++;
+			}
+#endif /* CHANNEL_HOPPING */
+#if ADAPTIVE_N_TX
+			if (!GLOSSY_IS_BOOTSTRAPPING()) {
+				// Adapt the number of transmissions to the outcome of this phase.
+				glossy_ntx_update();
+			}
+#endif /* ADAPTIVE_N_TX */
+#if HOP_AWARE_WAKEUP
+			if (!GLOSSY_IS_BOOTSTRAPPING()) {
+				// Learn when the flood reaches this node.
+				glossy_wakeup_update();
+			}
+#endif /* HOP_AWARE_WAKEUP */
 			if (GLOSSY_IS_BOOTSTRAPPING()) {
 				// Glossy is still bootstrapping.
 				if (!GLOSSY_IS_SYNCED()) {
 					// The reference time was not updated: reset skew_estimated to zero.
 					skew_estimated = 0;
+#if SKEW_REGRESSION
+					// Restart the regression.
+					skew_n = 0;
+#endif /* SKEW_REGRESSION */
 				}
 			} else {
 				// Glossy has already successfully bootstrapped.
 				if (!GLOSSY_IS_SYNCED()) {
 					// The reference time was not updated:
 					// increment reference time by GLOSSY_PERIOD + period_skew.
-					set_t_ref_l(GLOSSY_REFERENCE_TIME + GLOSSY_PERIOD + period_skew);
+					set_t_ref_ext(GLOSSY_REFERENCE_TIME + GLOSSY_PERIOD + period_skew);
 					set_t_ref_l_updated(1);
 					// Increment sync_missed.
 					sync_missed++;
@@ -361,24 +948,34 @@ char glossy_scheduler(struct rtimer *t, void *ptr) {
 			}
 			// Estimate the clock skew over the last period.
 			estimate_period_skew();
+#if NETWORK_TIME
+			// Align the network time with the reference time.
+			sync_network_time();
+#endif /* NETWORK_TIME */
 			if (GLOSSY_IS_BOOTSTRAPPING()) {
 				// Glossy is still bootstrapping.
 				if (skew_estimated == 0) {
 					// The reference time was not updated:
 					// Schedule begin of next Glossy phase based on last begin and GLOSSY_INIT_PERIOD.
-					rtimer_set(t, RTIMER_TIME(t) + GLOSSY_INIT_PERIOD, 1,
+					rtimer_set_ext(t, RTIMER_TIME_EXT(t) + GLOSSY_INIT_PERIOD, 1,
 							(rtimer_callback_t)glossy_scheduler, ptr);
 				} else {
 					// The reference time was updated:
 					// Schedule begin of next Glossy phase based on reference time and GLOSSY_INIT_PERIOD.
-					rtimer_set(t, GLOSSY_REFERENCE_TIME + GLOSSY_PERIOD - GLOSSY_INIT_GUARD_TIME, 1,
+					rtimer_set_ext(t, GLOSSY_REFERENCE_TIME + GLOSSY_PERIOD - GLOSSY_INIT_GUARD_TIME, 1,
 							(rtimer_callback_t)glossy_scheduler, ptr);
 				}
 			} else {
 				// Glossy has already successfully bootstrapped:
 				// Schedule begin of next Glossy phase based on reference time and GLOSSY_PERIOD.
-				rtimer_set(t, GLOSSY_REFERENCE_TIME + GLOSSY_PERIOD +
-						period_skew - GLOSSY_GUARD_TIME * (1 + sync_missed), 1,
+#if HOP_AWARE_WAKEUP
+				// Delay it until shortly before the flood is expected to reach this node.
+				wakeup_offset = glossy_wakeup_offset_l();
+#else
+				rtimer_clock_t wakeup_offset = 0;
+#endif /* HOP_AWARE_WAKEUP */
+				rtimer_set_ext(t, GLOSSY_REFERENCE_TIME + GLOSSY_PERIOD +
+						period_skew - guard_time * (1 + sync_missed) + wakeup_offset, 1,
 						(rtimer_callback_t)glossy_scheduler, ptr);
 			}
 			// Poll the process that prints statistics (will be activated later by Contiki).
@@ -410,6 +1007,24 @@ PROCESS_THREAD(glossy_test, ev, data)
 	// Initialize Glossy data.
 	glossy_data.seq_no = 0;
 	node_id_burn(id);
+#if CHANNEL_HOPPING
+	glossy_hopping_init(CHANNEL_HOPPING_SEED);
+	if (IS_INITIATOR()) {
+		update_blacklist(CHANNEL_BLACKLIST);
+	}
+#endif /* CHANNEL_HOPPING */
+#if ADAPTIVE_N_TX
+	glossy_ntx_init(N_TX_MIN, N_TX, N_TX_MIN_RELIABILITY);
+#endif /* ADAPTIVE_N_TX */
+#if HOP_AWARE_WAKEUP
+	glossy_wakeup_init(WAKEUP_MARGIN_MIN, WAKEUP_MARGIN_MAX);
+#endif /* HOP_AWARE_WAKEUP */
+#if SYNC_CHECKPOINT
+	if (!IS_INITIATOR()) {
+		// Warm start from the last checkpoint, if any.
+		warm_start = sync_checkpoint_restore();
+	}
+#endif /* SYNC_CHECKPOINT */
 	// Start print stats processes.
 	process_start(&glossy_print_stats_process, NULL);
 	// Start Glossy busy-waiting process.
@@ -74,9 +74,78 @@
  */
 #define N_TX                    5
 
+/**
+ * \brief If not zero, receivers adapt their maximum number of transmissions between
+ *        \link N_TX_MIN \endlink and \link N_TX \endlink (\link glossy_ntx_init \endlink).
+ *        Default value: 1.
+ */
+#define ADAPTIVE_N_TX           1
+
+/**
+ * \brief Minimum number of transmissions of receivers with \link ADAPTIVE_N_TX \endlink.
+ *        Default value: 2.
+ */
+#define N_TX_MIN                2
+
+/**
+ * \brief Reliability floor of receivers with \link ADAPTIVE_N_TX \endlink, in percent.
+ *        Default value: 95.
+ */
+#define N_TX_MIN_RELIABILITY    95
+
+/**
+ * \brief If not zero, receivers turn on the radio only shortly before the slot in which
+ *        they expect the first packet, based on their hop distance from the initiator
+ *        (\link glossy_wakeup_init \endlink).
+ *        Default value: 1.
+ */
+#define HOP_AWARE_WAKEUP        1
+
+/**
+ * \brief Minimum safety margin of the wake-up of receivers with \link HOP_AWARE_WAKEUP \endlink,
+ *        in slots.
+ *        Default value: 1.
+ */
+#define WAKEUP_MARGIN_MIN       1
+
+/**
+ * \brief Maximum safety margin of the wake-up of receivers with \link HOP_AWARE_WAKEUP \endlink,
+ *        in slots.
+ *        Default value: 4.
+ */
+#define WAKEUP_MARGIN_MAX       4
+
+/**
+ * \brief If not zero, statistics are sent as binary records (\link glossy_stats_struct \endlink)
+ *        in SLIP frames, to be decoded by tools/sky/glossy-stats; otherwise they are printed as text.
+ *        Default value: 1.
+ */
+#define STATS_BINARY            1
+
+/**
+ * \brief If not zero, the latency percentiles (50th, 90th, 99th) and maximum are tracked
+ *        over the last \link LATENCY_WINDOW \endlink received packets and over all of them,
+ *        with log-bucketed histograms (\link LATENCY_BUCKETS \endlink buckets, 12.5 % resolution).
+ *        The histogram of all latencies has 16-bit counters, halved when one is about to overflow,
+ *        so that both histograms and the window take about 330 bytes of RAM.
+ *        Default value: 1.
+ */
+#define LATENCY_QUANTILES       1
+
+/**
+ * \brief Number of received packets over which the windowed latency percentiles are computed
+ *        (at most 255).
+ *        Default value: 64.
+ */
+#define LATENCY_WINDOW          64
+
 /**
  * \brief Period with which a Glossy phase is scheduled.
  *        Default value: 250 ms.
+ *
+ *        Phases are scheduled on the extended clock, so the period may exceed the 2 s of
+ *        the 16-bit low-frequency clock, up to 2^23 ticks (256 s), e.g.,
+ *        (30 * (unsigned long)RTIMER_SECOND).
  */
 #define GLOSSY_PERIOD           (RTIMER_SECOND / 4)      // 250 ms
 
@@ -96,6 +165,41 @@
 #define GLOSSY_GUARD_TIME       (RTIMER_SECOND / 1900)   // 526 us
 #endif /* COOJA */
 
+/**
+ * \brief If not zero, receivers estimate the clock skew with a linear regression over the
+ *        reference times of the last \link SKEW_WINDOW \endlink Glossy phases and derive
+ *        their guard-time from the residuals of the regression, between
+ *        \link GLOSSY_GUARD_TIME_MIN \endlink and \link GLOSSY_GUARD_TIME \endlink.
+ *        Otherwise, the skew is estimated from the last two reference times and the guard-time
+ *        is \link GLOSSY_GUARD_TIME \endlink.
+ *        Default value: 1.
+ */
+#define SKEW_REGRESSION         1
+
+/**
+ * \brief Maximum number of reference times used by the regression.
+ *        Reference times older than 2 * SKEW_WINDOW periods are not used either.
+ *        Default value: 8.
+ */
+#define SKEW_WINDOW             8
+
+/**
+ * \brief Guard-time in number of standard deviations of the residuals of the regression,
+ *        on top of \link GLOSSY_GUARD_TIME_MIN \endlink.
+ *        Default value: 4.
+ */
+#define SKEW_GUARD_SIGMAS       4
+
+/**
+ * \brief Minimum guard-time at receivers with \link SKEW_REGRESSION \endlink.
+ *        Default value: 122 us.
+ */
+#if COOJA
+#define GLOSSY_GUARD_TIME_MIN   GLOSSY_GUARD_TIME
+#else
+#define GLOSSY_GUARD_TIME_MIN   (RTIMER_SECOND / 8000)   // 122 us
+#endif /* COOJA */
+
 /**
  * \brief Number of consecutive Glossy phases with successful computation of reference time required to exit from bootstrapping.
  *        Default value: 3.
@@ -121,14 +225,130 @@
  */
 #define GLOSSY_INIT_GUARD_TIME  (RTIMER_SECOND / 20)                                           //  50 ms
 
+/**
+ * \brief If not zero, each Glossy phase uses a different channel, derived from the sequence number.
+ *        Default value: 1.
+ */
+#define CHANNEL_HOPPING         1
+
+/**
+ * \brief Seed of the channel hopping sequence.
+ *        Default value: 0x6c6f.
+ */
+#define CHANNEL_HOPPING_SEED    0x6c6f
+
+/**
+ * \brief Channels the initiator excludes from hopping at startup (bit i: channel 11 + i).
+ *        Default value: 0x0000 (no channel excluded).
+ */
+#define CHANNEL_BLACKLIST       0x0000
+
+/**
+ * \brief Number of Glossy phases during which the initiator announces a new blacklist before using it.
+ *        Default value: 8.
+ */
+#define BLACKLIST_ANNOUNCE      8
+
+/**
+ * \brief If not zero, receivers periodically store their synchronization state in the
+ *        external flash and, after a reboot, use it to exit the bootstrapping phase
+ *        as soon as they compute the reference time once.
+ *        Default value: 1.
+ */
+#define SYNC_CHECKPOINT         1
+
+/**
+ * \brief Number of Glossy phases between two checkpoints of the synchronization state.
+ *        Default value: 240 (one minute).
+ */
+#define SYNC_CHECKPOINT_PERIOD  240
+
+/**
+ * \brief Offset of the two external flash sectors used to log the checkpoints.
+ *        Default value: second sector (the first one stores the node id).
+ */
+#define SYNC_CHECKPOINT_XMEM_OFFSET (1 * XMEM_ERASE_UNIT_SIZE)
+
+/**
+ * \brief If not zero, nodes keep a network-wide time (\link glossy_time \endlink):
+ *        ticks of the initiator since the Glossy phase with sequence number zero.
+ *        Default value: 1.
+ */
+#define NETWORK_TIME            1
+
 /**
  * \brief Data structure used to represent flooding data.
  */
 typedef struct {
+	glossy_path_id_t path[GLOSSY_PATH_LEN]; /**< Path trace, recorded by Glossy (\link GLOSSY_PATH_TRACE \endlink). */
 	unsigned long seq_no; /**< Sequence number, incremented by the initiator at each Glossy phase. */
-	unsigned short logs[20];
+#if CHANNEL_HOPPING
+	unsigned long blacklist_seq; /**< First sequence number the channel blacklist applies to. */
+	uint16_t blacklist;   /**< Channel blacklist, set by the initiator. */
+#endif /* CHANNEL_HOPPING */
 } glossy_data_struct;
 
+/**
+ * \brief Version of the binary statistics record, to be increased whenever its format changes.
+ */
+#define STATS_VERSION           2
+
+/**
+ * \brief Statistics of the Glossy phases, computed after each phase.
+ *
+ *        With \link STATS_BINARY \endlink, the fields are sent little endian in this order,
+ *        after 'S', \link STATS_VERSION \endlink and the node id (2 bytes), and followed by
+ *        the sum of the previous bytes (2 bytes). seq_no and rx_cnt take 4 and 1 bytes,
+ *        the other fields 4 bytes if unsigned long, 2 bytes otherwise.
+ */
+typedef struct {
+	unsigned long seq_no;           /**< Sequence number of the last packet. */
+	uint8_t rx_cnt;                 /**< Number of receptions in the last Glossy phase. */
+	unsigned long latency_us;       /**< Latency of the last received packet, in us. */
+	unsigned long packets_received; /**< Number of received packets. */
+	unsigned long packets_missed;   /**< Number of missed packets. */
+	unsigned long avg_rel;          /**< Average reliability, in 1/1000 %. */
+	unsigned long avg_latency_us;   /**< Average latency, in us. */
+	unsigned long avg_radio_on_us;  /**< Average radio-on time per period, in us (Energest). */
+	uint16_t avg_ntx;               /**< Average N_TX, in 1/100 (\link ADAPTIVE_N_TX \endlink). */
+	unsigned long avg_saved_us;     /**< Average radio-on time saved by adapting N_TX, in us. */
+	uint16_t avg_wakeup_slots;      /**< Average wake-up delay, in 1/100 slots (\link HOP_AWARE_WAKEUP \endlink). */
+	int period_skew;                /**< Clock skew over a period, in ticks of low-frequency clock. */
+	uint16_t guard_us;              /**< Guard-time, in us. */
+	unsigned long lat_win_us[4];    /**< Latency percentiles (50th, 90th, 99th) and maximum over the last
+	                                     \link LATENCY_WINDOW \endlink received packets, in us
+	                                     (upper bounds of the histogram buckets). */
+	unsigned long lat_all_us[4];    /**< Latency percentiles and maximum over all received packets, in us
+	                                     (the maximum is exact). */
+} glossy_stats_struct;
+
+/**
+ * \brief Version of \link sync_checkpoint_struct \endlink, to be increased whenever
+ *        its format changes.
+ */
+#define SYNC_CHECKPOINT_VERSION 3
+
+/**
+ * \brief Data structure used to store the synchronization state in the external flash.
+ *
+ *        Records are appended to one of the two sectors at \link SYNC_CHECKPOINT_XMEM_OFFSET \endlink.
+ *        When it is full, they continue in the other sector, and the full one is erased right
+ *        after the first record is written there. A sector erase takes up to 3 s, which is why
+ *        it runs in background between two checkpoints (\link SYNC_CHECKPOINT_PERIOD \endlink
+ *        must be longer), and why the latest record always survives a power loss during the
+ *        erase. The reference time is not stored: the clocks restart from zero at reboot.
+ */
+typedef struct {
+	uint16_t magic;       /**< Not zero, \link SYNC_CHECKPOINT_MAGIC \endlink (erased flash reads as zero). */
+	uint8_t version;      /**< \link SYNC_CHECKPOINT_VERSION \endlink. */
+	uint8_t hop;          /**< Relay counter of the first reception (\link get_relay_cnt \endlink). */
+	uint32_t period;      /**< \link GLOSSY_PERIOD \endlink the skew refers to. */
+	rtimer_clock_t T_slot_h; /**< Slot length (\link get_T_slot_h \endlink). */
+	int period_skew;      /**< Clock skew over a period. */
+	uint16_t seq;         /**< Sequence number, tells the current sector after a reboot during an erase. */
+	uint16_t checksum;    /**< Checksum of the fields above. */
+} sync_checkpoint_struct;
+
 /** @} */
 
 /**
@@ -141,6 +361,48 @@ typedef struct {
  */
 #define DATA_LEN                    sizeof(glossy_data_struct)
 
+/**
+ * \brief Convert a duration from ticks of low-frequency clock to microseconds
+ *        (up to 2^32 us, no floating-point arithmetic).
+ */
+#define TICKS_TO_US(t)              ((unsigned long)(t) / (RTIMER_SECOND / 64) * (1000000UL / 64) + \
+                                     (unsigned long)(t) % (RTIMER_SECOND / 64) * (1000000UL / 64) / (RTIMER_SECOND / 64))
+
+/**
+ * \brief Number of buckets of the latency histograms: 8 per power of two (3 bits of mantissa),
+ *        up to \link LATENCY_MAX_TICKS \endlink.
+ */
+#define LATENCY_BUCKETS             88
+
+/**
+ * \brief Latencies from this value on, in ticks of low-frequency clock, fall in the last bucket.
+ */
+#define LATENCY_MAX_TICKS           8192
+
+/**
+ * \brief SLIP special characters, used to frame binary records.
+ */
+#define SLIP_END                    0300
+#define SLIP_ESC                    0333
+#define SLIP_ESC_END                0334
+#define SLIP_ESC_ESC                0335
+
+/**
+ * \brief Marker of the records of \link sync_checkpoint_struct \endlink.
+ */
+#define SYNC_CHECKPOINT_MAGIC       0x5943
+
+/**
+ * \brief Number of records of \link sync_checkpoint_struct \endlink that fit in a flash sector.
+ */
+#define SYNC_CHECKPOINT_RECORDS     (XMEM_ERASE_UNIT_SIZE / sizeof(sync_checkpoint_struct))
+
+/**
+ * \brief Address in the external flash of record \p i of checkpoint sector \p s (0 or 1).
+ */
+#define SYNC_CHECKPOINT_RECORD_ADDR(s, i) (SYNC_CHECKPOINT_XMEM_OFFSET + (s) * XMEM_ERASE_UNIT_SIZE + \
+                                          (unsigned long)(i) * sizeof(sync_checkpoint_struct))
+
 /**
  * \brief Check if the nodeId matches the one of the initiator.
  */
@@ -162,10 +424,10 @@ typedef struct {
 #define GLOSSY_IS_SYNCED()          (is_t_ref_l_updated())
 
 /**
- * \brief Get Glossy reference time.
- * \sa \link get_t_ref_l \endlink
+ * \brief Get Glossy reference time, on the extended clock.
+ * \sa \link get_t_ref_ext \endlink
  */
-#define GLOSSY_REFERENCE_TIME       (get_t_ref_l())
+#define GLOSSY_REFERENCE_TIME       (get_t_ref_ext())
 
 /** @} */
 
@@ -42,34 +42,16 @@
 #define CM_POS              CM_1
 #define CM_NEG              CM_2
 #define CM_BOTH             CM_3
+// FIFOP is high while the RXFIFO holds more than FIFOP_THR bytes
+#define FIFOP_THR(n)        ((n) & 0x7f)
 
-typedef struct {
-	unsigned long seq_no; /**< Sequence number, incremented by the initiator at each Glossy phase. */
-	unsigned short logs[20];
-} glossy_data_struct;
-
-static unsigned short id;
-
-static uint8_t initiator, sync, rx_cnt, tx_cnt, tx_max;
-static uint8_t *data, *packet;
-static uint8_t data_len, packet_len, packet_len_tmp, header;
-static uint8_t bytes_read, tx_relay_cnt_last, n_timeouts;
-static volatile uint8_t state;
-static rtimer_clock_t t_rx_start, t_rx_stop, t_tx_start, t_tx_stop, t_start;
-static rtimer_clock_t t_rx_timeout;
-static rtimer_clock_t T_irq;
-static rtimer_clock_t t_stop;
-static rtimer_callback_t cb;
-static struct rtimer *rtimer;
-static void *ptr;
-static unsigned short ie1, ie2, p1ie, p2ie, tbiv;
-
-static rtimer_clock_t T_slot_h, T_rx_h, T_w_rt_h, T_tx_h, T_w_tr_h, t_ref_l, T_offset_h, t_first_rx_l;
-#if GLOSSY_SYNC_WINDOW
-static unsigned long T_slot_h_sum;
-static uint8_t win_cnt;
-#endif /* GLOSSY_SYNC_WINDOW */
-static uint8_t relay_cnt, t_ref_l_updated;
+static struct glossy_ctx ctx_default;
+#if GLOSSY_MULTI_CTX
+static struct glossy_ctx *ctx = &ctx_default;
+#else
+// single instance: the state has a constant address, as with file-scope variables
+#define ctx (&ctx_default)
+#endif /* GLOSSY_MULTI_CTX */
 
 /* --------------------------- Radio functions ---------------------- */
 static inline void radio_flush_tx(void) {
@@ -108,7 +90,7 @@ static inline void radio_flush_rx(void) {
 }
 
 static inline void radio_abort_rx(void) {
-	state = GLOSSY_STATE_ABORTED;
+	ctx->state = GLOSSY_STATE_ABORTED;
 	radio_flush_rx();
 }
 
@@ -132,9 +114,349 @@ static inline void radio_start_tx(void) {
 }
 
 static inline void radio_write_tx(void) {
-	FASTSPI_WRITE_FIFO(packet, packet_len_tmp - 1);
+	FASTSPI_WRITE_FIFO(ctx->packet, GLOSSY_PKT_LEN_TMP - 1);
+}
+
+/* --------------------------- Path trace --------------------------- */
+#if GLOSSY_PATH_TRACE
+static inline void glossy_path_record(uint8_t slot) {
+	// constant time: the slot index gives the position in the trace,
+	// which must lie within both the trace and the flooding data
+	if (slot < GLOSSY_PATH_LEN && GLOSSY_PATH_OFFSET + slot < GLOSSY_PKT_LEN_TMP -
+			(FOOTER_LEN + GLOSSY_RELAY_CNT_LEN + GLOSSY_HEADER_LEN)) {
+		GLOSSY_PATH_FIELD(slot) = (glossy_path_id_t)ctx->id;
+	}
+}
+#endif /* GLOSSY_PATH_TRACE */
+
+/* --------------------------- Event trace -------------------------- */
+#if GLOSSY_TRACE
+// a few stores, no branches: cheap enough for the interrupt handlers
+#define GLOSSY_TRACE_EVENT(ev, t) do { \
+	struct glossy_trace_record *r_ = &ctx->trace[ctx->trace_cnt++ & (GLOSSY_TRACE_LEN - 1)]; \
+	r_->event = ((ev) << 4) | ctx->state; \
+	r_->relay_cnt = GLOSSY_RELAY_CNT_FIELD; \
+	r_->t_cap = (t); \
+	r_->T_irq = ctx->T_irq; \
+	r_->tbiv = ctx->tbiv; \
+} while (0)
+
+static void glossy_trace_putc(uint8_t c, uint16_t *sum) {
+	*sum += c;
+	// SLIP escaping
+	if (c == 0xc0) {
+		putchar(0xdb);
+		putchar(0xdc);
+	} else if (c == 0xdb) {
+		putchar(0xdb);
+		putchar(0xdd);
+	} else {
+		putchar(c);
+	}
+}
+#else
+#define GLOSSY_TRACE_EVENT(ev, t)
+#endif /* GLOSSY_TRACE */
+
+/* --------------------------- Burst -------------------------------- */
+static inline unsigned long glossy_slot_length(void) {
+	// slot length in DCO ticks: use the estimation, if available
+	if (GLOSSY_SYNC_MODE && ctx->T_slot_h) {
+		return (unsigned long)ctx->T_slot_h + (GLOSSY_PKT_LEN * F_CPU) / 31250;
+	} else {
+		return ((unsigned long)GLOSSY_PKT_LEN * 35 + 400) * 4;
+	}
+}
+
+static inline void glossy_burst_load(void) {
+	uint8_t len = ctx->data_len - GLOSSY_BURST_IDX_LEN;
+	// copy the next packet of the queue to the data field
+	memcpy(&GLOSSY_DATA_FIELD, ctx->data + (unsigned short)ctx->burst_idx * len, len);
+	GLOSSY_BURST_IDX_FIELD = ctx->burst_idx;
+	ctx->burst_next = ctx->burst_idx + 1;
+	if (GLOSSY_SYNC_MODE) {
+		// each packet is flooded with its own relay counter
+		GLOSSY_RELAY_CNT_FIELD = 0;
+#if GLOSSY_PATH_TRACE
+		glossy_path_record(0);
+#endif /* GLOSSY_PATH_TRACE */
+	}
+}
+
+static inline void glossy_burst_store(void) {
+	uint8_t len = ctx->data_len - GLOSSY_BURST_IDX_LEN;
+	// copy the received packet to its place in the queue and mark it
+	memcpy(ctx->data + (unsigned short)ctx->burst_idx * len, &GLOSSY_DATA_FIELD, len);
+	if (ctx->burst_bitmap) {
+		ctx->burst_bitmap[ctx->burst_idx >> 3] |= 1 << (ctx->burst_idx & 7);
+	}
+	ctx->burst_new = 0;
+}
+
+static inline void glossy_burst_step(void) {
+	// Timer B wraps around after 2^16 DCO ticks: wait at most half of it at a time
+	unsigned short step = (ctx->burst_wait > 0x8000) ? 0x8000 : ctx->burst_wait;
+	TBCCR4 += step;
+	ctx->burst_wait -= step;
+	TBCCTL4 = CCIE;
+}
+
+static inline void glossy_schedule_burst_packet(void) {
+	// the next packet starts when the flood of the current one has left
+	// the neighborhood of the initiator: receivers n hops away relay the
+	// current packet until slot 2 * tx_max + n - 2 and receive the next one
+	// in slot 2 * tx_max + n
+	ctx->burst_wait = GLOSSY_BURST_SLOTS(ctx->tx_max) * glossy_slot_length();
+	glossy_burst_step();
+}
+
+static inline void glossy_burst_timer(void) {
+	if (ctx->burst_wait) {
+		// the next packet is not due yet
+		glossy_burst_step();
+		return;
+	}
+	if (ctx->state != GLOSSY_STATE_WAITING) {
+		// still busy with the previous packet: try again a bit later
+		TBCCR4 += GLOSSY_BURST_RETRY_H;
+		return;
+	}
+	// start flooding the next packet
+	ctx->burst_idx++;
+	ctx->tx_cnt = 0;
+	glossy_burst_load();
+	ctx->state = GLOSSY_STATE_RECEIVED;
+	radio_write_tx();
+	radio_start_tx();
+	if (ctx->burst_idx + 1 < ctx->burst_len) {
+		glossy_schedule_burst_packet();
+	} else {
+		TBCCTL4 = 0;
+	}
+}
+
+/* --------------------------- Aggregation -------------------------- */
+#define GET_U16(p)          ((uint16_t)(p)[0] | ((uint16_t)(p)[1] << 8))
+
+static uint8_t merge_or_u8(uint8_t *acc, const uint8_t *in, uint8_t len) {
+	uint8_t changed = 0;
+	for (; len; len--, acc++, in++) {
+		if (*in & ~*acc) {
+			*acc |= *in;
+			changed = 1;
+		}
+	}
+	return changed;
+}
+
+static uint8_t merge_max_u8(uint8_t *acc, const uint8_t *in, uint8_t len) {
+	uint8_t changed = 0;
+	for (; len; len--, acc++, in++) {
+		if (*in > *acc) {
+			*acc = *in;
+			changed = 1;
+		}
+	}
+	return changed;
+}
+
+static uint8_t merge_max_u16(uint8_t *acc, const uint8_t *in, uint8_t len) {
+	uint8_t changed = 0;
+	for (; len > 1; len -= 2, acc += 2, in += 2) {
+		if (GET_U16(in) > GET_U16(acc)) {
+			acc[0] = in[0];
+			acc[1] = in[1];
+			changed = 1;
+		}
+	}
+	return changed;
+}
+
+static uint8_t merge_min_u8(uint8_t *acc, const uint8_t *in, uint8_t len) {
+	uint8_t changed = 0;
+	for (; len; len--, acc++, in++) {
+		if (*in < *acc) {
+			*acc = *in;
+			changed = 1;
+		}
+	}
+	return changed;
+}
+
+static uint8_t merge_min_u16(uint8_t *acc, const uint8_t *in, uint8_t len) {
+	uint8_t changed = 0;
+	for (; len > 1; len -= 2, acc += 2, in += 2) {
+		if (GET_U16(in) < GET_U16(acc)) {
+			acc[0] = in[0];
+			acc[1] = in[1];
+			changed = 1;
+		}
+	}
+	return changed;
+}
+
+const struct glossy_merge_op glossy_op_or_u8 = {merge_or_u8};
+const struct glossy_merge_op glossy_op_max_u8 = {merge_max_u8};
+const struct glossy_merge_op glossy_op_max_u16 = {merge_max_u16};
+const struct glossy_merge_op glossy_op_min_u8 = {merge_min_u8};
+const struct glossy_merge_op glossy_op_min_u16 = {merge_min_u16};
+
+static inline uint8_t glossy_agg_flags_full(void) {
+	uint8_t i;
+	for (i = 0; i < (ctx->agg_n_nodes >> 3); i++) {
+		if (ctx->agg_flags[i] != 0xff) {
+			return 0;
+		}
+	}
+	return ((ctx->agg_n_nodes & 7) == 0) || (ctx->agg_flags[i] == (1 << (ctx->agg_n_nodes & 7)) - 1);
+}
+
+static inline void glossy_agg_load(void) {
+	// copy the local aggregate and completion flags to the packet
+	memcpy(&GLOSSY_DATA_FIELD, ctx->data, ctx->agg_len);
+	memcpy(&GLOSSY_AGG_FLAGS_FIELD, ctx->agg_flags, ctx->agg_flags_len);
+}
+
+static inline uint8_t glossy_agg_merge(void) {
+	// merge the received aggregate into the local one:
+	// returns not zero if there is something new to spread
+	uint8_t *in_flags = &GLOSSY_AGG_FLAGS_FIELD;
+	uint8_t i, new_in = 0, new_local = 0;
+	for (i = 0; i < ctx->agg_flags_len; i++) {
+		new_in |= in_flags[i] & ~ctx->agg_flags[i];
+	}
+	if (new_in) {
+		// merge the two aggregates (the operator is idempotent:
+		// contributions known to both sides do not count twice)
+		ctx->agg_op->merge(ctx->data, &GLOSSY_DATA_FIELD, ctx->agg_len);
+		for (i = 0; i < ctx->agg_flags_len; i++) {
+			ctx->agg_flags[i] |= in_flags[i];
+		}
+		ctx->agg_complete = glossy_agg_flags_full();
+	}
+	for (i = 0; i < ctx->agg_flags_len; i++) {
+		new_local |= ctx->agg_flags[i] & ~in_flags[i];
+	}
+	if (new_local) {
+		// the packet lacks contributions the node knows: relay its aggregate
+		glossy_agg_load();
+	}
+	return new_in | new_local;
+}
+
+/* --------------------------- Channel hopping ---------------------- */
+static inline void glossy_hopping_switch(void) {
+	// frequency of the channel, as in cc2420_set_channel()
+	uint16_t f = 5 * (glossy_hopping_channel(ctx->hop_seq) - GLOSSY_HOPPING_FIRST_CHANNEL) + 357 + 0x4000;
+	if (f != ctx->hop_fsctrl) {
+		// the synthesizer is calibrated with the new frequency
+		// by the next SRXON or STXON
+		FASTSPI_SETREG(CC2420_FSCTRL, f);
+		ctx->hop_fsctrl = f;
+	}
+}
+
+/* --------------------------- Timer events ------------------------- */
+static inline void glossy_initiator_timeout(void) {
+	ctx->n_timeouts++;
+	if (ctx->rx_cnt == 0) {
+		// no packets received so far: send the packet again
+		ctx->tx_cnt = 0;
+		// set the packet length field to the appropriate value
+		GLOSSY_LEN_FIELD = GLOSSY_PKT_LEN_TMP;
+		// set the header field
+		GLOSSY_HEADER_FIELD = GLOSSY_HEADER | (ctx->header & ~GLOSSY_HEADER_MASK);
+		if (GLOSSY_SYNC_MODE) {
+			GLOSSY_RELAY_CNT_FIELD = ctx->n_timeouts * GLOSSY_INITIATOR_TIMEOUT;
+		}
+		// copy the application data to the data field
+		if (ctx->agg_op) {
+			glossy_agg_load();
+		} else {
+			memcpy(&GLOSSY_DATA_FIELD, ctx->data, ctx->data_len);
+		}
+#if GLOSSY_PATH_TRACE
+		if (GLOSSY_SYNC_MODE) {
+			glossy_path_record(GLOSSY_RELAY_CNT_FIELD);
+		}
+#endif /* GLOSSY_PATH_TRACE */
+		// set Glossy state
+		ctx->state = GLOSSY_STATE_RECEIVED;
+		// write the packet to the TXFIFO
+		radio_write_tx();
+		// start another transmission
+		radio_start_tx();
+		// schedule the timeout again
+		glossy_schedule_initiator_timeout();
+	} else {
+		// at least one packet has been received: just stop the timeout
+		glossy_stop_initiator_timeout();
+	}
+}
+
+static void glossy_timer(void) {
+	GLOSSY_TRACE_EVENT(GLOSSY_TRACE_TIMER, RTIMER_NOW_DCO());
+	switch (ctx->tbiv) {
+	case TBIV_TBCCR4:
+		if (ctx->burst_len) {
+			// burst: time to start flooding the next packet
+			glossy_burst_timer();
+			return;
+		}
+		if (ctx->state == GLOSSY_STATE_WAITING) {
+			// initiator timeout
+			glossy_initiator_timeout();
+			return;
+		}
+		break;
+	case TBIV_TBCCR5:
+		// rx timeout
+		if (ctx->state == GLOSSY_STATE_RECEIVING) {
+			// we are still trying to receive a packet: abort the reception
+			radio_abort_rx();
+#if GLOSSY_DEBUG
+			rx_timeout++;
+#endif /* GLOSSY_DEBUG */
+		}
+		// stop the timeout
+		glossy_stop_rx_timeout();
+		return;
+	}
+	if (ctx->state != GLOSSY_STATE_OFF) {
+		// something strange is going on: go back to the waiting state
+		radio_flush_rx();
+		ctx->state = GLOSSY_STATE_WAITING;
+	}
 }
 
+static void glossy_aborted(void) {
+	// packet reception has been aborted
+	ctx->state = GLOSSY_STATE_WAITING;
+}
+
+// events of the SFD interrupt: state and SFD level
+#define GLOSSY_EVENT(state, sfd)      (((state) << 1) | (sfd))
+// the end of a reception, relayed by timerb1_interrupt itself
+#define GLOSSY_EVENT_END_RX           GLOSSY_EVENT(GLOSSY_STATE_RECEIVING, 0)
+
+// handlers of the other events, indexed by GLOSSY_EVENT(state, SFD level)
+static void (* const glossy_dispatch[])(void) = {
+	glossy_timer,    // OFF
+	glossy_timer,
+	glossy_timer,    // WAITING
+	glossy_begin_rx, // WAITING, SFD high: packet reception has started
+	glossy_timer,    // RECEIVING, SFD low: handled before the dispatch (relay)
+	glossy_timer,    // RECEIVING, SFD high
+	glossy_timer,    // RECEIVED
+	glossy_begin_tx, // RECEIVED, SFD high: packet transmission has started
+	glossy_end_tx,   // TRANSMITTING, SFD low: packet transmission has finished
+	glossy_timer,    // TRANSMITTING, SFD high
+	glossy_timer,    // TRANSMITTED
+	glossy_timer,
+	glossy_aborted,  // ABORTED
+	glossy_aborted,
+};
+
 /* --------------------------- SFD interrupt ------------------------ */
 interrupt(TIMERB1_VECTOR) __attribute__ ((section(".glossy")))
 timerb1_interrupt(void)
@@ -142,16 +464,25 @@ timerb1_interrupt(void)
 	// NOTE: if you modify the code if this function
 	// you may need to change the constant part of the interrupt delay (currently 21 DCO ticks),
 	// due to possible different compiler optimizations
+	// (tools/sky/glossy-isr-check checks it, e.g., make TARGET=sky GLOSSY_ISR_CHECK=1)
 
 	// compute the variable part of the delay with which the interrupt has been served
-	T_irq = ((RTIMER_NOW_DCO() - TBCCR1) - 21) << 1;
+	ctx->T_irq = ((RTIMER_NOW_DCO() - TBCCR1) - 21) << 1;
 
-	if (state == GLOSSY_STATE_RECEIVING && !SFD_IS_1) {
+	// one comparison selects the relay path, one table lookup any other event:
+	// the entry cost is the same whatever the event
+	uint8_t event = GLOSSY_EVENT(ctx->state, SFD_IS_1);
+	if (event == GLOSSY_EVENT_END_RX) {
 		// packet reception has finished
 		// T_irq in [0,...,8]
-		if (T_irq <= 8) {
+		if (ctx->T_irq <= 8) {
+#if CONTIKI_TARGET_NATIVE
+			// no NOP sled on the host: wait for as many DCO ticks as the
+			// NOPs below would take (5 - T_irq / 2 variable, 8 fixed)
+			rtimer_arch_delay_dco(13 - (ctx->T_irq >> 1));
+#else
 			// NOPs (variable number) to compensate for the interrupt service delay (sec. 5.2)
-			asm volatile("add %[d], r0" : : [d] "m" (T_irq));
+			asm volatile("add %[d], r0" : : [d] "m" (ctx->T_irq));
 			asm volatile("nop");						// irq_delay = 0
 			asm volatile("nop");						// irq_delay = 2
 			asm volatile("nop");						// irq_delay = 4
@@ -167,111 +498,65 @@ timerb1_interrupt(void)
 			asm volatile("nop");
 			asm volatile("nop");
 			asm volatile("nop");
+#endif /* CONTIKI_TARGET_NATIVE */
 			// relay the packet
 			radio_start_tx();
 			// read TBIV to clear IFG
-			tbiv = TBIV;
+			ctx->tbiv = TBIV;
 			glossy_end_rx();
 		} else {
 			// interrupt service delay is too high: do not relay the packet
 			radio_flush_rx();
-			state = GLOSSY_STATE_WAITING;
 			// read TBIV to clear IFG
-			tbiv = TBIV;
+			ctx->tbiv = TBIV;
+			GLOSSY_TRACE_EVENT(GLOSSY_TRACE_LATE_RX, TBCCR1);
+			ctx->state = GLOSSY_STATE_WAITING;
 		}
 	} else {
 		// read TBIV to clear IFG
-		tbiv = TBIV;
-		if (state == GLOSSY_STATE_WAITING && SFD_IS_1) {
-			// packet reception has started
-			glossy_begin_rx();
-		} else {
-			if (state == GLOSSY_STATE_RECEIVED && SFD_IS_1) {
-				// packet transmission has started
-				glossy_begin_tx();
-			} else {
-				if (state == GLOSSY_STATE_TRANSMITTING && !SFD_IS_1) {
-					// packet transmission has finished
-					glossy_end_tx();
-				} else {
-					if (state == GLOSSY_STATE_ABORTED) {
-						// packet reception has been aborted
-						state = GLOSSY_STATE_WAITING;
-					} else {
-						if ((state == GLOSSY_STATE_WAITING) && (tbiv == TBIV_TBCCR4)) {
-							// initiator timeout
-							n_timeouts++;
-							if (rx_cnt == 0) {
-								// no packets received so far: send the packet again
-								tx_cnt = 0;
-								// set the packet length field to the appropriate value
-								GLOSSY_LEN_FIELD = packet_len_tmp;
-								// set the header field
-								GLOSSY_HEADER_FIELD = GLOSSY_HEADER | (header & ~GLOSSY_HEADER_MASK);
-								if (sync) {
-									GLOSSY_RELAY_CNT_FIELD = n_timeouts * GLOSSY_INITIATOR_TIMEOUT;
-								}
-								// copy the application data to the data field
-								memcpy(&GLOSSY_DATA_FIELD, data, data_len);
-								// set Glossy state
-								state = GLOSSY_STATE_RECEIVED;
-								// write the packet to the TXFIFO
-								radio_write_tx();
-								// start another transmission
-								radio_start_tx();
-								// schedule the timeout again
-								glossy_schedule_initiator_timeout();
-							} else {
-								// at least one packet has been received: just stop the timeout
-								glossy_stop_initiator_timeout();
-							}
-						} else {
-							if (tbiv == TBIV_TBCCR5) {
-								// rx timeout
-								if (state == GLOSSY_STATE_RECEIVING) {
-									// we are still trying to receive a packet: abort the reception
-									radio_abort_rx();
-#if GLOSSY_DEBUG
-									rx_timeout++;
-#endif /* GLOSSY_DEBUG */
-								}
-								// stop the timeout
-								glossy_stop_rx_timeout();
-							} else {
-								if (state != GLOSSY_STATE_OFF) {
-									// something strange is going on: go back to the waiting state
-									radio_flush_rx();
-									state = GLOSSY_STATE_WAITING;
-								}
-							}
-						}
-					}
-				}
-			}
-		}
+		ctx->tbiv = TBIV;
+		glossy_dispatch[event]();
 	}
 }
 
+#if GLOSSY_RX_FIFOP
+/* -------------------------- FIFOP interrupt ----------------------- */
+interrupt(PORT1_VECTOR)
+port1_interrupt(void)
+{
+	if (P1IFG & BV(FIFO_P)) {
+		CLEAR_FIFOP_INT();
+		// the RXFIFO holds the next chunk of the packet being received
+		glossy_rx_fifop();
+	}
+}
+#endif /* GLOSSY_RX_FIFOP */
+
 /* --------------------------- Glossy process ----------------------- */
 PROCESS(glossy_process, "Glossy busy-waiting process");
 PROCESS_THREAD(glossy_process, ev, data) {
 	PROCESS_BEGIN();
 
+	// the Glossy phase and its callback come before any other work
+	// (e.g., printing the statistics of the previous phase)
+	process_set_prio(PROCESS_CURRENT(), PROCESS_PRIO_HIGH);
+
+	// packet buffer of the default instance (glossy_ctx_bind() allocates the others)
 	do {
-		packet = (uint8_t *) malloc(128);
-	} while (packet == NULL);
+		ctx_default.packet = (uint8_t *) malloc(128);
+	} while (ctx_default.packet == NULL);
 
 	while (1) {
 		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
 		// prevent the Contiki main cycle to enter the LPM mode or
 		// any other process to run while Glossy is running
-		while (GLOSSY_IS_ON() && RTIMER_CLOCK_LT(RTIMER_NOW(), t_stop));
+		while (GLOSSY_IS_ON() && RTIMER_CLOCK_LT(RTIMER_NOW(), ctx->t_stop));
 #if COOJA
-		while (state == GLOSSY_STATE_TRANSMITTING);
+		while (ctx->state == GLOSSY_STATE_TRANSMITTING);
 #endif /* COOJA */
 		// Glossy finished: execute the callback function
 		dint();
-		cb(rtimer, ptr);
+		ctx->cb(ctx->rtimer, ctx->ptr);
 		eint();
 	}
 
@@ -280,10 +565,10 @@ PROCESS_THREAD(glossy_process, ev, data) {
 
 static inline void glossy_disable_other_interrupts(void) {
     int s = splhigh();
-	ie1 = IE1;
-	ie2 = IE2;
-	p1ie = P1IE;
-	p2ie = P2IE;
+	ctx->ie1 = IE1;
+	ctx->ie2 = IE2;
+	ctx->p1ie = P1IE;
+	ctx->p2ie = P2IE;
 	IE1 = 0;
 	IE2 = 0;
 	P1IE = 0;
@@ -311,10 +596,10 @@ static inline void glossy_disable_other_interrupts(void) {
 
 static inline void glossy_enable_other_interrupts(void) {
 	int s = splhigh();
-	IE1 = ie1;
-	IE2 = ie2;
-	P1IE = p1ie;
-	P2IE = p2ie;
+	IE1 = ctx->ie1;
+	IE2 = ctx->ie2;
+	P1IE = ctx->p1ie;
+	P2IE = ctx->p2ie;
 	// enable etimer interrupts
 	TACCTL1 |= CCIE;
 #if COOJA
@@ -324,6 +609,10 @@ static inline void glossy_enable_other_interrupts(void) {
 #endif
 	DISABLE_SFD_INT();
 	CLEAR_SFD_INT();
+#if GLOSSY_RX_FIFOP
+	// FIFOP threshold as set by cc2420_init()
+	FASTSPI_SETREG(CC2420_IOCFG0, FIFOP_THR(127));
+#endif /* GLOSSY_RX_FIFOP */
 	FIFOP_INT_INIT();
 	ENABLE_FIFOP_INT();
 	// stop Timer B
@@ -337,58 +626,117 @@ static inline void glossy_enable_other_interrupts(void) {
 }
 
 /* --------------------------- Main interface ----------------------- */
-void glossy_start(uint8_t *data_, uint8_t data_len_, uint8_t initiator_,
+// Glossy phase without the node, after invalid arguments: the radio stays off
+// and the callback is executed right away, so that glossy_stop() restores the
+// interrupts and reports that nothing was received.
+static uint8_t glossy_start_failed(uint8_t status, rtimer_clock_t t_stop_,
+		rtimer_callback_t cb_, struct rtimer *rtimer_, void *ptr_) {
+	ctx->t_stop = t_stop_;
+	ctx->cb = cb_;
+	ctx->rtimer = rtimer_;
+	ctx->ptr = ptr_;
+	glossy_disable_other_interrupts();
+	ctx->tx_cnt = 0;
+	ctx->rx_cnt = 0;
+	ctx->t_ref_l_updated = 0;
+	ctx->state = GLOSSY_STATE_OFF;
+	process_poll(&glossy_process);
+	return status;
+}
+
+static uint8_t glossy_start_phase(uint8_t *data_, uint8_t data_len_, uint8_t initiator_,
 		uint8_t sync_, uint8_t tx_max_, uint8_t header_,
 		rtimer_clock_t t_stop_, rtimer_callback_t cb_,
 		struct rtimer *rtimer_, void *ptr_, unsigned short id_) {
+	// the arguments fixed at build time must match
+#if GLOSSY_RECEIVER_ONLY
+	if (initiator_) {
+		return glossy_start_failed(GLOSSY_START_ERR_ROLE, t_stop_, cb_, rtimer_, ptr_);
+	}
+#endif /* GLOSSY_RECEIVER_ONLY */
+#if GLOSSY_FIXED_SYNC >= 0
+	if ((sync_ != 0) != GLOSSY_FIXED_SYNC) {
+		return glossy_start_failed(GLOSSY_START_ERR_SYNC, t_stop_, cb_, rtimer_, ptr_);
+	}
+#endif /* GLOSSY_FIXED_SYNC */
+#if GLOSSY_FIXED_PACKET_LEN
+	if ((data_len_) && (data_len_ + FOOTER_LEN + GLOSSY_HEADER_LEN +
+			((sync_) ? GLOSSY_RELAY_CNT_LEN : 0) != GLOSSY_FIXED_PACKET_LEN)) {
+		return glossy_start_failed(GLOSSY_START_ERR_LEN, t_stop_, cb_, rtimer_, ptr_);
+	}
+#endif /* GLOSSY_FIXED_PACKET_LEN */
 	// copy function arguments to the respective Glossy variables
-	data = data_;
-	data_len = data_len_;
-	initiator = initiator_;
-	sync = sync_;
-	tx_max = tx_max_;
-	header = header_;
-	t_stop = t_stop_;
-	cb = cb_;
-	rtimer = rtimer_;
-	ptr = ptr_;
-	id = id_;
+	ctx->data = data_;
+	ctx->data_len = data_len_;
+	ctx->initiator = initiator_;
+	ctx->sync = sync_;
+	ctx->tx_max = tx_max_;
+	ctx->header = header_;
+	ctx->t_stop = t_stop_;
+	ctx->cb = cb_;
+	ctx->rtimer = rtimer_;
+	ctx->ptr = ptr_;
+	ctx->id = id_;
 	// disable all interrupts that may interfere with Glossy
 	glossy_disable_other_interrupts();
 	// initialize Glossy variables
-	tx_cnt = 0;
-	rx_cnt = 0;
+	ctx->tx_cnt = 0;
+	ctx->rx_cnt = 0;
+#if GLOSSY_TRACE
+	ctx->trace_cnt = 0;
+#endif /* GLOSSY_TRACE */
 
-	t_start = RTIMER_NOW_DCO();
+	ctx->t_start = RTIMER_NOW_DCO();
 	// set Glossy packet length, with or without relay counter depending on the sync flag value
-	if (data_len) {
-		packet_len_tmp = (sync) ?
-				data_len + FOOTER_LEN + GLOSSY_RELAY_CNT_LEN + GLOSSY_HEADER_LEN :
-				data_len + FOOTER_LEN + GLOSSY_HEADER_LEN;
-		packet_len = packet_len_tmp;
+	if (ctx->data_len) {
+		ctx->packet_len_tmp = (GLOSSY_SYNC_MODE) ?
+				ctx->data_len + FOOTER_LEN + GLOSSY_RELAY_CNT_LEN + GLOSSY_HEADER_LEN :
+				ctx->data_len + FOOTER_LEN + GLOSSY_HEADER_LEN;
+		ctx->packet_len = GLOSSY_PKT_LEN_TMP;
 		// set the packet length field to the appropriate value
-		GLOSSY_LEN_FIELD = packet_len_tmp;
+		GLOSSY_LEN_FIELD = GLOSSY_PKT_LEN_TMP;
 		// set the header field
-		GLOSSY_HEADER_FIELD = GLOSSY_HEADER | (header & ~GLOSSY_HEADER_MASK);
+		GLOSSY_HEADER_FIELD = GLOSSY_HEADER | (ctx->header & ~GLOSSY_HEADER_MASK);
 	} else {
 		// packet length not known yet (only for receivers)
-		packet_len = 0;
+		ctx->packet_len = 0;
 	}
-	if (initiator) {
+	if (GLOSSY_ROLE_INITIATOR) {
 		// initiator: copy the application data to the data field
-		memcpy(&GLOSSY_DATA_FIELD, data, data_len);
+		if (ctx->burst_len) {
+			glossy_burst_load();
+		} else {
+			if (ctx->agg_op) {
+				glossy_agg_load();
+			} else {
+				memcpy(&GLOSSY_DATA_FIELD, ctx->data, ctx->data_len);
+			}
+		}
 		// set Glossy state
-		state = GLOSSY_STATE_RECEIVED;
+		ctx->state = GLOSSY_STATE_RECEIVED;
 	} else {
 		// receiver: set Glossy state
-		memcpy(&GLOSSY_DATA_FIELD, data, data_len);
-		state = GLOSSY_STATE_WAITING;
+		if ((!ctx->burst_len) && (!ctx->agg_op)) {
+			memcpy(&GLOSSY_DATA_FIELD, ctx->data, ctx->data_len);
+		}
+		ctx->state = GLOSSY_STATE_WAITING;
 	}
-	if (sync) {
+	if (GLOSSY_SYNC_MODE) {
 		// set the relay_cnt field to 0
 		GLOSSY_RELAY_CNT_FIELD = 0;
 		// the reference time has not been updated yet
-		t_ref_l_updated = 0;
+		ctx->t_ref_l_updated = 0;
+#if GLOSSY_PATH_TRACE
+		if (GLOSSY_ROLE_INITIATOR) {
+			// the initiator transmits in the first slot
+			glossy_path_record(0);
+		}
+#endif /* GLOSSY_PATH_TRACE */
+	}
+
+	if (ctx->hop_enabled) {
+		// switch channel while the radio is off, before the DCO is resynchronized
+		glossy_hopping_switch();
 	}
 
 #if !COOJA
@@ -399,23 +747,93 @@ void glossy_start(uint8_t *data_, uint8_t data_len_, uint8_t initiator_,
 	// flush radio buffers
 	radio_flush_rx();
 	radio_flush_tx();
-	if (initiator) {
+	if (GLOSSY_ROLE_INITIATOR) {
 		// write the packet to the TXFIFO
 		radio_write_tx();
+		if (ctx->burst_len > 1) {
+			// the following packets are scheduled relative to this transmission
+			TBCCR4 = RTIMER_NOW_DCO();
+		}
 		// start the first transmission
 		radio_start_tx();
-		// schedule the initiator timeout
-		if ((!sync) || T_slot_h) {
-			n_timeouts = 0;
-			glossy_schedule_initiator_timeout();
+		if (ctx->burst_len) {
+			// burst: the initiator does not retransmit, it moves on to the next packet
+			if (ctx->burst_len > 1) {
+				glossy_schedule_burst_packet();
+			}
+		} else {
+			// schedule the initiator timeout
+			if ((!GLOSSY_SYNC_MODE) || ctx->T_slot_h) {
+				ctx->n_timeouts = 0;
+				glossy_schedule_initiator_timeout();
+			}
 		}
 	} else {
-        radio_write_tx();
 		// turn on the radio
 		radio_on();
 	}
 	// activate the Glossy busy waiting process
 	process_poll(&glossy_process);
+	return GLOSSY_START_OK;
+}
+
+uint8_t glossy_start(uint8_t *data_, uint8_t data_len_, uint8_t initiator_,
+		uint8_t sync_, uint8_t tx_max_, uint8_t header_,
+		rtimer_clock_t t_stop_, rtimer_callback_t cb_,
+		struct rtimer *rtimer_, void *ptr_, unsigned short id_) {
+	ctx->burst_len = 0;
+	ctx->agg_op = NULL;
+	return glossy_start_phase(data_, data_len_, initiator_, sync_, tx_max_, header_,
+			t_stop_, cb_, rtimer_, ptr_, id_);
+}
+
+uint8_t glossy_start_burst(uint8_t *data_, uint8_t data_len_, uint8_t n_packets_,
+		uint8_t *bitmap_, uint8_t initiator_,
+		uint8_t sync_, uint8_t tx_max_, uint8_t header_,
+		rtimer_clock_t t_stop_, rtimer_callback_t cb_,
+		struct rtimer *rtimer_, void *ptr_, unsigned short id_) {
+	ctx->agg_op = NULL;
+	ctx->burst_len = n_packets_;
+	ctx->burst_idx = 0;
+	ctx->burst_next = 0;
+	ctx->burst_new = 0;
+	ctx->burst_bitmap = bitmap_;
+	if (ctx->burst_bitmap) {
+		memset(ctx->burst_bitmap, 0, (n_packets_ + 7) / 8);
+	}
+	// the index of the packet in the burst follows the data of each packet
+	return glossy_start_phase(data_, (data_len_) ? data_len_ + GLOSSY_BURST_IDX_LEN : 0,
+			initiator_, sync_, tx_max_, header_, t_stop_, cb_, rtimer_, ptr_, id_);
+}
+
+uint8_t glossy_start_aggregate(uint8_t *data_, uint8_t data_len_, const struct glossy_merge_op *op_,
+		uint8_t *flags_, uint8_t n_nodes_, uint8_t node_idx_, uint8_t initiator_,
+		uint8_t sync_, uint8_t tx_max_, uint8_t header_,
+		rtimer_clock_t t_stop_, rtimer_callback_t cb_,
+		struct rtimer *rtimer_, void *ptr_, unsigned short id_) {
+	if (node_idx_ >= n_nodes_) {
+		// the flag of the node would lie outside the flags of the packet
+		return glossy_start_failed(GLOSSY_START_ERR_NODE_IDX, t_stop_, cb_, rtimer_, ptr_);
+	}
+	ctx->burst_len = 0;
+	ctx->agg_op = op_;
+	ctx->agg_flags = flags_;
+	ctx->agg_len = data_len_;
+	ctx->agg_n_nodes = n_nodes_;
+	ctx->agg_flags_len = (n_nodes_ + 7) / 8;
+	// the local aggregate holds the contribution of this node only
+	memset(ctx->agg_flags, 0, ctx->agg_flags_len);
+	ctx->agg_flags[node_idx_ >> 3] = 1 << (node_idx_ & 7);
+	ctx->agg_complete = glossy_agg_flags_full();
+	// the completion flags follow the aggregate in each packet
+	return glossy_start_phase(data_, data_len_ + ctx->agg_flags_len, initiator_, sync_, tx_max_, header_,
+			t_stop_, cb_, rtimer_, ptr_, id_);
+}
+
+static rtimer_ext_clock_t glossy_time_extend(rtimer_clock_t t_l) {
+	rtimer_ext_clock_t now = RTIMER_NOW_EXT();
+	// t_l is less than 2^15 ticks away from now
+	return now + (signed short)(t_l - (rtimer_clock_t)now);
 }
 
 uint8_t glossy_stop(void) {
@@ -428,74 +846,442 @@ uint8_t glossy_stop(void) {
 	radio_flush_rx();
 	radio_flush_tx();
 
-	state = GLOSSY_STATE_OFF;
+	ctx->state = GLOSSY_STATE_OFF;
 	// re-enable non Glossy-related interrupts
 	glossy_enable_other_interrupts();
+	if (ctx->t_ref_l_updated) {
+		// extend the new reference time while it is close to now
+		ctx->t_ref_ext = glossy_time_extend(ctx->t_ref_l);
+	}
 	// return the number of times the packet has been received
-	return rx_cnt;
+	return ctx->rx_cnt;
 }
 
 uint8_t get_rx_cnt(void) {
-	return rx_cnt;
+	return ctx->rx_cnt;
 }
 
 uint8_t get_relay_cnt(void) {
-	return relay_cnt;
+	return ctx->relay_cnt;
 }
 
 rtimer_clock_t get_T_slot_h(void) {
-	return T_slot_h;
+	return ctx->T_slot_h;
+}
+
+rtimer_clock_t get_T_slot_full_h(void) {
+	return (ctx->T_slot_h) ? ctx->T_slot_h + (GLOSSY_PKT_LEN * F_CPU) / 31250 : 0;
 }
 
 uint8_t is_t_ref_l_updated(void) {
-	return t_ref_l_updated;
+	return ctx->t_ref_l_updated;
+}
+
+uint8_t is_agg_complete(void) {
+	return ctx->agg_complete;
 }
 
 rtimer_clock_t get_t_first_rx_l(void) {
-	return t_first_rx_l;
+	return ctx->t_first_rx_l;
 }
 
 rtimer_clock_t get_t_ref_l(void) {
-	return t_ref_l;
+	return ctx->t_ref_l;
 }
 
 void set_t_ref_l(rtimer_clock_t t) {
-	t_ref_l = t;
+	ctx->t_ref_l = t;
+	ctx->t_ref_ext = glossy_time_extend(t);
+}
+
+rtimer_ext_clock_t get_t_ref_ext(void) {
+	return ctx->t_ref_ext;
+}
+
+void set_t_ref_ext(rtimer_ext_clock_t t) {
+	ctx->t_ref_l = t;
+	ctx->t_ref_ext = t;
 }
 
 void set_t_ref_l_updated(uint8_t updated) {
-	t_ref_l_updated = updated;
+	ctx->t_ref_l_updated = updated;
+}
+
+void set_T_slot_h(rtimer_clock_t T_slot) {
+	ctx->T_slot_h = T_slot;
+	ctx->T_slot_h_sum = 0;
+	ctx->win_cnt = 0;
+}
+
+void glossy_hopping_init(unsigned short seed) {
+	ctx->hop_seed = seed;
+	ctx->hop_blacklist = 0;
+	ctx->hop_next_blacklist = 0;
+	ctx->hop_from_seq = 0;
+	ctx->hop_fsctrl = 0;
+	ctx->hop_enabled = 1;
+}
+
+void glossy_hopping_set_seq(unsigned long seq_no) {
+	ctx->hop_seq = seq_no;
+}
+
+void glossy_hopping_set_blacklist(uint16_t blacklist, unsigned long from_seq) {
+	if ((uint16_t)~blacklist) {
+		// the blacklist in force for the current flood is kept until from_seq
+		ctx->hop_blacklist = glossy_hopping_get_blacklist(ctx->hop_seq);
+		ctx->hop_next_blacklist = blacklist;
+		ctx->hop_from_seq = from_seq;
+	}
+}
+
+uint16_t glossy_hopping_get_blacklist(unsigned long seq_no) {
+	// sequence numbers are compared modulo 2^32
+	return ((long)(seq_no - ctx->hop_from_seq) >= 0) ? ctx->hop_next_blacklist : ctx->hop_blacklist;
+}
+
+uint8_t glossy_hopping_channel(unsigned long seq_no) {
+	uint16_t allowed = ~glossy_hopping_get_blacklist(seq_no);
+	uint8_t i, n = 0;
+	// hash the sequence number with the seed
+	unsigned long h = (seq_no ^ ctx->hop_seed) * 2654435761uL;
+	h ^= h >> 16;
+	for (i = 0; i < GLOSSY_HOPPING_N_CHANNELS; i++) {
+		n += (allowed >> i) & 1;
+	}
+	// pick the (h mod n)-th allowed channel
+	n = h % n;
+	for (i = 0; i < GLOSSY_HOPPING_N_CHANNELS; i++) {
+		if ((allowed >> i) & 1) {
+			if (!n) {
+				break;
+			}
+			n--;
+		}
+	}
+	return GLOSSY_HOPPING_FIRST_CHANNEL + i;
+}
+
+void glossy_ntx_init(uint8_t n_min, uint8_t n_max, uint8_t min_rel) {
+	ctx->ntx_min = n_min;
+	ctx->ntx_max = n_max;
+	ctx->ntx_cur = n_max;
+	// misses allowed in the window
+	ctx->ntx_allowed = ((unsigned short)(100 - min_rel) * GLOSSY_NTX_WINDOW) / 100;
+	ctx->ntx_stable = 0;
+	ctx->ntx_hop = 0xff;
+	ctx->ntx_history = 0;
+}
+
+uint8_t glossy_ntx_get(void) {
+	return ctx->ntx_cur;
+}
+
+void glossy_ntx_update(void) {
+	uint8_t misses = 0;
+	unsigned long h;
+	// one bit per phase in the window, set if the phase was missed
+	ctx->ntx_history = (ctx->ntx_history << 1) | (ctx->rx_cnt == 0);
+	for (h = ctx->ntx_history; h; h &= h - 1) {
+		misses++;
+	}
+	if (misses > ctx->ntx_allowed) {
+		// reliability floor violated: back to the maximum
+		ctx->ntx_cur = ctx->ntx_max;
+		ctx->ntx_stable = 0;
+		ctx->ntx_hop = 0xff;
+		return;
+	}
+	if (!ctx->rx_cnt) {
+		// missed phase
+		ctx->ntx_stable = 0;
+		if (ctx->ntx_cur < ctx->ntx_max) {
+			ctx->ntx_cur++;
+		}
+		return;
+	}
+	if ((GLOSSY_SYNC_MODE) && (ctx->relay_cnt < ctx->ntx_hop)) {
+		// first reception in the earliest slot observed so far
+		ctx->ntx_hop = ctx->relay_cnt;
+	}
+	if ((GLOSSY_SYNC_MODE) && (ctx->relay_cnt > ctx->ntx_hop + 1)) {
+		// first reception later than usual: the flood is thinning out upstream
+		ctx->ntx_stable = 0;
+		if (ctx->ntx_cur < ctx->ntx_max) {
+			ctx->ntx_cur++;
+		}
+	} else if (ctx->rx_cnt >= ctx->tx_max) {
+		// received in all the reception slots: there is redundancy to spare
+		if ((++ctx->ntx_stable >= GLOSSY_NTX_STABLE) && (misses <= ctx->ntx_allowed / 2)) {
+			ctx->ntx_stable = 0;
+			if (ctx->ntx_cur > ctx->ntx_min) {
+				ctx->ntx_cur--;
+			}
+		}
+	} else {
+		ctx->ntx_stable = 0;
+	}
+}
+
+unsigned long glossy_ntx_get_saved_us(void) {
+	if (ctx->tx_max >= ctx->ntx_max) {
+		return 0;
+	}
+	// two slots (one reception, one transmission) per transmission not performed
+	return 2 * (ctx->ntx_max - ctx->tx_max) * ((glossy_slot_length() * 1000) / (F_CPU / 1000));
+}
+
+void glossy_wakeup_init(uint8_t margin_min, uint8_t margin_max) {
+	ctx->wake_margin_min = margin_min;
+	ctx->wake_margin_max = margin_max;
+	ctx->wake_margin = margin_max;
+	ctx->wake_stable = 0;
+	ctx->wake_hop = 0;
+	ctx->wake_hop_window = 0xff;
+	ctx->wake_cnt = 0;
+	ctx->wake_missed = 1;
+}
+
+void glossy_wakeup_update(void) {
+	if ((!ctx->rx_cnt) || (!GLOSSY_SYNC_MODE)) {
+		// missed phase: listen from the beginning of the next flood
+		ctx->wake_missed = 1;
+		ctx->wake_stable = 0;
+		if (ctx->wake_margin < ctx->wake_margin_max) {
+			ctx->wake_margin++;
+		}
+		return;
+	}
+	if (ctx->wake_missed) {
+		// first reception after a miss: start from this slot
+		ctx->wake_hop = ctx->relay_cnt;
+		ctx->wake_missed = 0;
+	}
+	// earliest first reception within the current window
+	if (ctx->relay_cnt < ctx->wake_hop_window) {
+		ctx->wake_hop_window = ctx->relay_cnt;
+	}
+	if (ctx->relay_cnt < ctx->wake_hop) {
+		ctx->wake_hop = ctx->relay_cnt;
+	}
+	if (++ctx->wake_cnt == GLOSSY_WAKEUP_WINDOW) {
+		// forget what is older than the window (e.g., a lost short path)
+		ctx->wake_hop = ctx->wake_hop_window;
+		ctx->wake_hop_window = 0xff;
+		ctx->wake_cnt = 0;
+	}
+	if (ctx->relay_cnt > ctx->wake_hop) {
+		// later than expected: the node may have woken up too late
+		ctx->wake_stable = 0;
+		if (ctx->wake_margin < ctx->wake_margin_max) {
+			ctx->wake_margin++;
+		}
+	} else {
+		if ((++ctx->wake_stable >= GLOSSY_WAKEUP_STABLE) && (ctx->wake_margin > ctx->wake_margin_min)) {
+			ctx->wake_stable = 0;
+			ctx->wake_margin--;
+		}
+	}
+}
+
+uint8_t glossy_wakeup_slots(void) {
+	return ((ctx->wake_missed) || (ctx->wake_hop <= ctx->wake_margin)) ? 0 : ctx->wake_hop - ctx->wake_margin;
+}
+
+void glossy_wakeup_set_hop(uint8_t hop) {
+	ctx->wake_hop = hop;
+	ctx->wake_hop_window = 0xff;
+	ctx->wake_cnt = 0;
+	ctx->wake_margin = ctx->wake_margin_max;
+	ctx->wake_stable = 0;
+	ctx->wake_missed = 0;
+}
+
+rtimer_clock_t glossy_wakeup_offset_l(void) {
+	return ((unsigned long)glossy_wakeup_slots() * get_T_slot_full_h()) / CLOCK_PHI;
+}
+
+void glossy_trace_dump(void) {
+#if GLOSSY_TRACE
+	uint16_t sum = 0;
+	uint8_t n = (ctx->trace_cnt < GLOSSY_TRACE_LEN) ? ctx->trace_cnt : GLOSSY_TRACE_LEN;
+	uint16_t lost = ctx->trace_cnt - n;
+	uint16_t i;
+	putchar(0xc0);
+	glossy_trace_putc('T', &sum);
+	glossy_trace_putc(GLOSSY_TRACE_VERSION, &sum);
+	glossy_trace_putc(ctx->id & 0xff, &sum);
+	glossy_trace_putc(ctx->id >> 8, &sum);
+	glossy_trace_putc(n, &sum);
+	glossy_trace_putc((lost < 0xff) ? lost : 0xff, &sum);
+	// oldest record first
+	for (i = ctx->trace_cnt - n; i != ctx->trace_cnt; i++) {
+		struct glossy_trace_record *r = &ctx->trace[i & (GLOSSY_TRACE_LEN - 1)];
+		glossy_trace_putc(r->event, &sum);
+		glossy_trace_putc(r->relay_cnt, &sum);
+		glossy_trace_putc(r->t_cap & 0xff, &sum);
+		glossy_trace_putc(r->t_cap >> 8, &sum);
+		glossy_trace_putc(r->T_irq, &sum);
+		glossy_trace_putc(r->tbiv, &sum);
+	}
+	i = sum;
+	glossy_trace_putc(i & 0xff, &sum);
+	glossy_trace_putc(i >> 8, &sum);
+	putchar(0xc0);
+#endif /* GLOSSY_TRACE */
 }
 
+static long glossy_time_scale(long d) {
+	// d * time_skew / 2^24, without overflowing 32 bits
+	return (d / 65536) * ctx->time_skew / 256 + (d % 65536) * ctx->time_skew / 16777216L;
+}
+
+static void glossy_time_set(struct glossy_time *t, unsigned long ticks, long d) {
+	// t = ticks + d / 256, with a non-negative fraction
+	long q = d / 256;
+	long r = d % 256;
+	if (r < 0) {
+		r += 256;
+		q--;
+	}
+	t->ticks = ticks + q;
+	t->frac = r;
+}
+
+static uint8_t glossy_time_from_local(unsigned long t_l, uint8_t frac, struct glossy_time *nt) {
+	if (!ctx->time_valid) {
+		nt->ticks = t_l;
+		nt->frac = frac;
+		return 0;
+	}
+	// local time since the reference time, in 1/256 ticks
+	long d = (long)(t_l - ctx->time_ref_l) * 256 + frac - ctx->time_ref_frac;
+	// network time since the reference time: d / (1 + skew), to the second order
+	glossy_time_set(nt, ctx->time_nt_ref, d - glossy_time_scale(d - glossy_time_scale(d)));
+	return 1;
+}
+
+void glossy_time_sync(unsigned long nt_ref) {
+	ctx->time_ref_l = ctx->t_ref_ext;
+	// the reference time is T_offset_h + 1 DCO ticks after t_ref_l
+	rtimer_clock_t frac = ((ctx->T_offset_h + 1) * 256) / CLOCK_PHI;
+	if (frac > 255) {
+		ctx->time_ref_l++;
+		frac -= 256;
+	}
+	ctx->time_ref_frac = frac;
+	ctx->time_nt_ref = nt_ref;
+	ctx->time_valid = 1;
+}
+
+void glossy_time_set_skew(long skew, unsigned long period) {
+	// bound it to ~1000 ppm (skew / 256 / period < 2^-10),
+	// so that glossy_time_scale() cannot overflow
+	long max = (long)(period / 4);
+	if (skew > max) {
+		skew = max;
+	} else if (skew < -max) {
+		skew = -max;
+	}
+	// relative skew in units of 2^-24 (skew * 2^16 / period, in two steps of 2^8,
+	// without overflowing 32 bits as long as period < 2^23)
+	long x = skew * 256;
+	long s = (x / (long)period) * 256 + ((x % (long)period) * 256) / (long)period;
+	ctx->time_skew = s;
+}
+
+uint8_t glossy_time_now(struct glossy_time *nt) {
+#if COOJA
+	rtimer_clock_t t_cap_l = RTIMER_NOW();
+#else
+	// the current time is the next low-frequency clock tick
+	rtimer_clock_t t_cap_h, t_cap_l;
+	CAPTURE_NEXT_CLOCK_TICK(t_cap_h, t_cap_l);
+#endif /* COOJA */
+	return glossy_time_from_local(glossy_time_extend(t_cap_l), 0, nt);
+}
+
+uint8_t glossy_time_from_sfd(rtimer_clock_t t_sfd_h, struct glossy_time *nt) {
+#if COOJA
+	rtimer_clock_t t_cap_l = RTIMER_NOW();
+	rtimer_clock_t t_cap_h = RTIMER_NOW_DCO();
+#else
+	// capture the next low-frequency clock tick
+	rtimer_clock_t t_cap_h, t_cap_l;
+	CAPTURE_NEXT_CLOCK_TICK(t_cap_h, t_cap_l);
+#endif /* COOJA */
+	// interpolate back to the SFD event with the DCO clock
+	rtimer_clock_t T_sfd_to_cap_h = t_cap_h - t_sfd_h;
+	rtimer_clock_t T_sfd_to_cap_l = T_sfd_to_cap_h / CLOCK_PHI;
+	uint8_t frac = 0;
+	if (T_sfd_to_cap_h % CLOCK_PHI) {
+		T_sfd_to_cap_l++;
+		frac = ((CLOCK_PHI - T_sfd_to_cap_h % CLOCK_PHI) * 256) / CLOCK_PHI;
+	}
+	return glossy_time_from_local(glossy_time_extend(t_cap_l - T_sfd_to_cap_l), frac, nt);
+}
+
+rtimer_ext_clock_t glossy_time_to_local(const struct glossy_time *nt, rtimer_clock_t *T_frac_h) {
+	struct glossy_time t;
+	if (ctx->time_valid) {
+		// network time since the reference time, in 1/256 ticks
+		long d = (long)(nt->ticks - ctx->time_nt_ref) * 256 + nt->frac;
+		// local time
+		glossy_time_set(&t, ctx->time_ref_l, d + glossy_time_scale(d) + ctx->time_ref_frac);
+	} else {
+		t = *nt;
+	}
+	if (T_frac_h) {
+		*T_frac_h = ((rtimer_clock_t)t.frac * CLOCK_PHI) / 256;
+	}
+	return t.ticks;
+}
+
+#if GLOSSY_MULTI_CTX
+struct glossy_ctx *glossy_ctx_bind(struct glossy_ctx *c) {
+	struct glossy_ctx *prev = ctx;
+	ctx = (c) ? c : &ctx_default;
+	if ((ctx != &ctx_default) && (ctx->packet == NULL)) {
+		do {
+			ctx->packet = (uint8_t *) malloc(128);
+		} while (ctx->packet == NULL);
+	}
+	return prev;
+}
+#endif /* GLOSSY_MULTI_CTX */
+
 uint8_t get_state(void) {
-	return state;
+	return ctx->state;
 }
 
 static inline void estimate_slot_length(rtimer_clock_t t_rx_stop_tmp) {
 	// estimate slot length if rx_cnt > 1
 	// and we have received a packet immediately after our last transmission
-	if ((rx_cnt > 1) && (GLOSSY_RELAY_CNT_FIELD == (tx_relay_cnt_last + 2))) {
-		T_w_rt_h = t_tx_start - t_rx_stop;
-		T_tx_h = t_tx_stop - t_tx_start;
-		T_w_tr_h = t_rx_start - t_tx_stop;
-		T_rx_h = t_rx_stop_tmp - t_rx_start;
-		rtimer_clock_t T_slot_h_tmp = (T_tx_h + T_w_tr_h + T_rx_h + T_w_rt_h) / 2 - (packet_len * F_CPU) / 31250;
+	// (and it is the same packet of the burst, and that transmission was a relay:
+	// the initiator starts the next packet of a burst without receiving first)
+	if ((ctx->rx_cnt > 1) && (GLOSSY_RELAY_CNT_FIELD == (ctx->tx_relay_cnt_last + 2)) && (!ctx->burst_new) &&
+			((!ctx->burst_len) || ((GLOSSY_BURST_IDX_FIELD == ctx->burst_idx) && (ctx->tx_relay_cnt_last)))) {
+		ctx->T_w_rt_h = ctx->t_tx_start - ctx->t_rx_stop;
+		ctx->T_tx_h = ctx->t_tx_stop - ctx->t_tx_start;
+		ctx->T_w_tr_h = ctx->t_rx_start - ctx->t_tx_stop;
+		ctx->T_rx_h = t_rx_stop_tmp - ctx->t_rx_start;
+		rtimer_clock_t T_slot_h_tmp = (ctx->T_tx_h + ctx->T_w_tr_h + ctx->T_rx_h + ctx->T_w_rt_h) / 2 - (GLOSSY_PKT_LEN * F_CPU) / 31250;
 #if GLOSSY_SYNC_WINDOW
-		T_slot_h_sum += T_slot_h_tmp;
-		if ((++win_cnt) == GLOSSY_SYNC_WINDOW) {
+		ctx->T_slot_h_sum += T_slot_h_tmp;
+		if ((++ctx->win_cnt) == GLOSSY_SYNC_WINDOW) {
 			// update the slot length estimation
-			T_slot_h = T_slot_h_sum / GLOSSY_SYNC_WINDOW;
+			ctx->T_slot_h = ctx->T_slot_h_sum / GLOSSY_SYNC_WINDOW;
 			// halve the counters
-			T_slot_h_sum /= 2;
-			win_cnt /= 2;
+			ctx->T_slot_h_sum /= 2;
+			ctx->win_cnt /= 2;
 		} else {
-			if (win_cnt == 1) {
+			if (ctx->win_cnt == 1) {
 				// at the beginning, use the first estimation of the slot length
-				T_slot_h = T_slot_h_tmp;
+				ctx->T_slot_h = T_slot_h_tmp;
 			}
 		}
 #else
-		T_slot_h = T_slot_h_tmp;
+		ctx->T_slot_h = T_slot_h_tmp;
 #endif /* GLOSSY_SYNC_WINDOW */
 	}
 }
@@ -509,31 +1295,111 @@ static inline void compute_sync_reference_time(void) {
 	rtimer_clock_t t_cap_h, t_cap_l;
 	CAPTURE_NEXT_CLOCK_TICK(t_cap_h, t_cap_l);
 #endif /* COOJA */
-	rtimer_clock_t T_rx_to_cap_h = t_cap_h - t_rx_start;
-	unsigned long T_ref_to_rx_h = (GLOSSY_RELAY_CNT_FIELD - 1) * ((unsigned long)T_slot_h + (packet_len * F_CPU) / 31250);
+	rtimer_clock_t T_rx_to_cap_h = t_cap_h - ctx->t_rx_start;
+	// burst: the initiator transmitted the packet GLOSSY_BURST_SLOTS slots after the previous one
+	unsigned long T_ref_to_rx_h = (GLOSSY_RELAY_CNT_FIELD - 1 + (unsigned long)ctx->burst_idx * GLOSSY_BURST_SLOTS(ctx->tx_max)) *
+			((unsigned long)ctx->T_slot_h + (GLOSSY_PKT_LEN * F_CPU) / 31250);
 	unsigned long T_ref_to_cap_h = T_ref_to_rx_h + (unsigned long)T_rx_to_cap_h;
 	rtimer_clock_t T_ref_to_cap_l = 1 + T_ref_to_cap_h / CLOCK_PHI;
 	// high-resolution offset of the reference time
-	T_offset_h = (CLOCK_PHI - 1) - (T_ref_to_cap_h % CLOCK_PHI);
+	ctx->T_offset_h = (CLOCK_PHI - 1) - (T_ref_to_cap_h % CLOCK_PHI);
 	// low-resolution value of the reference time
-	t_ref_l = t_cap_l - T_ref_to_cap_l;
+	ctx->t_ref_l = t_cap_l - T_ref_to_cap_l;
 	// the reference time has been updated
-	t_ref_l_updated = 1;
+	ctx->t_ref_l_updated = 1;
 }
 
 /* ----------------------- Interrupt functions ---------------------- */
+#if GLOSSY_RX_FIFOP
+static inline void glossy_rx_wait_chunk(uint8_t n) {
+	ctx->rx_chunk = n;
+	FASTSPI_SETREG(CC2420_IOCFG0, FIFOP_THR(n - 1));
+	CLEAR_FIFOP_INT();
+}
+
+inline void glossy_rx_fifop(void) {
+	uint8_t remaining;
+	GLOSSY_TRACE_EVENT(GLOSSY_TRACE_RX_FIFOP, RTIMER_NOW_DCO());
+	// FIFOP stays high if the next chunk has already been received
+	while (ctx->rx_chunk && FIFOP_IS_1) {
+		if (ctx->state != GLOSSY_STATE_RECEIVING) {
+			// the reception is over (end of the packet, timeout or abort)
+			ctx->rx_chunk = 0;
+			break;
+		}
+		if (ctx->bytes_read == 0) {
+			// first chunk: the len and header fields
+			FASTSPI_READ_FIFO_NO_WAIT(ctx->packet, 2);
+			// keep receiving only if it has the right length and header
+			if ((GLOSSY_PKT_LEN && (GLOSSY_LEN_FIELD != GLOSSY_PKT_LEN_TMP))
+					|| (GLOSSY_LEN_FIELD < FOOTER_LEN) || (GLOSSY_LEN_FIELD > 127)
+					|| ((GLOSSY_HEADER_FIELD & GLOSSY_HEADER_MASK) != GLOSSY_HEADER)) {
+				// packet with a wrong length or header: abort packet reception
+				radio_abort_rx();
+#if GLOSSY_DEBUG
+				if ((GLOSSY_HEADER_FIELD & GLOSSY_HEADER_MASK) != GLOSSY_HEADER) {
+					bad_header++;
+				} else {
+					bad_length++;
+				}
+#endif /* GLOSSY_DEBUG */
+				ctx->rx_chunk = 0;
+				break;
+			}
+			if (!GLOSSY_PKT_LEN) {
+				// now the Rx timeout can follow the actual length
+				ctx->packet_len_tmp = GLOSSY_LEN_FIELD;
+				ctx->t_rx_timeout = ctx->t_rx_start + ((rtimer_clock_t)GLOSSY_PKT_LEN_TMP * 35 + 200) * 4;
+				glossy_schedule_rx_timeout();
+			}
+		} else {
+			// the RXFIFO holds at least rx_chunk bytes: no need to poll the FIFO pin
+			FASTSPI_READ_FIFO_NO_WAIT(&ctx->packet[ctx->bytes_read], ctx->rx_chunk);
+		}
+		ctx->bytes_read += ctx->rx_chunk;
+		if (ctx->bytes_read + 8 > GLOSSY_PKT_LEN_TMP) {
+			// the last 8 bytes are read by glossy_end_rx()
+			ctx->rx_chunk = 0;
+			break;
+		}
+		remaining = GLOSSY_PKT_LEN_TMP - 7 - ctx->bytes_read;
+		glossy_rx_wait_chunk((remaining > GLOSSY_RX_CHUNK) ? GLOSSY_RX_CHUNK : remaining);
+	}
+	if (!ctx->rx_chunk) {
+		DISABLE_FIFOP_INT();
+	}
+}
+#endif /* GLOSSY_RX_FIFOP */
+
 inline void glossy_begin_rx(void) {
-	t_rx_start = TBCCR1;
-	state = GLOSSY_STATE_RECEIVING;
-	if (packet_len) {
+	ctx->t_rx_start = TBCCR1;
+	GLOSSY_TRACE_EVENT(GLOSSY_TRACE_BEGIN_RX, ctx->t_rx_start);
+	ctx->state = GLOSSY_STATE_RECEIVING;
+#if GLOSSY_RX_FIFOP
+	// Rx timeout: packet duration + 200 us
+	// (longest packet until the length field has been read)
+	ctx->t_rx_timeout = ctx->t_rx_start +
+			((rtimer_clock_t)(GLOSSY_PKT_LEN ? GLOSSY_PKT_LEN_TMP : 127) * 35 + 200) * 4;
+	glossy_schedule_rx_timeout();
+	// return, and read the len and header fields when FIFOP goes high
+	ctx->bytes_read = 0;
+	glossy_rx_wait_chunk(2);
+	ENABLE_FIFOP_INT();
+	if (FIFOP_IS_1) {
+		// both bytes arrived before the threshold was set: no edge to wait for
+		glossy_rx_fifop();
+	}
+}
+#else
+	if (GLOSSY_PKT_LEN) {
 		// Rx timeout: packet duration + 200 us
 		// (packet duration: 32 us * packet_length, 1 DCO tick ~ 0.23 us)
-		t_rx_timeout = t_rx_start + ((rtimer_clock_t)packet_len_tmp * 35 + 200) * 4;
+		ctx->t_rx_timeout = ctx->t_rx_start + ((rtimer_clock_t)GLOSSY_PKT_LEN_TMP * 35 + 200) * 4;
 	}
 
 	// wait until the FIFO pin is 1 (i.e., until the first byte is received)
 	while (!FIFO_IS_1) {
-		if (packet_len && !RTIMER_CLOCK_LT(RTIMER_NOW_DCO(), t_rx_timeout)) {
+		if (GLOSSY_PKT_LEN && !RTIMER_CLOCK_LT(RTIMER_NOW_DCO(), ctx->t_rx_timeout)) {
 			radio_abort_rx();
 #if GLOSSY_DEBUG
 			rx_timeout++;
@@ -544,7 +1410,7 @@ inline void glossy_begin_rx(void) {
 	// read the first byte (i.e., the len field) from the RXFIFO
 	FASTSPI_READ_FIFO_BYTE(GLOSSY_LEN_FIELD);
 	// keep receiving only if it has the right length
-	if ((packet_len && (GLOSSY_LEN_FIELD != packet_len_tmp))
+	if ((GLOSSY_PKT_LEN && (GLOSSY_LEN_FIELD != GLOSSY_PKT_LEN_TMP))
 			|| (GLOSSY_LEN_FIELD < FOOTER_LEN) || (GLOSSY_LEN_FIELD > 127)) {
 		// packet with a wrong length: abort packet reception
 		radio_abort_rx();
@@ -553,16 +1419,16 @@ inline void glossy_begin_rx(void) {
 #endif /* GLOSSY_DEBUG */
 		return;
 	}
-	bytes_read = 1;
-	if (!packet_len) {
-		packet_len_tmp = GLOSSY_LEN_FIELD;
-		t_rx_timeout = t_rx_start + ((rtimer_clock_t)packet_len_tmp * 35 + 200) * 4;
+	ctx->bytes_read = 1;
+	if (!GLOSSY_PKT_LEN) {
+		ctx->packet_len_tmp = GLOSSY_LEN_FIELD;
+		ctx->t_rx_timeout = ctx->t_rx_start + ((rtimer_clock_t)GLOSSY_PKT_LEN_TMP * 35 + 200) * 4;
 	}
 
 #if !COOJA
 	// wait until the FIFO pin is 1 (i.e., until the second byte is received)
 	while (!FIFO_IS_1) {
-		if (!RTIMER_CLOCK_LT(RTIMER_NOW_DCO(), t_rx_timeout)) {
+		if (!RTIMER_CLOCK_LT(RTIMER_NOW_DCO(), ctx->t_rx_timeout)) {
 			radio_abort_rx();
 #if GLOSSY_DEBUG
 			rx_timeout++;
@@ -581,13 +1447,13 @@ inline void glossy_begin_rx(void) {
 #endif /* GLOSSY_DEBUG */
 		return;
 	}
-	bytes_read = 2;
-	if (packet_len_tmp > 8) {
+	ctx->bytes_read = 2;
+	if (GLOSSY_PKT_LEN_TMP > 8) {
 		// if packet is longer than 8 bytes, read all bytes but the last 8
-		while (bytes_read <= packet_len_tmp - 8) {
+		while (ctx->bytes_read <= GLOSSY_PKT_LEN_TMP - 8) {
 			// wait until the FIFO pin is 1 (until one more byte is received)
 			while (!FIFO_IS_1) {
-				if (!RTIMER_CLOCK_LT(RTIMER_NOW_DCO(), t_rx_timeout)) {
+				if (!RTIMER_CLOCK_LT(RTIMER_NOW_DCO(), ctx->t_rx_timeout)) {
 					radio_abort_rx();
 #if GLOSSY_DEBUG
 					rx_timeout++;
@@ -596,104 +1462,129 @@ inline void glossy_begin_rx(void) {
 				}
 			};
 			// read another byte from the RXFIFO
-			FASTSPI_READ_FIFO_BYTE(packet[bytes_read]);
-			bytes_read++;
+			FASTSPI_READ_FIFO_BYTE(ctx->packet[ctx->bytes_read]);
+			ctx->bytes_read++;
 		}
 	}
 #endif /* COOJA */
 	glossy_schedule_rx_timeout();
 }
+#endif /* GLOSSY_RX_FIFOP */
 
 inline void glossy_end_rx(void) {
 	rtimer_clock_t t_rx_stop_tmp = TBCCR1;
+	GLOSSY_TRACE_EVENT(GLOSSY_TRACE_END_RX, t_rx_stop_tmp);
 	// read the remaining bytes from the RXFIFO
-	FASTSPI_READ_FIFO_NO_WAIT(&packet[bytes_read], packet_len_tmp - bytes_read + 1);
-	bytes_read = packet_len_tmp + 1;
+	FASTSPI_READ_FIFO_NO_WAIT(&ctx->packet[ctx->bytes_read], GLOSSY_PKT_LEN_TMP - ctx->bytes_read + 1);
+	ctx->bytes_read = GLOSSY_PKT_LEN_TMP + 1;
 #if COOJA
 	if ((GLOSSY_CRC_FIELD & FOOTER1_CRC_OK) && ((GLOSSY_HEADER_FIELD & GLOSSY_HEADER_MASK) == GLOSSY_HEADER)) {
 #else
 	if (GLOSSY_CRC_FIELD & FOOTER1_CRC_OK) {
 #endif /* COOJA */
-		header = GLOSSY_HEADER_FIELD & ~GLOSSY_HEADER_MASK;
+		ctx->header = GLOSSY_HEADER_FIELD & ~GLOSSY_HEADER_MASK;
 		// packet correctly received
+		uint8_t relay = (ctx->tx_cnt < ctx->tx_max);
+		if (!GLOSSY_PKT_LEN) {
+			ctx->packet_len = GLOSSY_PKT_LEN_TMP;
+			ctx->data_len = (GLOSSY_SYNC_MODE) ?
+					GLOSSY_PKT_LEN_TMP - FOOTER_LEN - GLOSSY_RELAY_CNT_LEN - GLOSSY_HEADER_LEN :
+					GLOSSY_PKT_LEN_TMP - FOOTER_LEN - GLOSSY_HEADER_LEN;
+		}
+		if (ctx->burst_len) {
+			if ((GLOSSY_BURST_IDX_FIELD >= ctx->burst_next) && (GLOSSY_BURST_IDX_FIELD < ctx->burst_len)) {
+				// first reception of a packet further in the burst: flood it
+				ctx->burst_idx = GLOSSY_BURST_IDX_FIELD;
+				ctx->burst_next = ctx->burst_idx + 1;
+				ctx->burst_new = 1;
+				ctx->tx_cnt = 0;
+				relay = 1;
+			} else {
+				if (GLOSSY_BURST_IDX_FIELD != ctx->burst_idx) {
+					// a packet we are already done with
+					relay = 0;
+				}
+			}
+		}
+		if ((ctx->agg_op) && (glossy_agg_merge())) {
+			// aggregation: spread the news with a fresh budget of transmissions
+			ctx->tx_cnt = 0;
+			relay = 1;
+		}
 
-		// get the current id logs
-       glossy_data_struct glossy_data;
-
-       memcpy((uint8_t *)&glossy_data, &GLOSSY_DATA_FIELD, data_len);
-
-		if (sync) {
+		if (GLOSSY_SYNC_MODE) {
 			// increment relay_cnt field
 			GLOSSY_RELAY_CNT_FIELD++;
-
-			// append the id
-
-            int i;
-            for (i=0; i<10; i++)
-            {
-                if(glossy_data.logs[i]!=0 && glossy_data.logs[i+1]==0)
-                {
-                    glossy_data.logs[i+1]=id;
-                    break;
-                }
-
-            }
-
-
-
+#if GLOSSY_PATH_TRACE
+			// record the id in the slot of the next transmission
+			glossy_path_record(GLOSSY_RELAY_CNT_FIELD);
+#endif /* GLOSSY_PATH_TRACE */
 		}
-		if (tx_cnt == tx_max) {
-			// no more Tx to perform: stop Glossy
-			radio_off();
-			state = GLOSSY_STATE_OFF;
+		if (!relay) {
+			if ((GLOSSY_BURST_IS_OVER()) && (GLOSSY_AGG_IS_OVER())) {
+				// no more Tx to perform: stop Glossy
+				radio_off();
+				ctx->state = GLOSSY_STATE_OFF;
+			} else {
+				// burst: do not relay this packet, wait for the next one
+				// (aggregation: wait for the missing contributions)
+				if ((GLOSSY_ROLE_INITIATOR) && (ctx->burst_len)) {
+					// (the initiator does not need to listen until then)
+					radio_off();
+				} else {
+					radio_abort_tx();
+				}
+				ctx->state = GLOSSY_STATE_WAITING;
+			}
 		} else {
 			// write Glossy packet to the TXFIFO
 			radio_write_tx();
-			state = GLOSSY_STATE_RECEIVED;
+			ctx->state = GLOSSY_STATE_RECEIVED;
 		}
-		if (rx_cnt == 0) {
+		if (ctx->rx_cnt == 0) {
 			// first successful reception:
 			// store current time and received relay counter
-			t_first_rx_l = RTIMER_NOW();
-			if (sync) {
-				relay_cnt = GLOSSY_RELAY_CNT_FIELD - 1;
+			ctx->t_first_rx_l = RTIMER_NOW();
+			if (GLOSSY_SYNC_MODE) {
+				ctx->relay_cnt = GLOSSY_RELAY_CNT_FIELD - 1;
 			}
 		}
-		rx_cnt++;
-		if (sync) {
+		ctx->rx_cnt++;
+		if (GLOSSY_SYNC_MODE) {
 			estimate_slot_length(t_rx_stop_tmp);
 		}
-		t_rx_stop = t_rx_stop_tmp;
-		if (initiator) {
+		ctx->t_rx_stop = t_rx_stop_tmp;
+		if ((GLOSSY_ROLE_INITIATOR) && (!ctx->burst_len)) {
 			// a packet has been successfully received: stop the initiator timeout
 			glossy_stop_initiator_timeout();
 		}
-		if (!packet_len) {
-			packet_len = packet_len_tmp;
-			data_len = (sync) ?
-					packet_len_tmp - FOOTER_LEN - GLOSSY_RELAY_CNT_LEN - GLOSSY_HEADER_LEN :
-					packet_len_tmp - FOOTER_LEN - GLOSSY_HEADER_LEN;
-		}
-		memcpy(&GLOSSY_DATA_FIELD, (uint8_t *)&glossy_data, data_len);
 	} else {
 #if GLOSSY_DEBUG
 		bad_crc++;
 #endif /* GLOSSY_DEBUG */
 		// packet corrupted, abort the transmission before it actually starts
 		radio_abort_tx();
-		state = GLOSSY_STATE_WAITING;
+		ctx->state = GLOSSY_STATE_WAITING;
 	}
 }
 
 inline void glossy_begin_tx(void) {
-	t_tx_start = TBCCR1;
-	state = GLOSSY_STATE_TRANSMITTING;
-	tx_relay_cnt_last = GLOSSY_RELAY_CNT_FIELD;
-	if ((!initiator) && (rx_cnt == 1)) {
-		// copy the application data from the data field
-		memcpy(data, &GLOSSY_DATA_FIELD, data_len);
-	}
-	if ((sync) && (T_slot_h) && (!t_ref_l_updated) && (rx_cnt)) {
+	ctx->t_tx_start = TBCCR1;
+	GLOSSY_TRACE_EVENT(GLOSSY_TRACE_BEGIN_TX, ctx->t_tx_start);
+	ctx->state = GLOSSY_STATE_TRANSMITTING;
+	ctx->tx_relay_cnt_last = GLOSSY_RELAY_CNT_FIELD;
+	if (ctx->burst_len) {
+		if (ctx->burst_new) {
+			// first relay of a packet of the burst: hand it to the application
+			glossy_burst_store();
+		}
+	} else {
+		if ((!GLOSSY_ROLE_INITIATOR) && (ctx->rx_cnt == 1) && (!ctx->agg_op)) {
+			// copy the application data from the data field
+			memcpy(ctx->data, &GLOSSY_DATA_FIELD, ctx->data_len);
+		}
+	}
+	if ((GLOSSY_SYNC_MODE) && (ctx->T_slot_h) && (!ctx->t_ref_l_updated) && (ctx->rx_cnt)) {
 		// compute the reference time after the first reception (higher accuracy)
 		compute_sync_reference_time();
 	}
@@ -702,20 +1593,25 @@ inline void glossy_begin_tx(void) {
 inline void glossy_end_tx(void) {
 	ENERGEST_OFF(ENERGEST_TYPE_TRANSMIT);
 	ENERGEST_ON(ENERGEST_TYPE_LISTEN);
-	t_tx_stop = TBCCR1;
+	ctx->t_tx_stop = TBCCR1;
+	GLOSSY_TRACE_EVENT(GLOSSY_TRACE_END_TX, ctx->t_tx_stop);
 	// stop Glossy if tx_cnt reached tx_max (and tx_max > 1 at the initiator)
-	if ((++tx_cnt == tx_max) && ((tx_max - initiator) > 0)) {
+	if ((++ctx->tx_cnt == ctx->tx_max) && ((ctx->tx_max - GLOSSY_ROLE_INITIATOR) > 0) && (GLOSSY_BURST_IS_OVER()) && (GLOSSY_AGG_IS_OVER())) {
 		radio_off();
-		state = GLOSSY_STATE_OFF;
+		ctx->state = GLOSSY_STATE_OFF;
 	} else {
-		state = GLOSSY_STATE_WAITING;
+		if ((GLOSSY_ROLE_INITIATOR) && (ctx->burst_len) && (ctx->tx_cnt >= ctx->tx_max)) {
+			// burst: nothing to do until the next packet is due
+			radio_off();
+		}
+		ctx->state = GLOSSY_STATE_WAITING;
 	}
 	radio_flush_tx();
 }
 
 /* ------------------------------ Timeouts -------------------------- */
 inline void glossy_schedule_rx_timeout(void) {
-	TBCCR5 = t_rx_timeout;
+	TBCCR5 = ctx->t_rx_timeout;
 	TBCCTL5 = CCIE;
 }
 
@@ -725,11 +1621,11 @@ inline void glossy_stop_rx_timeout(void) {
 
 inline void glossy_schedule_initiator_timeout(void) {
 #if !COOJA
-	if (sync) {
-		TBCCR4 = t_start + (n_timeouts + 1) * GLOSSY_INITIATOR_TIMEOUT * ((unsigned long)T_slot_h + (packet_len * F_CPU) / 31250);
+	if (GLOSSY_SYNC_MODE) {
+		TBCCR4 = ctx->t_start + (ctx->n_timeouts + 1) * GLOSSY_INITIATOR_TIMEOUT * ((unsigned long)ctx->T_slot_h + (GLOSSY_PKT_LEN * F_CPU) / 31250);
 	} else {
-		TBCCR4 = t_start + (n_timeouts + 1) * GLOSSY_INITIATOR_TIMEOUT *
-				((rtimer_clock_t)packet_len * 35 + 400) * 4;
+		TBCCR4 = ctx->t_start + (ctx->n_timeouts + 1) * GLOSSY_INITIATOR_TIMEOUT *
+				((rtimer_clock_t)GLOSSY_PKT_LEN * 35 + 400) * 4;
 	}
 	TBCCTL4 = CCIE;
 #endif
@@ -48,6 +48,7 @@
 #include <stdio.h>
 #include <legacymsp430.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * If not zero, nodes print additional debug information (disabled by default).
@@ -64,6 +65,155 @@
  */
 #define GLOSSY_INITIATOR_TIMEOUT      3
 
+/**
+ * If not zero, nodes record their id in the packet being flooded
+ * (requires time synchronization, as it relies on the relay counter).
+ * Disabled by default.
+ *
+ * The trace is an array of \link glossy_path_id_t \endlink located
+ * \link GLOSSY_PATH_OFFSET \endlink bytes into the flooding data:
+ * entry k holds the id of the node that transmitted the received packet
+ * in slot k (i.e., with relay counter k), zero if none.
+ * Each node writes only its own entry, so recording takes constant time
+ * regardless of the data length.
+ *
+ * The id is written before the packet is relayed: nodes transmitting in
+ * the same slot then send different packets, which no longer interfere
+ * constructively. Expect a lower reliability and more slots per flood,
+ * the more so in dense networks; use it for debugging only.
+ */
+#ifdef GLOSSY_CONF_PATH_TRACE
+#define GLOSSY_PATH_TRACE             GLOSSY_CONF_PATH_TRACE
+#else
+#define GLOSSY_PATH_TRACE             0
+#endif /* GLOSSY_CONF_PATH_TRACE */
+/**
+ * Offset of the path trace within the flooding data, in bytes.
+ */
+#ifdef GLOSSY_CONF_PATH_OFFSET
+#define GLOSSY_PATH_OFFSET            GLOSSY_CONF_PATH_OFFSET
+#else
+#define GLOSSY_PATH_OFFSET            0
+#endif /* GLOSSY_CONF_PATH_OFFSET */
+/**
+ * Maximum number of entries of the path trace. Slots beyond the end of
+ * the trace or of the flooding data are not recorded.
+ */
+#ifdef GLOSSY_CONF_PATH_LEN
+#define GLOSSY_PATH_LEN               GLOSSY_CONF_PATH_LEN
+#else
+#define GLOSSY_PATH_LEN               40
+#endif /* GLOSSY_CONF_PATH_LEN */
+/**
+ * Node ids are stored in the path trace truncated to one byte.
+ */
+typedef uint8_t glossy_path_id_t;
+
+/**
+ * Number of hops the network is assumed to span when spacing the packets
+ * of a burst: the last relays of a packet must be over before the next
+ * packet is started.
+ */
+#ifdef GLOSSY_CONF_BURST_HOPS
+#define GLOSSY_BURST_HOPS             GLOSSY_CONF_BURST_HOPS
+#else
+#define GLOSSY_BURST_HOPS             4
+#endif /* GLOSSY_CONF_BURST_HOPS */
+/**
+ * If not zero, the interrupt handlers record the events of each Glossy
+ * phase in a ring of \link glossy_trace_record \endlink, to be dumped with
+ * glossy_trace_dump() (disabled by default).
+ */
+#ifdef GLOSSY_CONF_TRACE
+#define GLOSSY_TRACE                  GLOSSY_CONF_TRACE
+#else
+#define GLOSSY_TRACE                  0
+#endif /* GLOSSY_CONF_TRACE */
+/**
+ * Number of records of the trace ring (a power of two): when a phase has
+ * more events, the oldest records are overwritten.
+ */
+#ifdef GLOSSY_CONF_TRACE_LEN
+#define GLOSSY_TRACE_LEN              GLOSSY_CONF_TRACE_LEN
+#else
+#define GLOSSY_TRACE_LEN              64
+#endif /* GLOSSY_CONF_TRACE_LEN */
+/**
+ * Version of the format of the trace dump (tools/sky/glossy-trace.c).
+ */
+#define GLOSSY_TRACE_VERSION          1
+/**
+ * If not zero, the state of Glossy is accessed through a pointer to a
+ * \link glossy_ctx \endlink bound with glossy_ctx_bind(), so that several
+ * instances can coexist (e.g., many simulated nodes in one address space).
+ * Otherwise (default), there is a single instance at a constant address
+ * and the code is the same as with file-scope variables (the constant part
+ * of the interrupt service delay is measured in this case).
+ */
+#ifdef GLOSSY_CONF_MULTI_CTX
+#define GLOSSY_MULTI_CTX              GLOSSY_CONF_MULTI_CTX
+#else
+#define GLOSSY_MULTI_CTX              0
+#endif /* GLOSSY_CONF_MULTI_CTX */
+/**
+ * Length of the Glossy packets (length field: data length plus header,
+ * relay counter if in sync mode and footer), if fixed at build time.
+ * The interrupt functions then use a constant instead of the value set by
+ * glossy_start(), which must match it (it fails with GLOSSY_START_ERR_LEN
+ * otherwise). Zero (default): set at runtime.
+ */
+#ifdef GLOSSY_CONF_FIXED_PACKET_LEN
+#define GLOSSY_FIXED_PACKET_LEN       GLOSSY_CONF_FIXED_PACKET_LEN
+#else
+#define GLOSSY_FIXED_PACKET_LEN       0
+#endif /* GLOSSY_CONF_FIXED_PACKET_LEN */
+/**
+ * Sync mode fixed at build time: 1 (with relay counter), 0 (without)
+ * or -1 (default): set at runtime by glossy_start(), which must match it
+ * (it fails with GLOSSY_START_ERR_SYNC otherwise).
+ */
+#ifdef GLOSSY_CONF_FIXED_SYNC
+#define GLOSSY_FIXED_SYNC             GLOSSY_CONF_FIXED_SYNC
+#else
+#define GLOSSY_FIXED_SYNC             -1
+#endif /* GLOSSY_CONF_FIXED_SYNC */
+/**
+ * If not zero, the node is never the initiator: the code of the initiator
+ * is left out of the interrupt functions, and starting Glossy as the
+ * initiator fails with GLOSSY_START_ERR_ROLE (disabled by default).
+ */
+#ifdef GLOSSY_CONF_RECEIVER_ONLY
+#define GLOSSY_RECEIVER_ONLY          GLOSSY_CONF_RECEIVER_ONLY
+#else
+#define GLOSSY_RECEIVER_ONLY          0
+#endif /* GLOSSY_CONF_RECEIVER_ONLY */
+/**
+ * If not zero, the bytes of a packet being received are read from the
+ * RXFIFO in chunks, each one by the FIFOP interrupt raised when the RXFIFO
+ * holds enough bytes (FIFOP_THR of IOCFG0). The SFD interrupt then returns
+ * right away, instead of busy-waiting on the FIFO pin for most of the packet
+ * with interrupts masked.
+ *
+ * Disabled by default: it has only run on the native target and in the
+ * simulator, and the timing of the last chunk (see
+ * \link GLOSSY_RX_CHUNK \endlink) has yet to be measured on the Tmote Sky.
+ */
+#ifdef GLOSSY_CONF_RX_FIFOP
+#define GLOSSY_RX_FIFOP               GLOSSY_CONF_RX_FIFOP
+#else
+#define GLOSSY_RX_FIFOP               0
+#endif /* GLOSSY_CONF_RX_FIFOP */
+/**
+ * Bytes read by each FIFOP interrupt (1 to 120). The last chunk is read
+ * while the final 8 bytes of the packet are on air, so it must take less
+ * than that (about 5 us per byte at SMCLK / 2).
+ */
+#ifdef GLOSSY_CONF_RX_CHUNK
+#define GLOSSY_RX_CHUNK               GLOSSY_CONF_RX_CHUNK
+#else
+#define GLOSSY_RX_CHUNK               16
+#endif /* GLOSSY_CONF_RX_CHUNK */
+
 /**
  * Ratio between the frequencies of the DCO and the low-frequency clocks
  */
@@ -82,12 +232,84 @@
 #define FOOTER1_CRC_OK                0x80
 #define FOOTER1_CORRELATION           0x7f
 
-#define GLOSSY_LEN_FIELD              packet[0]
-#define GLOSSY_HEADER_FIELD           packet[1]
-#define GLOSSY_DATA_FIELD             packet[2]
-#define GLOSSY_RELAY_CNT_FIELD        packet[packet_len_tmp - FOOTER_LEN]
-#define GLOSSY_RSSI_FIELD             packet[packet_len_tmp - 1]
-#define GLOSSY_CRC_FIELD              packet[packet_len_tmp]
+/**
+ * Packet length, sync mode and role, as constants if fixed at build time
+ * (\link GLOSSY_FIXED_PACKET_LEN \endlink, \link GLOSSY_FIXED_SYNC \endlink,
+ * \link GLOSSY_RECEIVER_ONLY \endlink), so that the compiler folds them.
+ */
+#if GLOSSY_FIXED_PACKET_LEN
+#define GLOSSY_PKT_LEN                GLOSSY_FIXED_PACKET_LEN
+#define GLOSSY_PKT_LEN_TMP            GLOSSY_FIXED_PACKET_LEN
+#else
+#define GLOSSY_PKT_LEN                ctx->packet_len
+#define GLOSSY_PKT_LEN_TMP            ctx->packet_len_tmp
+#endif /* GLOSSY_FIXED_PACKET_LEN */
+#if GLOSSY_FIXED_SYNC >= 0
+#define GLOSSY_SYNC_MODE              GLOSSY_FIXED_SYNC
+#else
+#define GLOSSY_SYNC_MODE              ctx->sync
+#endif /* GLOSSY_FIXED_SYNC */
+#if GLOSSY_RECEIVER_ONLY
+#define GLOSSY_ROLE_INITIATOR         0
+#else
+#define GLOSSY_ROLE_INITIATOR         ctx->initiator
+#endif /* GLOSSY_RECEIVER_ONLY */
+
+#define GLOSSY_LEN_FIELD              ctx->packet[0]
+#define GLOSSY_HEADER_FIELD           ctx->packet[1]
+#define GLOSSY_DATA_FIELD             ctx->packet[2]
+#define GLOSSY_RELAY_CNT_FIELD        ctx->packet[GLOSSY_PKT_LEN_TMP - FOOTER_LEN]
+#define GLOSSY_RSSI_FIELD             ctx->packet[GLOSSY_PKT_LEN_TMP - 1]
+#define GLOSSY_CRC_FIELD              ctx->packet[GLOSSY_PKT_LEN_TMP]
+#define GLOSSY_PATH_FIELD(i)          ctx->packet[2 + GLOSSY_PATH_OFFSET + (i)]
+#define GLOSSY_BURST_IDX_LEN          sizeof(uint8_t)
+#define GLOSSY_BURST_IDX_FIELD        ctx->packet[1 + ctx->data_len]
+
+/**
+ * Slots between the first transmissions of two consecutive packets of a
+ * burst by the initiator, given the maximum number of transmissions.
+ */
+#define GLOSSY_BURST_SLOTS(n)         (2 * (n) + GLOSSY_BURST_HOPS)
+/**
+ * Delay after which the initiator tries again to start the next packet
+ * of a burst if it is still busy with the previous one, in DCO ticks.
+ */
+#define GLOSSY_BURST_RETRY_H          1024
+/**
+ * Not zero if the node has no more transmissions to perform
+ * (always the case after the last transmission when not in burst mode).
+ */
+#define GLOSSY_BURST_IS_OVER()        ((ctx->burst_idx + 1 >= ctx->burst_len) && (ctx->tx_cnt >= ctx->tx_max))
+#define GLOSSY_AGG_FLAGS_FIELD        ctx->packet[2 + ctx->agg_len]
+/**
+ * Not zero if the node may stop: always the case when not aggregating,
+ * otherwise only once the contributions of all the nodes have been merged.
+ */
+#define GLOSSY_AGG_IS_OVER()          ((!ctx->agg_op) || (ctx->agg_complete))
+
+/**
+ * \brief            Merge operator of the aggregation mode.
+ * \param acc        Local aggregate, updated in place.
+ * \param in         Aggregate carried by the received packet.
+ * \param len        Length of both aggregates, in bytes.
+ * \returns          Not zero if the local aggregate has changed.
+ *
+ *                   Called from the SFD interrupt between the end of a
+ *                   reception and the relay of the packet: it must be short.
+ */
+typedef uint8_t (*glossy_merge_t)(uint8_t *acc, const uint8_t *in, uint8_t len);
+
+/**
+ * Merge operator of the aggregation mode.
+ *
+ * It must be idempotent: merging a contribution more than once must not
+ * change the result (e.g., max), because the aggregates that meet during
+ * a flood usually share contributions. Sums are not supported: counting
+ * nodes is done with glossy_op_or_u8 over one bit per node instead.
+ */
+struct glossy_merge_op {
+	glossy_merge_t merge; /**< Merge function */
+};
 
 enum {
 	GLOSSY_INITIATOR = 1, GLOSSY_RECEIVER = 0
@@ -96,6 +318,18 @@ enum {
 enum {
 	GLOSSY_SYNC = 1, GLOSSY_NO_SYNC = 0
 };
+/**
+ * Values returned when starting Glossy. On error, the node does not take
+ * part in the Glossy phase: the radio stays off, and the callback is
+ * executed right away, as after a phase in which nothing was received.
+ */
+enum glossy_start_status {
+	GLOSSY_START_OK,           /**< Glossy has started */
+	GLOSSY_START_ERR_NODE_IDX, /**< The node index of an aggregation is not below the number of nodes */
+	GLOSSY_START_ERR_LEN,      /**< The packet length differs from \link GLOSSY_FIXED_PACKET_LEN \endlink */
+	GLOSSY_START_ERR_SYNC,     /**< The sync mode differs from \link GLOSSY_FIXED_SYNC \endlink */
+	GLOSSY_START_ERR_ROLE      /**< Initiator with \link GLOSSY_RECEIVER_ONLY \endlink */
+};
 /**
  * List of possible Glossy states.
  */
@@ -108,10 +342,83 @@ enum glossy_state {
 	GLOSSY_STATE_TRANSMITTED,  /**< Glossy has just finished transmitting a packet */
 	GLOSSY_STATE_ABORTED       /**< Glossy has just aborted a packet reception */
 };
+/**
+ * List of the events recorded in the trace.
+ */
+enum glossy_trace_event {
+	GLOSSY_TRACE_BEGIN_RX = 1, /**< SFD of a packet being received */
+	GLOSSY_TRACE_END_RX,       /**< End of a reception, after the relay was started */
+	GLOSSY_TRACE_BEGIN_TX,     /**< SFD of a packet being transmitted */
+	GLOSSY_TRACE_END_TX,       /**< End of a transmission */
+	GLOSSY_TRACE_LATE_RX,      /**< End of a reception served too late to relay the packet */
+	GLOSSY_TRACE_TIMER,        /**< Timer B compare (timeouts, burst) or unexpected interrupt */
+	GLOSSY_TRACE_RX_FIFOP      /**< FIFOP interrupt: a chunk of the packet being received is read */
+};
+/**
+ * Record of the trace, filled by the interrupt handlers.
+ */
+struct glossy_trace_record {
+	uint8_t event;     /**< Event (high nibble) and state in which it occurred (low nibble) */
+	uint8_t relay_cnt; /**< Relay counter field of the packet buffer */
+	uint16_t t_cap;    /**< Timer B capture of the SFD (current time for timer events), in DCO ticks */
+	uint8_t T_irq;     /**< Variable part of the interrupt service delay, in DCO ticks */
+	uint8_t tbiv;      /**< Timer B interrupt vector */
+};
 #if GLOSSY_DEBUG
 unsigned int high_T_irq, rx_timeout, bad_length, bad_header, bad_crc;
 #endif /* GLOSSY_DEBUG */
 
+/**
+ * \brief State of an instance of Glossy. Applications only allocate it
+ *        (zero-initialized) and bind it with glossy_ctx_bind().
+ */
+struct glossy_ctx {
+	unsigned short id;
+	uint8_t initiator, sync, rx_cnt, tx_cnt, tx_max;
+	uint8_t *data, *packet;
+	uint8_t data_len, packet_len, packet_len_tmp, header;
+	uint8_t bytes_read, tx_relay_cnt_last, n_timeouts;
+	uint8_t rx_chunk;
+	volatile uint8_t state;
+	rtimer_clock_t t_rx_start, t_rx_stop, t_tx_start, t_tx_stop, t_start;
+	rtimer_clock_t t_rx_timeout;
+	rtimer_clock_t T_irq;
+	rtimer_clock_t t_stop;
+	rtimer_callback_t cb;
+	struct rtimer *rtimer;
+	void *ptr;
+	unsigned short ie1, ie2, p1ie, p2ie, tbiv;
+
+	rtimer_clock_t T_slot_h, T_rx_h, T_w_rt_h, T_tx_h, T_w_tr_h, t_ref_l, T_offset_h, t_first_rx_l;
+#if GLOSSY_SYNC_WINDOW
+	unsigned long T_slot_h_sum;
+	uint8_t win_cnt;
+#endif /* GLOSSY_SYNC_WINDOW */
+	uint8_t relay_cnt, t_ref_l_updated;
+	uint8_t burst_len, burst_idx, burst_next, burst_new;
+	uint8_t *burst_bitmap;
+	unsigned long burst_wait;
+	const struct glossy_merge_op *agg_op;
+	uint8_t *agg_flags;
+	uint8_t agg_len, agg_flags_len, agg_n_nodes, agg_complete;
+	uint8_t hop_enabled;
+	unsigned short hop_seed;
+	unsigned long hop_seq, hop_from_seq;
+	uint16_t hop_blacklist, hop_next_blacklist, hop_fsctrl;
+	uint8_t ntx_cur, ntx_min, ntx_max, ntx_allowed, ntx_stable, ntx_hop;
+	unsigned long ntx_history;
+	uint8_t wake_margin, wake_margin_min, wake_margin_max, wake_stable;
+	uint8_t wake_hop, wake_hop_window, wake_cnt, wake_missed;
+	rtimer_ext_clock_t t_ref_ext;
+	unsigned long time_ref_l, time_nt_ref;
+	uint8_t time_ref_frac, time_valid;
+	long time_skew;
+#if GLOSSY_TRACE
+	struct glossy_trace_record trace[GLOSSY_TRACE_LEN];
+	uint16_t trace_cnt;
+#endif /* GLOSSY_TRACE */
+};
+
 PROCESS_NAME(glossy_process);
 
 /* ----------------------- Application interface -------------------- */
@@ -150,12 +457,105 @@ PROCESS_NAME(glossy_process);
  *                   execution.
  * \param rtimer_    First argument of the callback function.
  * \param ptr_       Second argument of the callback function.
+ * \returns          GLOSSY_START_OK, or an error if the arguments do not
+ *                   match those fixed at build time (the node then does
+ *                   not take part in the phase, see \link
+ *                   glossy_start_status \endlink).
+ */
+uint8_t glossy_start(uint8_t *data_, uint8_t data_len_, uint8_t initiator_,
+		uint8_t sync_, uint8_t tx_max_, uint8_t header_,
+		rtimer_clock_t t_stop_, rtimer_callback_t cb_,
+		struct rtimer *rtimer_, void *ptr_, unsigned short id_);
+
+/**
+ * \brief            Start Glossy in burst mode: flood a queue of packets
+ *                   back-to-back within a single Glossy phase.
+ *
+ *                   Interrupts, the DCO and the radio are set up only once
+ *                   for the whole burst. Each packet is flooded with up to
+ *                   \p tx_max_ transmissions per node and carries its index
+ *                   in the burst. The initiator starts a packet
+ *                   \link GLOSSY_BURST_SLOTS \endlink slots after the
+ *                   previous one, when the flood of the previous one has
+ *                   moved away from it; the initiator timeout is not used.
+ *
+ * \param data_      A pointer to the queue: \p n_packets_ packets of
+ *                   \p data_len_ bytes each.
+ *
+ *                   At the initiator, Glossy reads the packets from it.
+ *
+ *                   At a receiver, Glossy writes each received packet to
+ *                   its position in the queue.
+ * \param data_len_  Length of each packet, in bytes (one byte less than with
+ *                   glossy_start(), as Glossy appends the packet index).
+ * \param n_packets_ Number of packets in the burst.
+ * \param bitmap_    At a receiver, bitmap of the received packets
+ *                   (bit i of byte i / 8 set if packet i was received),
+ *                   (\p n_packets_ + 7) / 8 bytes cleared by Glossy.
+ *                   May be NULL.
+ * \returns          As glossy_start().
+ *
+ * \sa               glossy_start for the other parameters
+ */
+uint8_t glossy_start_burst(uint8_t *data_, uint8_t data_len_, uint8_t n_packets_,
+		uint8_t *bitmap_, uint8_t initiator_,
+		uint8_t sync_, uint8_t tx_max_, uint8_t header_,
+		rtimer_clock_t t_stop_, rtimer_callback_t cb_,
+		struct rtimer *rtimer_, void *ptr_, unsigned short id_);
+
+/**
+ * \brief            Start Glossy in aggregation mode: compute a
+ *                   network-wide aggregate within a single flood.
+ *
+ *                   Every node merges the aggregate carried by each packet
+ *                   it receives into its local one with \p op_ and
+ *                   relays the result. The packet also carries one
+ *                   completion flag per node, set once the contribution of
+ *                   the node has been merged. A node relays with a fresh
+ *                   budget of \p tx_max_ transmissions whenever it learns
+ *                   something new or knows something the packet lacks, and
+ *                   does not stop before all the flags are set.
+ *
+ * \param data_      A pointer to the aggregate, \p data_len_ bytes.
+ *
+ *                   It holds the contribution of the node when Glossy is
+ *                   started and the aggregate when it stops.
+ * \param data_len_  Length of the aggregate, in bytes (a multiple of the
+ *                   width of the fields of \p op_).
+ * \param op_        Merge operator, e.g., one of glossy_op_or_u8,
+ *                   glossy_op_max_u8, glossy_op_max_u16, glossy_op_min_u8
+ *                   or glossy_op_min_u16.
+ * \param flags_     Completion flags (bit i of byte i / 8 set if the
+ *                   contribution of node i has been merged),
+ *                   (\p n_nodes_ + 7) / 8 bytes, initialized by Glossy.
+ * \param n_nodes_   Number of nodes taking part in the aggregation.
+ * \param node_idx_  Index of the node, between 0 and \p n_nodes_ - 1.
+ * \returns          As glossy_start(), or GLOSSY_START_ERR_NODE_IDX if
+ *                   \p node_idx_ is out of range.
+ *
+ * \sa               glossy_start for the other parameters
  */
-void glossy_start(uint8_t *data_, uint8_t data_len_, uint8_t initiator_,
+uint8_t glossy_start_aggregate(uint8_t *data_, uint8_t data_len_, const struct glossy_merge_op *op_,
+		uint8_t *flags_, uint8_t n_nodes_, uint8_t node_idx_, uint8_t initiator_,
 		uint8_t sync_, uint8_t tx_max_, uint8_t header_,
 		rtimer_clock_t t_stop_, rtimer_callback_t cb_,
 		struct rtimer *rtimer_, void *ptr_, unsigned short id_);
 
+/**
+ * \name             Merge operators
+ *
+ *                   Field-wise bitwise OR, maximum and minimum over
+ *                   unsigned fields of 8 or 16 bits (little endian, no
+ *                   alignment required).
+ * @{
+ */
+extern const struct glossy_merge_op glossy_op_or_u8;
+extern const struct glossy_merge_op glossy_op_max_u8;
+extern const struct glossy_merge_op glossy_op_max_u16;
+extern const struct glossy_merge_op glossy_op_min_u8;
+extern const struct glossy_merge_op glossy_op_min_u16;
+/** @} */
+
 /**
  * \brief            Stop Glossy and resume all other application tasks.
  * \returns          Number of times the packet has been received during
@@ -188,6 +588,13 @@ uint8_t get_state(void);
  */
 rtimer_clock_t get_t_first_rx_l(void);
 
+/**
+ * \brief            Provide information about the last aggregation.
+ * \returns          Not zero if the aggregate of the last Glossy phase
+ *                   includes the contributions of all the nodes.
+ */
+uint8_t is_agg_complete(void);
+
 /** @} */
 
 /**
@@ -208,6 +615,14 @@ uint8_t get_relay_cnt(void);
  */
 rtimer_clock_t get_T_slot_h(void);
 
+/**
+ * \brief            Get the local estimation of the whole slot length
+ *                   (T_slot plus the transmission time of the packet),
+ *                   in DCO clock ticks.
+ * \returns          Slot length, zero if not estimated yet.
+ */
+rtimer_clock_t get_T_slot_full_h(void);
+
 /**
  * \brief            Get low-frequency synchronization reference time.
  * \returns          Low-frequency reference time
@@ -215,6 +630,16 @@ rtimer_clock_t get_T_slot_h(void);
  */
 rtimer_clock_t get_t_ref_l(void);
 
+/**
+ * \brief            Get low-frequency synchronization reference time on the
+ *                   extended clock.
+ * \returns          Reference time extended to 32 bits when Glossy was
+ *                   stopped (or as set with set_t_ref_ext()), e.g., to
+ *                   schedule the next phase with rtimer_set_ext() more than
+ *                   one counter period ahead.
+ */
+rtimer_ext_clock_t get_t_ref_ext(void);
+
 /**
  * \brief            Provide information about current synchronization status.
  * \returns          Not zero if the synchronization reference time was
@@ -230,6 +655,14 @@ uint8_t is_t_ref_l_updated(void);
  */
 void set_t_ref_l(rtimer_clock_t t);
 
+/**
+ * \brief            Set low-frequency synchronization reference time on the
+ *                   extended clock.
+ * \param t          Updated reference time (also sets the one returned by
+ *                   get_t_ref_l()).
+ */
+void set_t_ref_ext(rtimer_ext_clock_t t);
+
 /**
  * \brief            Set the current synchronization status.
  * \param updated    Not zero if a node has to be considered synchronized,
@@ -237,6 +670,327 @@ void set_t_ref_l(rtimer_clock_t t);
  */
 void set_t_ref_l_updated(uint8_t updated);
 
+/**
+ * \brief            Set the estimation of the slot length.
+ * \param T_slot     Slot length (\link get_T_slot_h \endlink), in DCO clock ticks.
+ *                   Useful to restore an estimation from a previous run:
+ *                   it is replaced by the first new estimation.
+ */
+void set_T_slot_h(rtimer_clock_t T_slot);
+
+/** @} */
+
+/**
+ * \defgroup glossy_hopping Interface related to channel hopping
+ * @{
+ */
+
+/**
+ * First IEEE 802.15.4 channel in the 2.4 GHz band.
+ */
+#define GLOSSY_HOPPING_FIRST_CHANNEL  11
+/**
+ * Number of IEEE 802.15.4 channels in the 2.4 GHz band (11 to 26).
+ */
+#define GLOSSY_HOPPING_N_CHANNELS     16
+
+/**
+ * \brief            Enable per-flood channel hopping.
+ * \param seed       Seed of the hopping sequence, shared by all nodes.
+ *
+ *                   Each Glossy phase uses a pseudo-random channel derived
+ *                   from the seed and from the sequence number set with
+ *                   glossy_hopping_set_seq(). Glossy switches channel in
+ *                   glossy_start(), while the radio is off and before
+ *                   the DCO is resynchronized, so that the switch does not
+ *                   delay the first reception or transmission.
+ */
+void glossy_hopping_init(unsigned short seed);
+
+/**
+ * \brief            Set the sequence number of the next Glossy phases.
+ * \param seq_no     Sequence number that selects the channel.
+ *
+ *                   A node that does not know the current sequence number
+ *                   (e.g., while bootstrapping) keeps listening on the
+ *                   channel of a fixed one until the hopping sequence of
+ *                   the initiator visits that channel.
+ */
+void glossy_hopping_set_seq(unsigned long seq_no);
+
+/**
+ * \brief            Set the channel blacklist.
+ * \param blacklist  Bitmap of channels not to use
+ *                   (bit i set: channel 11 + i excluded).
+ * \param from_seq   First sequence number the blacklist applies to.
+ *
+ *                   To update the blacklist network-wide, the initiator
+ *                   distributes the blacklist and \p from_seq in its
+ *                   floods ahead of time; each node passes them to this
+ *                   function, so that all nodes switch at the same flood.
+ *                   A blacklist excluding all the channels is ignored.
+ */
+void glossy_hopping_set_blacklist(uint16_t blacklist, unsigned long from_seq);
+
+/**
+ * \brief            Get the channel blacklist that applies to a flood.
+ * \param seq_no     Sequence number of the flood.
+ * \returns          Bitmap of excluded channels.
+ */
+uint16_t glossy_hopping_get_blacklist(unsigned long seq_no);
+
+/**
+ * \brief            Get the channel of a flood.
+ * \param seq_no     Sequence number of the flood.
+ * \returns          Channel used by the flood, between 11 and 26.
+ */
+uint8_t glossy_hopping_channel(unsigned long seq_no);
+
+/** @} */
+
+/**
+ * \defgroup glossy_ntx Interface related to the adaptive number of transmissions
+ * @{
+ */
+
+/**
+ * Number of Glossy phases over which the reliability floor is enforced.
+ */
+#define GLOSSY_NTX_WINDOW             32
+/**
+ * Number of consecutive phases with redundant receptions after which
+ * the number of transmissions is decreased by one.
+ */
+#ifdef GLOSSY_CONF_NTX_STABLE
+#define GLOSSY_NTX_STABLE             GLOSSY_CONF_NTX_STABLE
+#else
+#define GLOSSY_NTX_STABLE             16
+#endif /* GLOSSY_CONF_NTX_STABLE */
+
+/**
+ * \brief            Initialize the controller of the number of transmissions.
+ * \param n_min      Minimum number of transmissions.
+ * \param n_max      Maximum (and initial) number of transmissions, also the
+ *                   reference for the estimation of the radio-on time saved.
+ * \param min_rel    Reliability floor, in percent: fraction of the last
+ *                   \link GLOSSY_NTX_WINDOW \endlink phases in which the
+ *                   packet must have been received.
+ *
+ *                   The controller adapts the number of transmissions of the
+ *                   node between Glossy phases. It decreases it by one after
+ *                   \link GLOSSY_NTX_STABLE \endlink consecutive phases in
+ *                   which the node received the packet in all its reception
+ *                   slots, not later than usual (relay counter) and within
+ *                   the reliability floor. It increases it by one after each
+ *                   missed phase or late first reception, and sets it back
+ *                   to \p n_max if the reliability floor is violated.
+ */
+void glossy_ntx_init(uint8_t n_min, uint8_t n_max, uint8_t min_rel);
+
+/**
+ * \brief            Get the number of transmissions to use.
+ * \returns          Value of \p tx_max_ to pass to the next glossy_start().
+ */
+uint8_t glossy_ntx_get(void);
+
+/**
+ * \brief            Update the controller with the outcome of the last
+ *                   Glossy phase (to be called after glossy_stop()).
+ */
+void glossy_ntx_update(void);
+
+/**
+ * \brief            Get the radio-on time saved in the last Glossy phase.
+ * \returns          Estimation of the radio-on time saved with respect to
+ *                   \p n_max transmissions, in microseconds
+ *                   (two slots per transmission not performed).
+ */
+unsigned long glossy_ntx_get_saved_us(void);
+
+/** @} */
+
+/**
+ * \defgroup glossy_wakeup Interface related to the hop-aware wake-up of receivers
+ * @{
+ */
+
+/**
+ * Number of Glossy phases over which the earliest reception slot is tracked.
+ */
+#define GLOSSY_WAKEUP_WINDOW          32
+/**
+ * Number of consecutive phases with a reception in the expected slot after
+ * which the safety margin is decreased by one slot.
+ */
+#define GLOSSY_WAKEUP_STABLE          16
+
+/**
+ * \brief            Initialize the hop-aware wake-up of a receiver.
+ * \param margin_min Minimum safety margin, in slots.
+ * \param margin_max Maximum safety margin, in slots.
+ *
+ *                   A receiver n hops away from the initiator first receives
+ *                   the packet in slot n - 1 (relay counter). Instead of
+ *                   listening from the beginning of the flood, it can turn
+ *                   on the radio that many slots later, minus a safety margin.
+ *                   The margin grows by one slot after each late first
+ *                   reception and after each missed phase, and shrinks by
+ *                   one slot after \link GLOSSY_WAKEUP_STABLE \endlink phases
+ *                   with a reception in the expected slot.
+ */
+void glossy_wakeup_init(uint8_t margin_min, uint8_t margin_max);
+
+/**
+ * \brief            Update the wake-up offset with the outcome of the last
+ *                   Glossy phase (to be called after glossy_stop()).
+ */
+void glossy_wakeup_update(void);
+
+/**
+ * \brief            Get the wake-up offset of the next Glossy phase.
+ * \returns          Time by which the receiver can delay glossy_start()
+ *                   with respect to the beginning of the flood, in ticks of
+ *                   the low-frequency clock. Zero after a missed phase.
+ */
+rtimer_clock_t glossy_wakeup_offset_l(void);
+
+/**
+ * \brief            Get the wake-up offset of the next Glossy phase, in slots.
+ */
+uint8_t glossy_wakeup_slots(void);
+
+/**
+ * \brief            Set the slot in which the receiver expects the first
+ *                   reception, e.g., restored from a previous run.
+ * \param hop        Relay counter of the first reception
+ *                   (\link get_relay_cnt \endlink).
+ *
+ *                   The margin is set to its maximum.
+ */
+void glossy_wakeup_set_hop(uint8_t hop);
+
+/** @} */
+
+/**
+ * \defgroup glossy_trace Interface related to the event trace
+ * @{
+ */
+
+/**
+ * \brief            Write the trace of the last Glossy phase to the serial
+ *                   line, as a SLIP frame (to be called after glossy_stop(),
+ *                   does nothing if \link GLOSSY_TRACE \endlink is zero).
+ *
+ *                   Frame: 'T', \link GLOSSY_TRACE_VERSION \endlink, node id
+ *                   (2 bytes), number of records, number of overwritten
+ *                   records, records (6 bytes each, in the order of
+ *                   \link glossy_trace_record \endlink) and sum of the
+ *                   previous bytes (2 bytes). Multi-byte fields are little
+ *                   endian. tools/sky/glossy-trace.c decodes it.
+ */
+void glossy_trace_dump(void);
+
+/** @} */
+
+/**
+ * \defgroup glossy_time Interface related to the network-wide time
+ * @{
+ */
+
+/**
+ * \brief Network time: ticks of the low-frequency clock of the initiator,
+ *        extended to 32 bits, plus a fraction of a tick (1/256 tick, ~0.12 us).
+ */
+struct glossy_time {
+	unsigned long ticks;   /**< Ticks of the low-frequency clock. */
+	uint8_t frac;          /**< Fraction of a tick, in 1/256 ticks. */
+};
+
+/**
+ * \brief            Align the network time with the reference time of the
+ *                   last Glossy phase (to be called after glossy_stop(),
+ *                   only if the reference time was updated by Glossy).
+ * \param nt_ref     Network time of the reference time, in ticks (e.g., the
+ *                   sequence number times the period of the initiator).
+ *
+ *                   The reference time is used with its high-resolution
+ *                   offset, on the extended clock (RTIMER_NOW_EXT()), so
+ *                   that it may be called any time after glossy_stop().
+ *                   Conversions are valid within 2^23 ticks (256 s) of the
+ *                   reference time.
+ */
+void glossy_time_sync(unsigned long nt_ref);
+
+/**
+ * \brief            Set the clock skew of the local clock with respect to
+ *                   the one of the initiator.
+ * \param skew       Local ticks in excess over a period, in 1/256 ticks
+ *                   (positive if the local clock is faster).
+ * \param period     Length of the period, in ticks of the initiator (less
+ *                   than 2^23, i.e., 256 s).
+ */
+void glossy_time_set_skew(long skew, unsigned long period);
+
+/**
+ * \brief            Get the current network time.
+ * \param nt         Pointer to the network time.
+ * \returns          Not zero if the network time is valid, zero if
+ *                   glossy_time_sync() was never called (the local time is
+ *                   returned instead).
+ *
+ *                   The function waits for the next tick of the
+ *                   low-frequency clock (at most ~30 us) and returns the
+ *                   network time of that instant.
+ */
+uint8_t glossy_time_now(struct glossy_time *nt);
+
+/**
+ * \brief            Get the network time of an SFD event.
+ * \param t_sfd_h    Value of the DCO clock at the SFD event, e.g., TBCCR1
+ *                   captured with \link SFD_CAP_INIT \endlink during the
+ *                   transmission or the reception of an application packet.
+ * \param nt         Pointer to the network time.
+ * \returns          As glossy_time_now().
+ *
+ *                   The DCO clock is interpolated between the event and the
+ *                   next tick of the low-frequency clock, so the event must be
+ *                   less than 2^16 DCO ticks (~15 ms) in the past.
+ */
+uint8_t glossy_time_from_sfd(rtimer_clock_t t_sfd_h, struct glossy_time *nt);
+
+/**
+ * \brief            Convert a network time into a local time.
+ * \param nt         Pointer to the network time.
+ * \param T_frac_h   Pointer to a variable for storing the high-resolution
+ *                   offset from the returned tick, in DCO ticks (may be NULL).
+ * \returns          Tick of the low-frequency clock that immediately precedes
+ *                   the network time, on the extended clock, e.g., to be used
+ *                   with rtimer_set_ext() (or, truncated, with rtimer_set()).
+ */
+rtimer_ext_clock_t glossy_time_to_local(const struct glossy_time *nt, rtimer_clock_t *T_frac_h);
+
+/** @} */
+
+/**
+ * \defgroup glossy_ctx Interface related to multiple instances
+ * @{
+ */
+
+#if GLOSSY_MULTI_CTX
+/**
+ * \brief            Bind an instance of Glossy: all the other functions,
+ *                   including the interrupt handlers, use its state.
+ * \param c          Pointer to the state of the instance (zero-initialized
+ *                   before its first use), NULL for the default instance.
+ * \returns          Pointer to the state of the previously bound instance.
+ *
+ *                   Only one instance can run a Glossy phase at a time:
+ *                   bind another one only after glossy_stop().
+ *                   Only available with \link GLOSSY_MULTI_CTX \endlink.
+ */
+struct glossy_ctx *glossy_ctx_bind(struct glossy_ctx *c);
+#endif /* GLOSSY_MULTI_CTX */
+
 /** @} */
 
 /** @} */
@@ -271,6 +1025,9 @@ inline void glossy_begin_rx(void);
 inline void glossy_end_rx(void);
 inline void glossy_begin_tx(void);
 inline void glossy_end_tx(void);
+#if GLOSSY_RX_FIFOP
+inline void glossy_rx_fifop(void);
+#endif /* GLOSSY_RX_FIFOP */
 
 /** @} */
 
@@ -285,6 +1042,10 @@ inline void glossy_end_tx(void);
  * \param t_cap_h variable for storing value of DCO clock value
  * \param t_cap_l variable for storing value of low-frequency clock value
  */
+#if CONTIKI_TARGET_NATIVE
+#define CAPTURE_NEXT_CLOCK_TICK(t_cap_h, t_cap_l) \
+		rtimer_arch_capture_next_tick(&(t_cap_h), &(t_cap_l))
+#else
 #define CAPTURE_NEXT_CLOCK_TICK(t_cap_h, t_cap_l) do {\
 		/* Enable capture mode for timers B6 and A2 (ACLK) */\
 		TBCCTL6 = CCIS0 | CM_POS | CAP | SCS; \
@@ -298,6 +1059,7 @@ inline void glossy_end_tx(void);
 		TBCCTL6 = 0; \
 		TACCTL2 = 0; \
 } while (0)
+#endif /* CONTIKI_TARGET_NATIVE */
 
 /** @} */
 
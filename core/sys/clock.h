@@ -110,6 +110,18 @@ CCIF unsigned long clock_seconds(void);
 
 void etimer_interrupt(void);
 
+/**
+ * Program the clock to wake the CPU up when the next event timer
+ * expires.
+ *
+ * A tickless clock only interrupts the CPU at the expiration time of
+ * the first event timer, so it must be told when the timers have
+ * changed. This function should be called with interrupts disabled
+ * just before the CPU goes to sleep; it requests a poll of the event
+ * timers if one has already expired. A periodic clock does nothing.
+ */
+void clock_schedule_wakeup(void);
+
 #endif /* __CLOCK_H__ */
 
 /** @} */
@@ -50,32 +50,124 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
+/* The pending event timers form a pairing heap: timerlist is the
+   timer that expires first, its children are linked through
+   child/next, and prev points to the previous sibling or, for a first
+   child, to the parent. Adding a timer is O(1), finding the next
+   expiration is O(1) and removing a timer is O(log n) amortized. */
 static struct etimer *timerlist;
-static clock_time_t next_expiration;
+
+/* Wrap-safe "a expires before b". */
+#define BEFORE(a, b) ((clock_time_t)((a) - (b)) > ((clock_time_t)~(clock_time_t)0 >> 1))
+
+#define EXPIRATION(t) ((t)->timer.start + (t)->timer.interval)
 
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
-static void
-update_time(void)
+/* Meld two heaps whose roots have no siblings. */
+static struct etimer *
+meld(struct etimer *a, struct etimer *b)
 {
-  clock_time_t tdist;
-  clock_time_t now;
   struct etimer *t;
 
-  if (timerlist == NULL) {
-    next_expiration = 0;
+  if(a == NULL) {
+    return b;
+  }
+  if(b == NULL) {
+    return a;
+  }
+  if(BEFORE(EXPIRATION(b), EXPIRATION(a))) {
+    t = a;
+    a = b;
+    b = t;
+  }
+  b->prev = a;
+  b->next = a->child;
+  if(a->child != NULL) {
+    a->child->prev = b;
+  }
+  a->child = b;
+  return a;
+}
+/*---------------------------------------------------------------------------*/
+/* Meld a list of siblings into one heap: pairwise from left to right,
+   then the pairs from right to left. */
+static struct etimer *
+merge_pairs(struct etimer *t)
+{
+  struct etimer *a, *b, *pairs;
+
+  pairs = NULL;
+  while(t != NULL) {
+    a = t;
+    b = t->next;
+    t = b != NULL ? b->next : NULL;
+    a->next = a->prev = NULL;
+    if(b != NULL) {
+      b->next = b->prev = NULL;
+    }
+    a = meld(a, b);
+    a->next = pairs;
+    pairs = a;
+  }
+  while(pairs != NULL) {
+    a = pairs;
+    pairs = pairs->next;
+    a->next = NULL;
+    t = meld(t, a);
+  }
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct etimer *et)
+{
+  et->child = et->next = et->prev = NULL;
+  timerlist = meld(timerlist, et);
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_timer(struct etimer *et)
+{
+  if(et == timerlist) {
+    timerlist = merge_pairs(et->child);
   } else {
-    now = clock_time();
-    t = timerlist;
-    /* Must calculate distance to next time into account due to wraps */
-    tdist = t->timer.start + t->timer.interval - now;
-    for(t = t->next; t != NULL; t = t->next) {
-      if(t->timer.start + t->timer.interval - now < tdist) {
-	tdist = t->timer.start + t->timer.interval - now;
-      }
+    if(et->prev->child == et) {
+      et->prev->child = et->next;
+    } else {
+      et->prev->next = et->next;
+    }
+    if(et->next != NULL) {
+      et->next->prev = et->prev;
+    }
+    timerlist = meld(timerlist, merge_pairs(et->child));
+  }
+  et->child = et->next = et->prev = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+on_list(struct etimer *et)
+{
+  return et->p != PROCESS_NONE &&
+    (et == timerlist ||
+     (et->prev != NULL && (et->prev->child == et || et->prev->next == et)));
+}
+/*---------------------------------------------------------------------------*/
+/* Turn the heap into a list linked through next, in O(n). */
+static struct etimer *
+flatten(struct etimer *t)
+{
+  struct etimer *u, *last;
+
+  for(u = t; u != NULL; u = u->next) {
+    if(u->child != NULL) {
+      for(last = u->child; last->next != NULL; last = last->next);
+      last->next = u->next;
+      u->next = u->child;
+      u->child = NULL;
     }
-    next_expiration = now + tdist;
   }
+  return t;
 }
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(etimer_process, ev, data)
@@ -92,17 +184,15 @@ PROCESS_THREAD(etimer_process, ev, data)
     if(ev == PROCESS_EVENT_EXITED) {
       struct process *p = data;
 
-      while(timerlist != NULL && timerlist->p == p) {
-	timerlist = timerlist->next;
-      }
-
-      if(timerlist != NULL) {
-	t = timerlist;
-	while(t->next != NULL) {
-	  if(t->next->p == p) {
-	    t->next = t->next->next;
-	  } else
-	    t = t->next;
+      /* Rebuild the heap without the timers of the exited process. */
+      t = flatten(timerlist);
+      timerlist = NULL;
+      for(; t != NULL; t = u) {
+	u = t->next;
+	if(t->p == p) {
+	  t->child = t->next = t->prev = NULL;
+	} else {
+	  insert_timer(t);
 	}
       }
       continue;
@@ -110,31 +200,21 @@ PROCESS_THREAD(etimer_process, ev, data)
       continue;
     }
 
-  again:
-    
-    u = NULL;
-    
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(timer_expired(&t->timer)) {
-	if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+    /* The timers expire in order, so stop at the first one that has
+       not expired yet. */
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
 	  
-	  /* Reset the process ID of the event timer, to signal that the
-	     etimer has expired. This is later checked in the
-	     etimer_expired() function. */
-	  t->p = PROCESS_NONE;
-	  if(u != NULL) {
-	    u->next = t->next;
-	  } else {
-	    timerlist = t->next;
-	  }
-	  t->next = NULL;
-	  update_time();
-	  goto again;
-	} else {
-	  etimer_request_poll();
-	}
+	/* Reset the process ID of the event timer, to signal that the
+	   etimer has expired. This is later checked in the
+	   etimer_expired() function. */
+	t->p = PROCESS_NONE;
+	remove_timer(t);
+      } else {
+	etimer_request_poll();
+	break;
       }
-      u = t;
     }
     
   }
@@ -151,27 +231,15 @@ etimer_request_poll(void)
 static void
 add_timer(struct etimer *timer)
 {
-  struct etimer *t;
-
   etimer_request_poll();
 
-  if(timer->p != PROCESS_NONE) {
-    /* Timer not on list. */
-    
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(t == timer) {
-	/* Timer already on list, bail out. */
-	update_time();
-	return;
-      }
-    }
+  if(on_list(timer)) {
+    /* Timer already on list, move it to its new expiration time. */
+    remove_timer(timer);
+  } else {
+    timer->p = PROCESS_CURRENT();
   }
-
-  timer->p = PROCESS_CURRENT();
-  timer->next = timerlist;
-  timerlist = timer;
-
-  update_time();
+  insert_timer(timer);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -198,8 +266,13 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
-  et->timer.start += timediff;
-  update_time();
+  if(on_list(et)) {
+    remove_timer(et);
+    et->timer.start += timediff;
+    insert_timer(et);
+  } else {
+    et->timer.start += timediff;
+  }
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -229,35 +302,16 @@ etimer_pending(void)
 clock_time_t
 etimer_next_expiration_time(void)
 {
-  return etimer_pending() ? next_expiration : 0;
+  return etimer_pending() ? EXPIRATION(timerlist) : 0;
 }
 /*---------------------------------------------------------------------------*/
 void
 etimer_stop(struct etimer *et)
 {
-  struct etimer *t;
-
-  /* First check if et is the first event timer on the list. */
-  if(et == timerlist) {
-    timerlist = timerlist->next;
-    update_time();
-  } else {
-    /* Else walk through the list and try to find the item before the
-       et timer. */
-    for(t = timerlist; t != NULL && t->next != et; t = t->next);
-
-    if(t != NULL) {
-      /* We've found the item before the event timer that we are about
-	 to remove. We point the items next pointer to the event after
-	 the removed item. */
-      t->next = et->next;
-
-      update_time();
-    }
+  if(on_list(et)) {
+    remove_timer(et);
   }
 
-  /* Remove the next pointer from the item to be removed. */
-  et->next = NULL;
   /* Set the timer as expired */
   et->p = PROCESS_NONE;
 }
@@ -72,12 +72,20 @@
  * This structure is used for declaring a timer. The timer must be set
  * with etimer_set() before it can be used.
  *
+ * The pending event timers are kept in a heap ordered by expiration
+ * time, linked through the \c child, \c next and \c prev fields. An
+ * event timer must therefore be static (or zeroed) before it is first
+ * set, and no two pending event timers may expire more than half the
+ * range of clock_time_t apart.
+ *
  * \hideinitializer
  */
 struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+  /* first child, and previous sibling (or parent, for a first child) */
+  struct etimer *child, *prev;
 };
 
 /**
@@ -66,8 +66,21 @@ struct event_data {
   struct process *p;
 };
 
-static process_num_events_t nevents, fevent;
-static struct event_data events[PROCESS_CONF_NUMEVENTS];
+/*
+ * One queue of events per priority class.
+ */
+struct event_queue {
+  process_num_events_t nevents, fevent, size;
+  struct event_data *events;
+};
+
+static struct event_data events_normal[PROCESS_CONF_NUMEVENTS];
+static struct event_data events_high[PROCESS_CONF_NUMEVENTS_HIGH];
+static struct event_queue queues[PROCESS_NUM_PRIO] = {
+  { 0, 0, PROCESS_CONF_NUMEVENTS, events_normal },
+  { 0, 0, PROCESS_CONF_NUMEVENTS_HIGH, events_high },
+};
+static process_num_events_t nevents;
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
@@ -75,6 +88,12 @@ process_num_events_t process_maxevents;
 
 static volatile unsigned char poll_requested;
 
+/*
+ * Processes waiting to be polled, linked through nextpoll, one queue
+ * per priority class. needspoll is set while a process is queued.
+ */
+static struct process *poll_head[PROCESS_NUM_PRIO], *poll_tail[PROCESS_NUM_PRIO];
+
 #define PROCESS_STATE_NONE        0
 #define PROCESS_STATE_RUNNING     1
 #define PROCESS_STATE_CALLED      2
@@ -121,6 +140,37 @@ process_start(struct process *p, const char *arg)
   process_post_synch(p, PROCESS_EVENT_INIT, (process_data_t)arg);
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Take an exiting process out of the poll queues, in case its memory
+ * is about to be reused (e.g., by the loader).
+ */
+static void
+poll_remove(struct process *p)
+{
+  struct process *q, *prev;
+  int i;
+  spl_t s = splhigh();
+
+  for(i = 0; i < PROCESS_NUM_PRIO; i++) {
+    for(prev = NULL, q = poll_head[i]; q != NULL; prev = q, q = q->nextpoll) {
+      if(q == p) {
+	if(prev == NULL) {
+	  poll_head[i] = p->nextpoll;
+	} else {
+	  prev->nextpoll = p->nextpoll;
+	}
+	if(poll_tail[i] == p) {
+	  poll_tail[i] = prev;
+	}
+	p->needspoll = 0;
+	splx(s);
+	return;
+      }
+    }
+  }
+  splx(s);
+}
+/*---------------------------------------------------------------------------*/
 static void
 exit_process(struct process *p, struct process *fromprocess)
 {
@@ -151,6 +201,10 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
   
+  if(p->needspoll) {
+    poll_remove(p);
+  }
+
   if(p == process_list) {
     process_list = process_list->next;
   } else {
@@ -201,9 +255,15 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+  int i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  nevents = 0;
+  for(i = 0; i < PROCESS_NUM_PRIO; i++) {
+    queues[i].nevents = queues[i].fevent = 0;
+    poll_head[i] = poll_tail[i] = NULL;
+  }
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
@@ -218,15 +278,30 @@ process_init(void)
 static void
 do_poll(void)
 {
-  struct process *p;
+  struct process *p, *next, *head[PROCESS_NUM_PRIO];
+  int i;
+  spl_t s;
 
+  /* Take the processes queued so far: those polled while they run are
+     called at the next round, as the others. */
+  s = splhigh();
   poll_requested = 0;
-  /* Call the processes that needs to be polled. */
-  for(p = process_list; p != NULL; p = p->next) {
-    if(p->needspoll) {
-      p->state = PROCESS_STATE_RUNNING;
+  for(i = 0; i < PROCESS_NUM_PRIO; i++) {
+    head[i] = poll_head[i];
+    poll_head[i] = poll_tail[i] = NULL;
+  }
+  splx(s);
+
+  /* Call the processes that needs to be polled, high priority first. */
+  for(i = PROCESS_NUM_PRIO - 1; i >= 0; i--) {
+    for(p = head[i]; p != NULL; p = next) {
+      /* once needspoll is cleared, the process may be queued again */
+      next = p->nextpoll;
       p->needspoll = 0;
-      call_process(p, PROCESS_EVENT_POLL, NULL);
+      if(p->state != PROCESS_STATE_NONE) {
+	p->state = PROCESS_STATE_RUNNING;
+	call_process(p, PROCESS_EVENT_POLL, NULL);
+      }
     }
   }
 }
@@ -243,6 +318,7 @@ do_event(void)
   static process_data_t data;
   static struct process *receiver;
   static struct process *p;
+  struct event_queue *q;
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -253,16 +329,19 @@ do_event(void)
    */
 
   if(nevents > 0) {
+
+    /* There are events that we should deliver: take the first one of
+       the highest priority class. */
+    for(q = &queues[PROCESS_NUM_PRIO - 1]; q->nevents == 0; q--);
+    ev = q->events[q->fevent].ev;
     
-    /* There are events that we should deliver. */
-    ev = events[fevent].ev;
-    
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrese the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    q->fevent = (q->fevent + 1) % q->size;
+    --q->nevents;
     --nevents;
 
     /* If this is a broadcast event, we deliver it to all events, in
@@ -316,6 +395,7 @@ int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
   static process_num_events_t snum;
+  struct event_queue *q;
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -326,7 +406,8 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": p->name, nevents);
   }
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  q = &queues[p == PROCESS_BROADCAST ? PROCESS_PRIO_NORMAL : p->prio];
+  if(q->nevents == q->size) {
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, process_current->name);
@@ -337,10 +418,11 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = (process_num_events_t)(q->fevent + q->nevents) % q->size;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
   ++nevents;
 
 #if PROCESS_CONF_STATS
@@ -367,12 +449,30 @@ process_poll(struct process *p)
   if(p != NULL) {
     if(p->state == PROCESS_STATE_RUNNING ||
        p->state == PROCESS_STATE_CALLED) {
-      p->needspoll = 1;
+      spl_t s = splhigh();
+      if(!p->needspoll) {
+	/* append to the queue of its class */
+	p->needspoll = 1;
+	p->nextpoll = NULL;
+	if(poll_tail[p->prio] == NULL) {
+	  poll_head[p->prio] = p;
+	} else {
+	  poll_tail[p->prio]->nextpoll = p;
+	}
+	poll_tail[p->prio] = p;
+      }
       poll_requested = 1;
+      splx(s);
     }
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+process_set_prio(struct process *p, unsigned char prio)
+{
+  p->prio = prio < PROCESS_NUM_PRIO ? prio : PROCESS_PRIO_HIGH;
+}
+/*---------------------------------------------------------------------------*/
 int
 process_is_running(struct process *p)
 {
@@ -89,6 +89,24 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \name Priority classes
+ *
+ * The polls of a high-priority process and the events posted to it
+ * are served before those of the normal processes. Broadcast events
+ * are of normal priority.
+ * @{
+ */
+#define PROCESS_PRIO_NORMAL   0
+#define PROCESS_PRIO_HIGH     1
+#define PROCESS_NUM_PRIO      2
+/** @} */
+
+/* Size of the queue of the events posted to high-priority processes. */
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 4
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -310,7 +328,8 @@ struct process {
   const char *name;
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
-  unsigned char state, needspoll;
+  unsigned char state, needspoll, prio;
+  struct process *nextpoll;
 };
 
 /**
@@ -348,7 +367,8 @@ CCIF void process_start(struct process *p, const char *arg);
  * \retval PROCESS_ERR_OK The event could be posted.
  *
  * \retval PROCESS_ERR_FULL The event queue was full and the event could
- * not be posted.
+ * not be posted. Events to a process of high priority go to a queue of
+ * their own (see process_set_prio()).
  */
 CCIF int process_post(struct process *p, process_event_t ev, void* data);
 
@@ -457,6 +477,19 @@ CCIF process_event_t process_alloc_event(void);
  */
 CCIF void process_poll(struct process *p);
 
+/**
+ * Set the priority class of a process.
+ *
+ * Processes are of normal priority unless set otherwise, which can
+ * be done before they are started. A poll already requested is served
+ * in the class the process had at the time.
+ *
+ * \param p A pointer to the process' process structure.
+ *
+ * \param prio PROCESS_PRIO_NORMAL or PROCESS_PRIO_HIGH.
+ */
+CCIF void process_set_prio(struct process *p, unsigned char prio);
+
 /** @} */
 
 /**
@@ -56,53 +56,174 @@
 #define PRINTF(...)
 #endif
 
+/* The pending tasks, ordered by extended time. */
 static struct rtimer *next_rtimer;
 
+/* The hardware timer is programmed at most this far ahead, so that
+   its compare value cannot alias a later counter period. */
+#define SCHEDULE_MAX 0x8000L
+
 /*---------------------------------------------------------------------------*/
 void
 rtimer_init(void)
 {
+  next_rtimer = NULL;
   rtimer_arch_init();
 }
 /*---------------------------------------------------------------------------*/
+rtimer_ext_clock_t
+rtimer_extend(rtimer_clock_t t)
+{
+  rtimer_ext_clock_t now = RTIMER_NOW_EXT();
+
+  return now + (signed short)(t - (rtimer_clock_t)now);
+}
+/*---------------------------------------------------------------------------*/
+/* Program the hardware timer for the first task: RTIMER_GUARD ticks
+   from now if that task is due before, and half a counter period
+   ahead if it is due later. Called with interrupts off. */
+static void
+schedule_first(void)
+{
+  rtimer_ext_clock_t now;
+  signed long left;
+
+  if(next_rtimer != NULL) {
+    now = RTIMER_NOW_EXT();
+    left = (signed long)(next_rtimer->ext_time - now);
+    if(left < RTIMER_GUARD) {
+      rtimer_arch_schedule((rtimer_clock_t)now + RTIMER_GUARD);
+    } else if(left > SCHEDULE_MAX) {
+      rtimer_arch_schedule((rtimer_clock_t)(now + SCHEDULE_MAX));
+    } else {
+      rtimer_arch_schedule(next_rtimer->time);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a task from the queue, if it is there. Called with interrupts
+   off. */
+static void
+remove(struct rtimer *rtimer)
+{
+  struct rtimer **p;
+
+  for(p = &next_rtimer; *p != NULL; p = &(*p)->next) {
+    if(*p == rtimer) {
+      *p = rtimer->next;
+      rtimer->next = NULL;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Queue a task at its extended time. Called with interrupts off. */
+static void
+insert(struct rtimer *rtimer)
+{
+  struct rtimer **p;
+
+  /* Insert after the tasks with the same time. */
+  for(p = &next_rtimer;
+      *p != NULL && !RTIMER_EXT_CLOCK_LT(rtimer->ext_time, (*p)->ext_time);
+      p = &(*p)->next);
+  rtimer->next = *p;
+  *p = rtimer;
+
+  if(next_rtimer == rtimer) {
+    schedule_first();
+  }
+}
+/*---------------------------------------------------------------------------*/
 int
 rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 	   rtimer_clock_t duration,
 	   rtimer_callback_t func, void *ptr)
 {
-  int first = 0;
+  rtimer_ext_clock_t now;
+  spl_t s;
 
   PRINTF("rtimer_set time %d\n", time);
 
-  if(next_rtimer == NULL) {
-    first = 1;
-  }
+  s = splhigh();
+  remove(rtimer);
 
   rtimer->func = func;
   rtimer->ptr = ptr;
 
+  /* Late if at most RTIMER_LATE_MAX ticks in the past, else ahead. */
+  now = RTIMER_NOW_EXT();
   rtimer->time = time;
-  next_rtimer = rtimer;
+  rtimer->ext_time = now - RTIMER_LATE_MAX +
+    (rtimer_clock_t)(time - (rtimer_clock_t)now + RTIMER_LATE_MAX);
 
-  if(first == 1) {
-    rtimer_arch_schedule(time);
-  }
+  insert(rtimer);
+  splx(s);
+  return RTIMER_OK;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_set_ext(struct rtimer *rtimer, rtimer_ext_clock_t time,
+	       rtimer_clock_t duration,
+	       rtimer_callback_t func, void *ptr)
+{
+  spl_t s;
+
+  PRINTF("rtimer_set_ext time %lu\n", time);
+
+  s = splhigh();
+  remove(rtimer);
+
+  rtimer->func = func;
+  rtimer->ptr = ptr;
+
+  rtimer->time = (rtimer_clock_t)time;
+  rtimer->ext_time = time;
+
+  insert(rtimer);
+  splx(s);
   return RTIMER_OK;
 }
 /*---------------------------------------------------------------------------*/
 void
+rtimer_stop(struct rtimer *rtimer)
+{
+  spl_t s;
+
+  s = splhigh();
+  if(rtimer == next_rtimer) {
+    remove(rtimer);
+    schedule_first();
+  } else {
+    remove(rtimer);
+  }
+  splx(s);
+}
+/*---------------------------------------------------------------------------*/
+void
 rtimer_run_next(void)
 {
   struct rtimer *t;
-  if(next_rtimer == NULL) {
+  spl_t s;
+
+  s = splhigh();
+  t = next_rtimer;
+  if(t == NULL || RTIMER_EXT_CLOCK_LT(RTIMER_NOW_EXT(), t->ext_time)) {
+    /* Nothing due yet: the first task is more than half a counter
+       period ahead, or it was stopped or rescheduled. */
+    schedule_first();
+    splx(s);
     return;
   }
-  t = next_rtimer;
-  next_rtimer = NULL;
+  next_rtimer = t->next;
+  t->next = NULL;
+  splx(s);
+
   t->func(t, t->ptr);
-  if(next_rtimer != NULL) {
-    rtimer_arch_schedule(next_rtimer->time);
-  }
-  return;
+
+  /* One task per call: a late successor gets its own interrupt. */
+  s = splhigh();
+  schedule_first();
+  splx(s);
 }
 /*---------------------------------------------------------------------------*/
@@ -60,6 +60,39 @@ typedef unsigned short rtimer_clock_t;
 #define RTIMER_CLOCK_LT(a,b)     ((signed short)((a)-(b)) < 0)
 #endif /* RTIMER_CLOCK_LT */
 
+/**
+ * The rtimer clock extended to 32 bits by counting its wraps, so that
+ * times more than one counter period apart can be told apart (2^32
+ * ticks are more than 36 hours at 32 kHz).
+ */
+typedef unsigned long rtimer_ext_clock_t;
+#define RTIMER_EXT_CLOCK_LT(a,b) ((signed long)((a)-(b)) < 0)
+
+/**
+ * \brief      How late a task may be and still be run at once
+ *
+ *             A task set with rtimer_set() at a time at most this
+ *             many ticks in the past is late and is run as soon as
+ *             possible; any other time lies in the future, up to one
+ *             counter period minus RTIMER_LATE_MAX ahead.
+ */
+#ifdef RTIMER_CONF_LATE_MAX
+#define RTIMER_LATE_MAX RTIMER_CONF_LATE_MAX
+#else
+#define RTIMER_LATE_MAX 8192
+#endif /* RTIMER_CONF_LATE_MAX */
+
+/**
+ * \brief      Smallest distance from the current time at which the
+ *             hardware timer is programmed, so that the compare match
+ *             is not missed while it is being set.
+ */
+#ifdef RTIMER_CONF_GUARD
+#define RTIMER_GUARD RTIMER_CONF_GUARD
+#else
+#define RTIMER_GUARD 2
+#endif /* RTIMER_CONF_GUARD */
+
 /**
  * \brief      Initialize the real-time scheduler.
  *
@@ -83,6 +116,8 @@ struct rtimer {
   rtimer_clock_t time;
   rtimer_callback_t func;
   void *ptr;
+  struct rtimer *next;
+  rtimer_ext_clock_t ext_time;
 };
 
 enum {
@@ -103,17 +138,61 @@ enum {
  *             (false) if the task could not be scheduled.
  *
  *             This function schedules a real-time task at a specified
- *             time in the future.
+ *             time in the future. The pending tasks are kept in a
+ *             queue ordered by time, so several tasks can be
+ *             scheduled at once; setting a task that is already
+ *             pending reschedules it. A task set at most
+ *             RTIMER_LATE_MAX ticks in the past runs as soon as
+ *             possible.
  *
  */
 int rtimer_set(struct rtimer *task, rtimer_clock_t time,
 	       rtimer_clock_t duration, rtimer_callback_t func, void *ptr);
 
+/**
+ * \brief      Post a real-time task at an extended time.
+ * \param task A pointer to the task variable previously declared with RTIMER_TASK().
+ * \param time The time when the task is to be executed, on the extended clock.
+ * \param duration Unused argument.
+ * \param func A function to be called when the task is executed.
+ * \param ptr An opaque pointer that will be supplied as an argument to the callback function.
+ * \return     As rtimer_set().
+ *
+ *             As rtimer_set(), but the time may lie any number of
+ *             counter periods in the future: the hardware timer is
+ *             programmed at most half a period ahead until the task
+ *             is due. A task set in the past runs as soon as
+ *             possible.
+ */
+int rtimer_set_ext(struct rtimer *task, rtimer_ext_clock_t time,
+		   rtimer_clock_t duration, rtimer_callback_t func, void *ptr);
+
+/**
+ * \brief      Extend a time of the rtimer clock to 32 bits.
+ * \param t    A time less than half a counter period away from now.
+ * \return     The same time on the extended clock.
+ */
+rtimer_ext_clock_t rtimer_extend(rtimer_clock_t t);
+
+/**
+ * \brief      Cancel a pending real-time task.
+ * \param task A pointer to the task.
+ *
+ *             This function removes the task from the queue, so that
+ *             its callback is not called. Nothing happens if the task
+ *             is not pending.
+ */
+void rtimer_stop(struct rtimer *task);
+
 /**
  * \brief      Execute the next real-time task and schedule the next task, if any
  *
  *             This function is called by the architecture dependent
  *             code to execute and schedule the next real-time task.
+ *             It runs at most one task per call: if the next task is
+ *             already late, the hardware timer is programmed
+ *             RTIMER_GUARD ticks ahead, which bounds the time spent in
+ *             the timer interrupt.
  *
  */
 void rtimer_run_next(void);
@@ -131,6 +210,19 @@ void rtimer_run_next(void);
 #define RTIMER_NOW() rtimer_arch_now()
 #define RTIMER_NOW_DCO() rtimer_arch_now_dco()
 
+/**
+ * \brief      Get the current time on the extended clock
+ * \return     The current time, extended to 32 bits
+ *
+ *             The wraps of the rtimer clock are counted whenever this
+ *             function is called, so it must be called at least once
+ *             per counter period; the clock module of the platform
+ *             takes care of that.
+ *
+ * \hideinitializer
+ */
+#define RTIMER_NOW_EXT() rtimer_arch_now_ext()
+
 /**
  * \brief      Get the time that a task last was executed
  * \param task The task
@@ -144,8 +236,16 @@ void rtimer_run_next(void);
  */
 #define RTIMER_TIME(task) ((task)->time)
 
+/**
+ * \brief      Get the time that a task last was executed, on the extended clock
+ *
+ * \hideinitializer
+ */
+#define RTIMER_TIME_EXT(task) ((task)->ext_time)
+
 void rtimer_arch_init(void);
 void rtimer_arch_schedule(rtimer_clock_t t);
+rtimer_ext_clock_t rtimer_arch_now_ext(void);
 /*rtimer_clock_t rtimer_arch_now(void);*/
 
 #define RTIMER_SECOND RTIMER_ARCH_SECOND
@@ -46,6 +46,166 @@
 
 #define MAX_TICKS (~((clock_time_t)0) / 2)
 
+/* Make sure the CLOCK_CONF_SECOND is a power of two, to ensure
+   that the divisions by INTERVAL become shifts. Algorithm from
+   Wikipedia: http://en.wikipedia.org/wiki/Power_of_two */
+#if (CLOCK_CONF_SECOND & (CLOCK_CONF_SECOND - 1)) != 0
+#error CLOCK_CONF_SECOND must be a power of two (i.e., 1, 2, 4, 8, 16, 32, 64, ...).
+#error Change CLOCK_CONF_SECOND in contiki-conf.h.
+#endif
+
+/* Without a tick, TACCR1 is only programmed to the next etimer
+   expiration, and clock_time() is derived from TAR and the number of
+   times it wrapped. */
+#ifdef CLOCK_CONF_TICKLESS
+#define CLOCK_TICKLESS CLOCK_CONF_TICKLESS
+#else
+#define CLOCK_TICKLESS 1
+#endif /* CLOCK_CONF_TICKLESS */
+
+#if CLOCK_TICKLESS
+
+/* TAR wraps every two seconds. The wraps are counted by the rtimer
+   module whenever TAR is read, and TACCR1 fires at least every half
+   wrap so that none is missed. */
+#define HALF_WRAP 0x8000U
+
+/* set by clock_set() */
+static clock_time_t offset;
+/*---------------------------------------------------------------------------*/
+/* Program TACCR1 to the start of the tick at which the next etimer
+   expires, or half a wrap ahead if it expires later. Returns non-zero
+   if an etimer is due, after requesting its poll. Called with
+   interrupts off. */
+static int
+program_wakeup(void)
+{
+  clock_time_t now, left;
+  unsigned short tar, next;
+  unsigned long wraps;
+  int due;
+
+  tar = rtimer_arch_now_wraps(&wraps);
+  now = offset + wraps * (0x10000UL / INTERVAL) + tar / INTERVAL;
+  next = tar + HALF_WRAP;
+  due = 0;
+  if(etimer_pending()) {
+    left = etimer_next_expiration_time() - now;
+    if(left == 0 || left > MAX_TICKS) {
+      etimer_request_poll();
+      due = 1;
+    } else if(left < HALF_WRAP / INTERVAL) {
+      next = (tar & ~(INTERVAL - 1)) + (unsigned short)left * INTERVAL;
+    }
+  }
+  /* A compare value at or just past TAR only matches after a wrap. */
+  if((unsigned short)(next - tar) < RTIMER_GUARD) {
+    next = tar + RTIMER_GUARD;
+  }
+  TACCR1 = next;
+  return due;
+}
+/*---------------------------------------------------------------------------*/
+interrupt(TIMERA1_VECTOR) timera1 (void) {
+  ENERGEST_ON(ENERGEST_TYPE_IRQ);
+
+  if(TAIV == 2) {
+    /* Runs at least every half wrap: flush the energest times before
+       their 16-bit differences wrap. */
+    energest_flush();
+    if(program_wakeup()) {
+      LPM4_EXIT;
+    }
+  }
+
+  ENERGEST_OFF(ENERGEST_TYPE_IRQ);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_interrupt(void)
+{
+  program_wakeup();
+}
+/*---------------------------------------------------------------------------*/
+void
+clock_schedule_wakeup(void)
+{
+  program_wakeup();
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+clock_time(void)
+{
+  unsigned long wraps;
+  unsigned short tar;
+
+  tar = rtimer_arch_now_wraps(&wraps);
+  return offset + wraps * (0x10000UL / INTERVAL) + tar / INTERVAL;
+}
+/*---------------------------------------------------------------------------*/
+void
+clock_set(clock_time_t clock, clock_time_t fclock)
+{
+  spl_t s;
+
+  /* TAR is shared with the rtimer module: only the clock is moved,
+     fclock is ignored. */
+  s = splhigh();
+  offset = 0;
+  offset = clock - clock_time();
+  program_wakeup();
+  splx(s);
+}
+/*---------------------------------------------------------------------------*/
+int
+clock_fine_max(void)
+{
+  return INTERVAL;
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+clock_fine(void)
+{
+  unsigned long wraps;
+
+  return rtimer_arch_now_wraps(&wraps) & (INTERVAL - 1);
+}
+/*---------------------------------------------------------------------------*/
+void
+clock_init(void)
+{
+  dint();
+
+  /* Select ACLK 32768Hz clock, divide by 1 */
+  TACTL = TASSEL0 | TACLR;
+
+  /* CCR1 interrupt enabled, interrupt occurs when timer equals CCR1. */
+  TACCTL1 = CCIE;
+
+  /* Wake up after half a wrap, until an etimer is set. */
+  TACCR1 = HALF_WRAP;
+
+  /* Start Timer_A in continuous mode. */
+  TACTL |= MC1;
+
+  offset = 0;
+
+  /* Enable interrupts. */
+  eint();
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+clock_seconds(void)
+{
+  unsigned long wraps;
+  unsigned short tar;
+
+  tar = rtimer_arch_now_wraps(&wraps);
+  return wraps * (0x10000UL / RTIMER_ARCH_SECOND) + tar / RTIMER_ARCH_SECOND;
+}
+
+#else /* CLOCK_TICKLESS */
+
 static volatile unsigned long seconds;
 
 static volatile clock_time_t count = 0;
@@ -79,22 +239,21 @@ do {
   /*      TACTL |= MC1;*/
   ++count;
 
-  /* Make sure the CLOCK_CONF_SECOND is a power of two, to ensure
- that the modulo operation below becomes a logical and and not
- an expensive divide. Algorithm from Wikipedia:
- http://en.wikipedia.org/wiki/Power_of_two */
-#if (CLOCK_CONF_SECOND & (CLOCK_CONF_SECOND - 1)) != 0
-#error CLOCK_CONF_SECOND must be a power of two (i.e., 1, 2, 4, 8, 16, 32, 64, ...).
-#error Change CLOCK_CONF_SECOND in contiki-conf.h.
-#endif
   if(count % CLOCK_CONF_SECOND == 0) {
 ++seconds;
 	energest_flush();
+	/* count the wraps of TAR for the extended rtimer clock */
+	rtimer_arch_now_ext();
   }
 } while((TACCR1 - TAR) > INTERVAL);
 
 last_tar = TAR;
 
+}
+/*---------------------------------------------------------------------------*/
+void
+clock_schedule_wakeup(void)
+{
 }
 /*---------------------------------------------------------------------------*/
 clock_time_t
@@ -160,6 +319,19 @@ clock_init(void)
 
 }
 /*---------------------------------------------------------------------------*/
+unsigned long
+clock_seconds(void)
+{
+  unsigned long t1, t2;
+  do {
+    t1 = seconds;
+    t2 = seconds;
+  } while(t1 != t2);
+  return t1;
+}
+
+#endif /* CLOCK_TICKLESS */
+/*---------------------------------------------------------------------------*/
 /**
  * Delay the CPU for a multiple of 2.83 us.
  */
@@ -196,17 +368,6 @@ void
 clock_set_seconds(unsigned long sec)
 {
 
-}
-/*---------------------------------------------------------------------------*/
-unsigned long
-clock_seconds(void)
-{
-  unsigned long t1, t2;
-  do {
-    t1 = seconds;
-    t2 = seconds;
-  } while(t1 != t2);
-  return t1;
 }
 /*---------------------------------------------------------------------------*/
 rtimer_clock_t
@@ -52,6 +52,10 @@
 #define PRINTF(...)
 #endif
 
+/* Wraps of TAR since boot, counted whenever it is read. */
+static unsigned long wraps;
+static rtimer_clock_t last_tar;
+
 /*---------------------------------------------------------------------------*/
 interrupt(TIMERA0_VECTOR) timera0 (void) {
   ENERGEST_ON(ENERGEST_TYPE_IRQ);
@@ -76,6 +80,37 @@ rtimer_arch_init(void)
   eint();
 }
 /*---------------------------------------------------------------------------*/
+rtimer_clock_t
+rtimer_arch_now_wraps(unsigned long *w)
+{
+  rtimer_clock_t tar;
+  spl_t s;
+
+  s = splhigh();
+  /* TAR runs from ACLK, asynchronously to the CPU: read it until two
+     reads agree. */
+  do {
+    tar = TAR;
+  } while(tar != TAR);
+  if(tar < last_tar) {
+    ++wraps;
+  }
+  last_tar = tar;
+  *w = wraps;
+  splx(s);
+  return tar;
+}
+/*---------------------------------------------------------------------------*/
+rtimer_ext_clock_t
+rtimer_arch_now_ext(void)
+{
+  unsigned long w;
+  rtimer_clock_t tar;
+
+  tar = rtimer_arch_now_wraps(&w);
+  return (w << 16) | tar;
+}
+/*---------------------------------------------------------------------------*/
 void
 rtimer_arch_schedule(rtimer_clock_t t)
 {
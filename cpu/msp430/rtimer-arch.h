@@ -49,4 +49,16 @@
 #define rtimer_arch_now() (TAR)
 #define rtimer_arch_now_dco() (TBR)
 
+/**
+ * \brief      Read TAR and the number of times it wrapped since boot.
+ * \param w    Pointer to the number of wraps.
+ * \return     The value of TAR.
+ *
+ *             The wraps are counted whenever TAR is read through this
+ *             function (or rtimer_arch_now_ext()), which must thus
+ *             happen at least once per wrap; the clock module does it
+ *             at least once a second.
+ */
+unsigned short rtimer_arch_now_wraps(unsigned long *w);
+
 #endif /* __RTIMER_ARCH_H__ */
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Native clock module, derived from the same monotonic time base
+ *         as the rtimer module.
+ */
+
+#include "contiki-conf.h"
+
+#include "sys/clock.h"
+#include "sys/etimer.h"
+#include "rtimer-arch.h"
+
+#define NS_PER_TICK (1000000000ULL / CLOCK_SECOND)
+
+#define MAX_TICKS (~((clock_time_t)0) / 2)
+
+/*---------------------------------------------------------------------------*/
+void
+etimer_interrupt(void)
+{
+  /* Poll the etimer process once the next etimer is due, like the
+     Timer A1 interrupt does on the mote. */
+  if(etimer_pending() &&
+     (etimer_next_expiration_time() - clock_time() - 1) > MAX_TICKS) {
+    etimer_request_poll();
+  }
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+clock_time(void)
+{
+  return (clock_time_t)(rtimer_arch_ns() / NS_PER_TICK);
+}
+/*---------------------------------------------------------------------------*/
+int
+clock_fine_max(void)
+{
+  return RTIMER_ARCH_SECOND / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+clock_fine(void)
+{
+  return (unsigned short)((rtimer_arch_ns() % NS_PER_TICK) *
+                          RTIMER_ARCH_SECOND / 1000000000ULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+clock_init(void)
+{
+  /* Latch the boot time. */
+  rtimer_arch_ns();
+}
+/*---------------------------------------------------------------------------*/
+/**
+ * Delay the CPU for a multiple of DCO ticks (about 0.24 us each).
+ */
+void
+clock_delay(unsigned int i)
+{
+  rtimer_arch_delay_dco(i);
+}
+/*---------------------------------------------------------------------------*/
+void
+clock_wait(int i)
+{
+  clock_time_t start;
+
+  start = clock_time();
+  while(clock_time() - start < (clock_time_t)i);
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+clock_seconds(void)
+{
+  return (unsigned long)(rtimer_arch_ns() / 1000000000ULL);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Register file and CPU intrinsics of the native target.
+ */
+
+#include <legacymsp430.h>
+#include "nativedef.h"
+
+volatile uint8_t IE1, IE2, IFG1, IFG2, ME1, ME2;
+
+volatile uint8_t P1IN, P1OUT, P1DIR, P1IFG, P1IES, P1IE, P1SEL;
+volatile uint8_t P2IN, P2OUT, P2DIR, P2IFG, P2IES, P2IE, P2SEL;
+volatile uint8_t P3IN, P3OUT, P3DIR, P3SEL;
+volatile uint8_t P4IN, P4OUT, P4DIR, P4SEL;
+volatile uint8_t P5IN, P5OUT, P5DIR, P5SEL;
+
+volatile uint8_t U0CTL, U0TCTL, U0BR0, U0BR1, U0MCTL, U0RXBUF, U0TXBUF;
+
+volatile uint8_t CACTL1;
+volatile uint16_t DMA0CTL, DMA1CTL, DMA2CTL;
+
+volatile uint16_t TACTL, TAR, TAIV;
+volatile uint16_t TACCTL0, TACCTL1, TACCTL2;
+volatile uint16_t TACCR0, TACCR1, TACCR2;
+
+volatile uint16_t TBCTL, TBR, TBIV;
+volatile uint16_t TBCCTL0, TBCCTL1, TBCCTL2, TBCCTL3, TBCCTL4, TBCCTL5, TBCCTL6;
+volatile uint16_t TBCCR0, TBCCR1, TBCCR2, TBCCR3, TBCCR4, TBCCR5, TBCCR6;
+
+/* Emulated GIE bit of the status register. */
+static volatile int sr_gie;
+/*---------------------------------------------------------------------------*/
+void
+dint(void)
+{
+  sr_gie = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+eint(void)
+{
+  sr_gie = GIE;
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+read_sr(void)
+{
+  return sr_gie;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Mask all interrupts that can be masked.
+ */
+spl_t
+splhigh_(void)
+{
+  spl_t sr = sr_gie;
+  sr_gie = 0;
+  return sr;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Restore previous interrupt mask.
+ */
+void
+splx_(spl_t sr)
+{
+  sr_gie |= sr;
+}
+/*---------------------------------------------------------------------------*/
+void
+msp430_cpu_init(void)
+{
+  dint();
+  P1IE = 0;
+  P2IE = 0;
+  eint();
+}
+/*---------------------------------------------------------------------------*/
+void
+msp430_sync_dco(void)
+{
+  /* The host clock never drifts away from F_CPU: nothing to do. */
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Host stand-in for the mspgcc <legacymsp430.h> header.
+ *
+ *         Peripheral registers of the MSP430F1611 are plain variables
+ *         (see legacymsp430.c), so that drivers written against the
+ *         hardware (Glossy, the CC2420 driver) compile and run unchanged
+ *         on the native target. Only the registers and bits actually
+ *         referenced by the portable code are provided.
+ */
+
+#ifndef LEGACYMSP430_H_
+#define LEGACYMSP430_H_
+
+#include <stdint.h>
+
+#define interrupt(vector)   void
+
+#ifndef BV
+#define BV(x)               (1 << (x))
+#endif /* BV */
+
+void dint(void);
+void eint(void);
+unsigned short read_sr(void);
+
+#define READ_SR             read_sr()
+
+/* Status register bits */
+#define GIE                 0x0008
+
+/* Special function registers */
+extern volatile uint8_t IE1, IE2, IFG1, IFG2, ME1, ME2;
+
+/* Digital I/O ports */
+extern volatile uint8_t P1IN, P1OUT, P1DIR, P1IFG, P1IES, P1IE, P1SEL;
+extern volatile uint8_t P2IN, P2OUT, P2DIR, P2IFG, P2IES, P2IE, P2SEL;
+extern volatile uint8_t P3IN, P3OUT, P3DIR, P3SEL;
+extern volatile uint8_t P4IN, P4OUT, P4DIR, P4SEL;
+extern volatile uint8_t P5IN, P5OUT, P5DIR, P5SEL;
+
+/* USART0 in SPI mode */
+extern volatile uint8_t U0CTL, U0TCTL, U0BR0, U0BR1, U0MCTL, U0RXBUF, U0TXBUF;
+
+/* Comparator A and DMA */
+extern volatile uint8_t CACTL1;
+extern volatile uint16_t DMA0CTL, DMA1CTL, DMA2CTL;
+#define CAIE                0x02
+#define DMAIE               0x0004
+
+/* Timer A (32 kHz ACLK) */
+extern volatile uint16_t TACTL, TAR, TAIV;
+extern volatile uint16_t TACCTL0, TACCTL1, TACCTL2;
+extern volatile uint16_t TACCR0, TACCR1, TACCR2;
+
+/* Timer B (DCO) */
+extern volatile uint16_t TBCTL, TBR, TBIV;
+extern volatile uint16_t TBCCTL0, TBCCTL1, TBCCTL2, TBCCTL3, TBCCTL4, TBCCTL5, TBCCTL6;
+extern volatile uint16_t TBCCR0, TBCCR1, TBCCR2, TBCCR3, TBCCR4, TBCCR5, TBCCR6;
+
+/* Timer control bits */
+#define TASSEL1             0x0200
+#define TASSEL0             0x0100
+#define TBSSEL1             0x0200
+#define TBSSEL0             0x0100
+#define MC1                 0x0020
+#define MC0                 0x0010
+#define TACLR               0x0004
+
+/* Capture/compare control bits */
+#define CM_3                0xc000
+#define CM_2                0x8000
+#define CM_1                0x4000
+#define CM0                 0x4000
+#define CCIS0               0x1000
+#define SCS                 0x0800
+#define CAP                 0x0100
+#define CCIE                0x0010
+#define CCIFG               0x0001
+
+/* Timer B interrupt vector values */
+#define TBIV_NONE           0x0000
+#define TBIV_TBCCR1         0x0002
+#define TBIV_TBCCR2         0x0004
+#define TBIV_TBCCR3         0x0006
+#define TBIV_TBCCR4         0x0008
+#define TBIV_TBCCR5         0x000a
+#define TBIV_TBCCR6         0x000c
+#define TBIV_TBIFG          0x000e
+
+#endif /* LEGACYMSP430_H_ */
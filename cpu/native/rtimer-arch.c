@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Native rtimer code, backed by the POSIX monotonic clock.
+ */
+
+#include <time.h>
+
+#include "contiki-conf.h"
+#include "sys/rtimer.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+#define NS_PER_SECOND 1000000000ULL
+
+static unsigned long long boot_ns;
+static rtimer_clock_t next_time;
+static volatile int scheduled;
+
+/*---------------------------------------------------------------------------*/
+static unsigned long long
+monotonic_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * NS_PER_SECOND + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long long
+ns_to_ticks(unsigned long long ns, unsigned long long hz)
+{
+  /* Split the conversion to avoid overflowing 64 bits at DCO rates. */
+  return (ns / NS_PER_SECOND) * hz + (ns % NS_PER_SECOND) * hz / NS_PER_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long long
+rtimer_arch_ns(void)
+{
+  if(boot_ns == 0) {
+    boot_ns = monotonic_ns();
+  }
+  return monotonic_ns() - boot_ns;
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+rtimer_arch_now(void)
+{
+  return (rtimer_clock_t)ns_to_ticks(rtimer_arch_ns(), RTIMER_ARCH_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+rtimer_ext_clock_t
+rtimer_arch_now_ext(void)
+{
+  return (rtimer_ext_clock_t)ns_to_ticks(rtimer_arch_ns(), RTIMER_ARCH_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+rtimer_arch_now_dco(void)
+{
+  return (rtimer_clock_t)ns_to_ticks(rtimer_arch_ns(), F_CPU);
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_delay_dco(unsigned short ticks)
+{
+  rtimer_clock_t start = rtimer_arch_now_dco();
+  while((rtimer_clock_t)(rtimer_arch_now_dco() - start) < ticks);
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_capture_next_tick(rtimer_clock_t *t_cap_h, rtimer_clock_t *t_cap_l)
+{
+  unsigned long long tick, ns;
+
+  tick = ns_to_ticks(rtimer_arch_ns(), RTIMER_ARCH_SECOND) + 1;
+  /* First nanosecond belonging to the next 32 kHz tick. */
+  ns = (tick * NS_PER_SECOND + RTIMER_ARCH_SECOND - 1) / RTIMER_ARCH_SECOND;
+  while(rtimer_arch_ns() < ns);
+  *t_cap_h = (rtimer_clock_t)ns_to_ticks(ns, F_CPU);
+  *t_cap_l = (rtimer_clock_t)tick;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_init(void)
+{
+  scheduled = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_schedule(rtimer_clock_t t)
+{
+  PRINTF("rtimer_arch_schedule time %u\n", t);
+
+  next_time = t;
+  scheduled = 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_arch_pending(void)
+{
+  return scheduled;
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+rtimer_arch_usecs_left(void)
+{
+  signed short left = (signed short)(next_time - rtimer_arch_now());
+
+  /* Unlike the Timer A compare unit, a deadline already in the past
+     fires immediately instead of after the next counter wrap. */
+  if(!scheduled || left <= 0) {
+    return 0;
+  }
+  return (unsigned long)left * 1000000UL / RTIMER_ARCH_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_run(void)
+{
+  if(scheduled && !RTIMER_CLOCK_LT(rtimer_arch_now(), next_time)) {
+    scheduled = 0;
+    rtimer_run_next();
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Header file for the native rtimer code
+ *
+ *         The 32 kHz and DCO clocks of the Tmote Sky are derived from the
+ *         host monotonic clock and keep their 16-bit width, so that code
+ *         relying on RTIMER_CLOCK_LT and on counter wraps behaves as on
+ *         the mote.
+ */
+
+#ifndef __RTIMER_ARCH_H__
+#define __RTIMER_ARCH_H__
+
+typedef unsigned short rtimer_clock_t;
+#define RTIMER_CLOCK_LT(a,b)     ((signed short)((a)-(b)) < 0)
+
+#include "sys/rtimer.h"
+
+#define RTIMER_ARCH_SECOND (32768U)
+
+rtimer_clock_t rtimer_arch_now(void);
+rtimer_clock_t rtimer_arch_now_dco(void);
+
+/**
+ * \brief      Nanoseconds elapsed since boot, the time base of the native
+ *             target shared by the rtimer and clock modules.
+ */
+unsigned long long rtimer_arch_ns(void);
+
+/**
+ * \brief      Busy-wait for the given number of DCO ticks.
+ */
+void rtimer_arch_delay_dco(unsigned short ticks);
+
+/**
+ * \brief      Wait for the next 32 kHz tick and return the value of both
+ *             clocks at that instant (host version of the Timer A2/B6
+ *             capture used by Glossy).
+ */
+void rtimer_arch_capture_next_tick(rtimer_clock_t *t_cap_h, rtimer_clock_t *t_cap_l);
+
+/**
+ * \brief      Check if an rtimer is armed.
+ */
+int rtimer_arch_pending(void);
+
+/**
+ * \brief      Microseconds left until the armed rtimer expires
+ *             (zero if it is due).
+ */
+unsigned long rtimer_arch_usecs_left(void);
+
+/**
+ * \brief      Run the armed rtimer if it is due.
+ *
+ *             Called from the scheduler loop in place of the Timer A0
+ *             interrupt of the mote.
+ */
+void rtimer_arch_run(void);
+
+#endif /* __RTIMER_ARCH_H__ */
@@ -0,0 +1,116 @@
+/* -*- C -*- */
+
+#ifndef CONTIKI_CONF_H
+#define CONTIKI_CONF_H
+
+/*
+ * Configuration of the native target: a host process that emulates a
+ * Tmote Sky closely enough to run the Contiki kernel, the rtimer and
+ * Glossy without flashing a mote.
+ */
+
+#define COOJA 0
+#define TINYOS_SERIAL_FRAMES 0
+
+#ifndef RF_CHANNEL
+#define RF_CHANNEL              26
+#endif /* RF_CHANNEL */
+
+#define ENERGEST_CONF_ON 1
+
+#include "nativedef.h"
+
+#define CCIF
+#define CLIF
+
+#define PROCESS_CONF_NUMEVENTS 8
+#define PROCESS_CONF_STATS 1
+
+/* Emulated CPU speed in Hz (same as the Tmote Sky DCO setting) */
+#define F_CPU 4194304uL
+
+/* Our clock resolution, this is the same as Unix HZ. */
+#define CLOCK_CONF_SECOND 128UL
+
+#define BAUD2UBR(baud) ((F_CPU/baud))
+
+typedef unsigned long clock_time_t;
+
+#define ROM_ERASE_UNIT_SIZE  512
+#define XMEM_ERASE_UNIT_SIZE (64*1024L)
+
+/* Use the first 64k of external flash for node configuration */
+#define NODE_ID_XMEM_OFFSET     (0 * XMEM_ERASE_UNIT_SIZE)
+
+/*
+ * SPI bus configuration. Every byte written to SPI_TXBUF is exchanged
+ * with the CC2420 model (dev/cc2420-arch.c) when the driver waits for
+ * the end of the transfer.
+ */
+
+void cc2420_arch_select(int selected);
+int cc2420_arch_selected(void);
+unsigned char cc2420_arch_spi(unsigned char c);
+int cc2420_arch_fifo(void);
+int cc2420_arch_fifop(void);
+int cc2420_arch_cca(void);
+int cc2420_arch_sfd(void);
+
+/* SPI input/output registers. */
+#define SPI_TXBUF U0TXBUF
+#define SPI_RXBUF U0RXBUF
+
+#define	SPI_WAITFOREOTx() do { U0RXBUF = cc2420_arch_spi(U0TXBUF); } while(0)
+#define	SPI_WAITFOREORx() do { U0RXBUF = cc2420_arch_spi(U0TXBUF); } while(0)
+
+/*
+ * CC2420 pin configuration.
+ */
+
+#define FIFO_P         0  /* P1.0 - Input: FIFOP from CC2420 */
+#define FIFO           3  /* P1.3 - Input: FIFO from CC2420 */
+#define CCA            4  /* P1.4 - Input: CCA from CC2420 */
+
+#define SFD            1  /* P4.1 - Input:  SFD from CC2420 */
+#define CSN            2  /* P4.2 - Output: SPI Chip Select (CS_N) */
+#define VREG_EN        5  /* P4.5 - Output: VREG_EN to CC2420 */
+#define RESET_N        6  /* P4.6 - Output: RESET_N to CC2420 */
+
+/* Pin status. */
+
+#define FIFO_IS_1       (!!cc2420_arch_fifo())
+#define CCA_IS_1        (!!cc2420_arch_cca())
+#define RESET_IS_1      1
+#define VREG_IS_1       1
+#define FIFOP_IS_1      (!!cc2420_arch_fifop())
+#define SFD_IS_1        (!!cc2420_arch_sfd())
+
+/* The CC2420 reset pin. */
+#define SET_RESET_INACTIVE()    ( P4OUT |=  BV(RESET_N) )
+#define SET_RESET_ACTIVE()      ( P4OUT &= ~BV(RESET_N) )
+
+/* CC2420 voltage regulator enable pin. */
+#define SET_VREG_ACTIVE()       ( P4OUT |=  BV(VREG_EN) )
+#define SET_VREG_INACTIVE()     ( P4OUT &= ~BV(VREG_EN) )
+
+/* CC2420 rising edge trigger for external interrupt 0 (FIFOP). */
+#define FIFOP_INT_INIT() do {\
+  P1IES &= ~BV(FIFO_P);\
+  CLEAR_FIFOP_INT();\
+} while (0)
+
+/* FIFOP on external interrupt 0. */
+#define ENABLE_FIFOP_INT()          do { P1IE |= BV(FIFO_P); } while (0)
+#define DISABLE_FIFOP_INT()         do { P1IE &= ~BV(FIFO_P); } while (0)
+#define CLEAR_FIFOP_INT()           do { P1IFG &= ~BV(FIFO_P); } while (0)
+
+/* Enables/disables CC2420 access to the SPI bus (active low CSn). */
+#define SPI_ENABLE()       cc2420_arch_select(1)
+#define SPI_DISABLE()      cc2420_arch_select(0)
+#define SPI_IS_ENABLED()   cc2420_arch_selected()
+
+#ifdef PROJECT_CONF_H
+#include PROJECT_CONF_H
+#endif /* PROJECT_CONF_H */
+
+#endif /* CONTIKI_CONF_H */
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Main loop of the native target.
+ *
+ *         Usage: <program>.native [node-id]
+ *
+ *         Without a node id on the command line, the id stored in the
+ *         (initially empty) external flash is used, as on the mote.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+
+#include "dev/cc2420.h"
+#include "dev/leds.h"
+#include "dev/uart1.h"
+#include "dev/watchdog.h"
+#include "dev/xmem.h"
+
+#include "node-id.h"
+#include "sys/autostart.h"
+
+/* Longest nap when neither an etimer nor an rtimer is pending, in us. */
+#define IDLE_MAX_USECS 1000000UL
+
+#define MAX_TICKS (~((clock_time_t)0) / 2)
+
+/*---------------------------------------------------------------------------*/
+static void
+print_processes(struct process * const processes[])
+{
+  /*  const struct process * const * p = processes;*/
+  printf("Starting");
+  while(*processes != NULL) {
+    printf(" '%s'", (*processes)->name);
+    processes++;
+  }
+  putchar('\n');
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+etimer_usecs_left(void)
+{
+  clock_time_t next = etimer_next_expiration_time();
+  unsigned long long next_ns, now_ns;
+
+  if(next - clock_time() - 1 > MAX_TICKS) {
+    /* Already expired. */
+    return 0;
+  }
+  next_ns = (unsigned long long)next * 1000000000ULL / CLOCK_SECOND;
+  now_ns = rtimer_arch_ns();
+  return next_ns > now_ns ? (unsigned long)((next_ns - now_ns) / 1000) : 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+idle(void)
+{
+  unsigned long usecs = IDLE_MAX_USECS;
+  unsigned long left;
+  struct timespec ts;
+
+  if(etimer_pending()) {
+    left = etimer_usecs_left();
+    if(left < usecs) {
+      usecs = left;
+    }
+  }
+  if(rtimer_arch_pending()) {
+    left = rtimer_arch_usecs_left();
+    if(left < usecs) {
+      usecs = left;
+    }
+  }
+  if(usecs > 0) {
+    ts.tv_sec = usecs / 1000000UL;
+    ts.tv_nsec = (usecs % 1000000UL) * 1000UL;
+    nanosleep(&ts, NULL);
+  }
+}
+/*--------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  /*
+   * Initalize hardware.
+   */
+  msp430_cpu_init();
+  clock_init();
+  leds_init();
+
+  uart1_init(BAUD2UBR(115200)); /* Must come before first printf */
+
+  xmem_init();
+
+  rtimer_init();
+  /*
+   * Hardware initialization done!
+   */
+
+  if(argc > 1) {
+    node_id = atoi(argv[1]);
+  } else {
+    /* Restore node id if such has been stored in external mem */
+    node_id_restore();
+  }
+
+  /*
+   * Initialize Contiki and our processes.
+   */
+  process_init();
+  process_start(&etimer_process, NULL);
+
+  cc2420_init();
+  cc2420_set_channel(RF_CHANNEL);
+
+  printf(CONTIKI_VERSION_STRING " started. ");
+  if(node_id > 0) {
+    printf("Node id is set to %u.\n", node_id);
+  } else {
+    printf("Node id is not set.\n");
+  }
+
+  energest_init();
+  ENERGEST_ON(ENERGEST_TYPE_CPU);
+
+  watchdog_start();
+
+  print_processes(autostart_processes);
+  autostart_start(autostart_processes);
+
+  /*
+   * This is the scheduler loop.
+   */
+  while(1) {
+    int r;
+    do {
+      /* Deliver what the timer interrupts would have on the mote. */
+      rtimer_arch_run();
+      etimer_interrupt();
+      r = process_run();
+    } while(r > 0);
+
+    /*
+     * Idle processing: sleep until the next etimer or rtimer deadline.
+     */
+    ENERGEST_OFF(ENERGEST_TYPE_CPU);
+    ENERGEST_ON(ENERGEST_TYPE_LPM);
+    idle();
+    ENERGEST_OFF(ENERGEST_TYPE_LPM);
+    ENERGEST_ON(ENERGEST_TYPE_CPU);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Model of the CC2420 SPI interface for the native target.
+ *
+ *         The model decodes the byte stream exchanged over SPI (command
+ *         strobes, register accesses, TXFIFO and RXFIFO accesses) and
+ *         keeps the radio state needed by the driver and by Glossy. The
+ *         native radio is alone on its channel: transmitted frames are
+ *         dropped and nothing is ever received.
+ */
+
+#include <string.h>
+#include <legacymsp430.h>
+
+#include "contiki.h"
+#include "dev/cc2420_const.h"
+
+#define REG_ADDR_MASK     0x3f
+#define REG_READ          0x40
+#define RAM_ACCESS        0x80
+
+enum radio_mode {
+  MODE_VREG_ON,     /* crystal oscillator off */
+  MODE_IDLE,        /* oscillator stable, receiver and transmitter off */
+  MODE_RX,
+  MODE_TX
+};
+
+enum spi_access {
+  ACCESS_COMMAND,   /* next byte is a strobe or an address */
+  ACCESS_REG_MSB,
+  ACCESS_REG_LSB,
+  ACCESS_TXFIFO,
+  ACCESS_RXFIFO,
+  ACCESS_RAM
+};
+
+static uint8_t mode;
+static uint8_t selected;
+static uint8_t access, reg_addr, reg_read;
+static uint16_t regs[REG_ADDR_MASK + 1];
+
+static uint8_t txfifo[CC2420_FIFO_SIZE];
+static uint8_t txfifo_len;
+static uint8_t rxfifo[CC2420_FIFO_SIZE];
+static uint8_t rxfifo_len, rxfifo_read;
+
+/*---------------------------------------------------------------------------*/
+static uint8_t
+status_byte(void)
+{
+  uint8_t status = 0;
+  if(mode != MODE_VREG_ON) {
+    status |= BV(CC2420_XOSC16M_STABLE) | BV(CC2420_LOCK);
+  }
+  if(mode == MODE_RX) {
+    status |= BV(CC2420_RSSI_VALID);
+  }
+  if(mode == MODE_TX) {
+    status |= BV(CC2420_TX_ACTIVE);
+  }
+  return status;
+}
+/*---------------------------------------------------------------------------*/
+static void
+strobe(uint8_t s)
+{
+  switch(s) {
+  case CC2420_SXOSCON:
+    if(mode == MODE_VREG_ON) {
+      mode = MODE_IDLE;
+    }
+    break;
+  case CC2420_SRXON:
+    if(mode != MODE_VREG_ON) {
+      mode = MODE_RX;
+    }
+    break;
+  case CC2420_STXON:
+  case CC2420_STXONCCA:
+    if(mode != MODE_VREG_ON && txfifo_len > 0) {
+      /* Nobody listens: the frame is sent instantly and the radio
+         falls back to receive mode, as after a real transmission. */
+      mode = MODE_RX;
+    }
+    break;
+  case CC2420_SRFOFF:
+    if(mode != MODE_VREG_ON) {
+      mode = MODE_IDLE;
+    }
+    break;
+  case CC2420_SXOSCOFF:
+    mode = MODE_VREG_ON;
+    break;
+  case CC2420_SFLUSHRX:
+    rxfifo_len = rxfifo_read = 0;
+    break;
+  case CC2420_SFLUSHTX:
+    txfifo_len = 0;
+    break;
+  default:
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+cc2420_arch_select(int s)
+{
+  selected = s;
+  access = ACCESS_COMMAND;
+}
+/*---------------------------------------------------------------------------*/
+int
+cc2420_arch_selected(void)
+{
+  return selected;
+}
+/*---------------------------------------------------------------------------*/
+unsigned char
+cc2420_arch_spi(unsigned char c)
+{
+  uint8_t ret = status_byte();
+
+  if(!selected) {
+    return 0;
+  }
+
+  switch(access) {
+  case ACCESS_COMMAND:
+    if(c & RAM_ACCESS) {
+      /* RAM accesses carry a second address byte and are not modeled. */
+      access = ACCESS_RAM;
+    } else if((c & REG_ADDR_MASK) < CC2420_MAIN) {
+      strobe(c & REG_ADDR_MASK);
+    } else if((c & REG_ADDR_MASK) == CC2420_TXFIFO) {
+      access = ACCESS_TXFIFO;
+    } else if((c & REG_ADDR_MASK) == CC2420_RXFIFO) {
+      access = ACCESS_RXFIFO;
+    } else {
+      reg_addr = c & REG_ADDR_MASK;
+      reg_read = c & REG_READ;
+      access = ACCESS_REG_MSB;
+    }
+    break;
+  case ACCESS_REG_MSB:
+    if(reg_read) {
+      ret = regs[reg_addr] >> 8;
+    } else {
+      regs[reg_addr] = (regs[reg_addr] & 0x00ff) | ((uint16_t)c << 8);
+    }
+    access = ACCESS_REG_LSB;
+    break;
+  case ACCESS_REG_LSB:
+    if(reg_read) {
+      ret = regs[reg_addr] & 0xff;
+    } else {
+      regs[reg_addr] = (regs[reg_addr] & 0xff00) | c;
+    }
+    access = ACCESS_COMMAND;
+    break;
+  case ACCESS_TXFIFO:
+    if(txfifo_len < sizeof(txfifo)) {
+      txfifo[txfifo_len++] = c;
+    }
+    break;
+  case ACCESS_RXFIFO:
+    ret = (rxfifo_read < rxfifo_len) ? rxfifo[rxfifo_read++] : 0;
+    break;
+  case ACCESS_RAM:
+    break;
+  }
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+int
+cc2420_arch_fifo(void)
+{
+  return rxfifo_read < rxfifo_len;
+}
+/*---------------------------------------------------------------------------*/
+int
+cc2420_arch_fifop(void)
+{
+  /* FIFOP_THR is not modeled: FIFOP follows FIFO. */
+  return cc2420_arch_fifo();
+}
+/*---------------------------------------------------------------------------*/
+int
+cc2420_arch_cca(void)
+{
+  return mode == MODE_RX;
+}
+/*---------------------------------------------------------------------------*/
+int
+cc2420_arch_sfd(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         RAM-backed model of the 1 Mbyte M25P80 external flash.
+ *
+ *         As in the Tmote Sky driver, unwritten data reads as zeros and a
+ *         write can only set bits until the sector is erased again.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+
+#include "dev/xmem.h"
+
+#if 0
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...) do {} while (0)
+#endif
+
+#define XMEM_SIZE (16 * XMEM_ERASE_UNIT_SIZE)
+
+static unsigned char flash[XMEM_SIZE];
+
+/*---------------------------------------------------------------------------*/
+void
+xmem_init(void)
+{
+  memset(flash, 0, sizeof(flash));
+}
+/*---------------------------------------------------------------------------*/
+int
+xmem_pread(void *_p, int size, unsigned long offset)
+{
+  if(offset + size > XMEM_SIZE) {
+    PRINTF("xmem_pread: bad range\n");
+    return -1;
+  }
+
+  ENERGEST_ON(ENERGEST_TYPE_FLASH_READ);
+  memcpy(_p, &flash[offset], size);
+  ENERGEST_OFF(ENERGEST_TYPE_FLASH_READ);
+
+  return size;
+}
+/*---------------------------------------------------------------------------*/
+int
+xmem_pwrite(const void *_buf, int size, unsigned long addr)
+{
+  const unsigned char *p = _buf;
+  int i;
+
+  if(addr + size > XMEM_SIZE) {
+    PRINTF("xmem_pwrite: bad range\n");
+    return -1;
+  }
+
+  ENERGEST_ON(ENERGEST_TYPE_FLASH_WRITE);
+  for(i = 0; i < size; i++) {
+    flash[addr + i] |= p[i];
+  }
+  ENERGEST_OFF(ENERGEST_TYPE_FLASH_WRITE);
+
+  return size;
+}
+/*---------------------------------------------------------------------------*/
+int
+xmem_erase(long size, unsigned long addr)
+{
+  if(size % XMEM_ERASE_UNIT_SIZE != 0) {
+    PRINTF("xmem_erase: bad size\n");
+    return -1;
+  }
+
+  if(addr % XMEM_ERASE_UNIT_SIZE != 0 || addr + size > XMEM_SIZE) {
+    PRINTF("xmem_erase: bad offset\n");
+    return -1;
+  }
+
+  memset(&flash[addr], 0, size);
+
+  return size;
+}
+/*---------------------------------------------------------------------------*/
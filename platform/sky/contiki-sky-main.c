@@ -138,6 +138,8 @@ main(int argc, char **argv)
      * Idle processing.
      */
     int s = splhigh();		/* Disable interrupts. */
+    /* The etimers may have changed: wake up at the first expiration. */
+    clock_schedule_wakeup();
     /* uart1_active is for avoiding LPM3 when still sending or receiving */
     if(process_nevents() != 0 || uart1_active()) {
       splx(s);			/* Re-enable interrupts. */
@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \file
+ *         Discrete-event simulator running many Glossy nodes on one host.
+ *
+ *         Every node runs core/dev/glossy.c unchanged on top of a model
+ *         of the MSP430 timers and of the CC2420 (see sim-cpu.c and
+ *         sim-radio.c); the SFD edges produced by the radio model drive
+ *         each node's Timer B1 interrupt. The initiator floods one packet
+ *         per period; for each flood the simulator reports reliability,
+ *         latency and radio-on time (and, overall, the CPU time spent in
+ *         interrupt handlers). Nodes are distributed over worker
+ *         threads (see sim-engine.c); results do not depend on the
+ *         number of workers.
+ *
+ *         Usage: glossy-sim [options], see usage() below.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "glossy-sim.h"
+
+struct sim_config sim_config = {
+  .n_nodes = 100,
+  .n_floods = 10,
+  .initiator = 0,
+  .tx_max = 5,
+  .data_len = 44,
+  .sync = 1,
+  .period = SIM_NS_PER_SECOND / 4,
+  .duration = SIM_NS_PER_SECOND / 20,
+  .guard = 1000000,
+  .drift_ppm = 20,
+  .trace = -1,
+  .seed = 1,
+};
+struct sim_node *sim_nodes;
+
+static const char *topology = "grid";
+static const char *agg_names[] = { "", "or", "max", "min", NULL };
+static double range = 1.5;
+
+/*---------------------------------------------------------------------------*/
+static void
+usage(const char *prog)
+{
+  fprintf(stderr,
+      "usage: %s [options]\n"
+      "  -n nodes      number of nodes (%d)\n"
+      "  -t topology   grid, line or random (%s)\n"
+      "  -r range      radio range, in units of node spacing (%.1f)\n"
+      "  -f floods     number of floods (%d)\n"
+      "  -i index      index of the initiator (%d)\n"
+      "  -N tx_max     maximum number of transmissions (%d)\n"
+      "  -A n_min      adapt N at receivers down to n_min (off)\n"
+      "  -W margin     hop-aware wake-up of receivers, max margin in slots (off)\n"
+      "  -T index      dump the event trace of a node, needs make TRACE=1 (off)\n"
+      "  -l length     flooding data length, in bytes (%d)\n"
+      "  -b packets    flood a burst of packets per Glossy phase (off)\n"
+      "  -a operator   aggregate or, max or min over all nodes (off)\n"
+      "  -d ms         duration of a Glossy phase (%d, longer if a burst or\n"
+      "                an aggregation needs it)\n"
+      "  -j ppm        maximum clock drift (%.0f)\n"
+      "  -c prob       capture probability of differing concurrent packets (%.1f)\n"
+      "  -H seed       hop channel at each flood, with the given seed (off)\n"
+      "  -B mask       channels excluded from hopping (bit i: 11 + i) (0)\n"
+      "  -x channel    jam a channel (11 to 26): nothing is received on it (off)\n"
+      "  -s seed       random seed (%lu)\n"
+      "  -w workers    worker threads (number of CPUs)\n"
+      "  -u            no time synchronization (sync flag off)\n"
+      "  -m image      node image (glossy-node.so next to %s)\n",
+      prog, sim_config.n_nodes, topology, range, sim_config.n_floods,
+      sim_config.initiator, sim_config.tx_max, sim_config.data_len,
+      (int)(sim_config.duration / 1000000), sim_config.drift_ppm,
+      sim_config.capture,
+      sim_config.seed, prog);
+  exit(EXIT_FAILURE);
+}
+/*---------------------------------------------------------------------------*/
+/* Shortest Glossy phase that can complete a burst or an aggregation, in
+   ns: a burst needs GLOSSY_BURST_SLOTS slots per packet, an aggregation
+   about one and a half slots per node plus a full budget of
+   transmissions (measured on grids of up to 100 nodes). */
+static int64_t
+phase_min(void)
+{
+  /* Glossy header, relay counter and FCS */
+  int len = 1 + sim_config.data_len + 1 + 2;
+
+  if(sim_config.burst) {
+    return sim_config.burst * SIM_BURST_SLOTS(sim_config.tx_max) *
+      SIM_SLOT_NS(len + 1);
+  }
+  if(sim_config.aggregate) {
+    return (3 * sim_config.n_nodes / 2 + 2 * sim_config.tx_max) *
+      SIM_SLOT_NS(len + (sim_config.n_nodes + 7) / 8);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static double
+uniform(uint64_t *state)
+{
+  *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+/*---------------------------------------------------------------------------*/
+/* Packet reception rate of a link: perfect up to 70% of the range,
+   then decreasing linearly (transitional region). */
+static double
+link_prr(double d)
+{
+  if(d <= 0.7 * range) {
+    return 1;
+  }
+  if(d >= range) {
+    return 0;
+  }
+  return (range - d) / (0.3 * range);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_link(struct sim_node *n, int peer, float prr)
+{
+  if(n->n_links == n->links_size) {
+    n->links_size = n->links_size ? 2 * n->links_size : 8;
+    n->links = realloc(n->links, n->links_size * sizeof(n->links[0]));
+    if(n->links == NULL) {
+      perror("realloc");
+      exit(EXIT_FAILURE);
+    }
+  }
+  n->links[n->n_links].peer = peer;
+  n->links[n->n_links].prr = prr;
+  n->n_links++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+build_topology(uint64_t *rnd)
+{
+  int n = sim_config.n_nodes;
+  double *x = malloc(n * sizeof(double)), *y = malloc(n * sizeof(double));
+  int i, j;
+
+  if(x == NULL || y == NULL) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+  if(strcmp(topology, "line") == 0) {
+    for(i = 0; i < n; i++) {
+      x[i] = i;
+      y[i] = 0;
+    }
+  } else if(strcmp(topology, "grid") == 0) {
+    int side = (int)ceil(sqrt(n));
+    for(i = 0; i < n; i++) {
+      x[i] = i % side;
+      y[i] = i / side;
+    }
+  } else if(strcmp(topology, "random") == 0) {
+    /* about ten neighbors per node */
+    double side = sqrt(n * M_PI * range * range / 10);
+    for(i = 0; i < n; i++) {
+      x[i] = uniform(rnd) * side;
+      y[i] = uniform(rnd) * side;
+    }
+  } else {
+    fprintf(stderr, "unknown topology %s\n", topology);
+    exit(EXIT_FAILURE);
+  }
+
+  for(i = 0; i < n; i++) {
+    for(j = 0; j < n; j++) {
+      double prr;
+      if(i == j) {
+        continue;
+      }
+      prr = link_prr(hypot(x[i] - x[j], y[i] - y[j]));
+      if(prr > 0) {
+        add_link(&sim_nodes[i], j, (float)prr);
+      }
+    }
+  }
+  free(x);
+  free(y);
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_results(double wall)
+{
+  int n = sim_config.n_nodes, f, i;
+  unsigned long rx_total = 0, lat_cnt_total = 0;
+  double lat_total = 0, on_total = 0, irq_total = 0;
+  /* packets flooded per Glossy phase */
+  double per_flood = sim_config.burst ? sim_config.burst : 1;
+
+  for(f = 0; f < sim_config.n_floods; f++) {
+    unsigned long rx = 0, lat_cnt = 0;
+    int64_t lat_max = 0;
+    double lat_sum = 0, on_sum = 0;
+
+    for(i = 0; i < n; i++) {
+      struct sim_result *res = &sim_nodes[i].results[f];
+      on_sum += res->radio_on;
+      irq_total += res->irq;
+      if(i == sim_config.initiator) {
+        continue;
+      }
+      rx += res->packets;
+      if(res->latency != SIM_NEVER) {
+        lat_cnt++;
+        lat_sum += res->latency;
+        if(res->latency > lat_max) {
+          lat_max = res->latency;
+        }
+      }
+    }
+    printf("flood %d: reliability %.2f %%, latency avg %lu us max %lu us, "
+        "radio-on avg %lu us\n", f,
+        n > 1 ? 100.0 * rx / ((n - 1) * per_flood) : 100.0,
+        lat_cnt ? (unsigned long)(lat_sum / lat_cnt / 1000) : 0,
+        (unsigned long)(lat_max / 1000),
+        (unsigned long)(on_sum / n / 1000));
+    rx_total += rx;
+    lat_cnt_total += lat_cnt;
+    lat_total += lat_sum;
+    on_total += on_sum;
+  }
+
+  printf("%d nodes, %d floods: reliability %.2f %%, latency avg %lu us, "
+      "radio-on avg %lu us, interrupts avg %lu us\n", n, sim_config.n_floods,
+      n > 1 ? 100.0 * rx_total / ((n - 1) * per_flood * sim_config.n_floods) : 100.0,
+      lat_cnt_total ? (unsigned long)(lat_total / lat_cnt_total / 1000) : 0,
+      (unsigned long)(on_total / n / sim_config.n_floods / 1000),
+      (unsigned long)(irq_total / n / sim_config.n_floods / 1000));
+  printf("simulated %.3f s in %.3f s with %d workers (%lu windows)\n",
+      (double)sim_flood_time(sim_config.n_floods) / SIM_NS_PER_SECOND, wall,
+      sim_config.n_workers, sim_engine_windows());
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  static char image[4096];
+  struct timespec t0, t1;
+  uint64_t rnd;
+  int64_t min;
+  int i, c, duration_set = 0;
+
+  sim_config.n_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+  while((c = getopt(argc, argv, "n:t:r:f:i:N:A:W:T:l:b:a:d:j:c:H:B:x:s:w:um:h")) != -1) {
+    switch(c) {
+    case 'n': sim_config.n_nodes = atoi(optarg); break;
+    case 't': topology = optarg; break;
+    case 'r': range = atof(optarg); break;
+    case 'f': sim_config.n_floods = atoi(optarg); break;
+    case 'i': sim_config.initiator = atoi(optarg); break;
+    case 'N': sim_config.tx_max = atoi(optarg); break;
+    case 'A': sim_config.ntx_min = atoi(optarg); break;
+    case 'W': sim_config.wakeup = atoi(optarg); break;
+    case 'T': sim_config.trace = atoi(optarg); break;
+    case 'l': sim_config.data_len = atoi(optarg); break;
+    case 'b': sim_config.burst = atoi(optarg); break;
+    case 'a':
+      for(i = 0; agg_names[i] != NULL && strcmp(optarg, agg_names[i]); i++);
+      if(agg_names[i] == NULL) {
+        usage(argv[0]);
+      }
+      sim_config.aggregate = i;
+      break;
+    case 'd':
+      sim_config.duration = atol(optarg) * 1000000LL;
+      duration_set = 1;
+      break;
+    case 'j': sim_config.drift_ppm = atof(optarg); break;
+    case 'c': sim_config.capture = atof(optarg); break;
+    case 'H':
+      sim_config.hopping = 1;
+      sim_config.hopping_seed = strtoul(optarg, NULL, 0);
+      break;
+    case 'B': sim_config.blacklist = strtoul(optarg, NULL, 0); break;
+    case 'x': sim_config.jam_channel = atoi(optarg); break;
+    case 's': sim_config.seed = strtoul(optarg, NULL, 0); break;
+    case 'w': sim_config.n_workers = atoi(optarg); break;
+    case 'u': sim_config.sync = 0; break;
+    case 'm': sim_config.image = optarg; break;
+    default: usage(argv[0]);
+    }
+  }
+  /* the packet index of a burst and the flags of an aggregation are
+     part of the flooding data, which must fit the data structure used
+     by glossy.c */
+  if(sim_config.burst > 0 && sim_config.data_len > 43) {
+    fprintf(stderr, "%s: a burst needs a data length of at most 43 bytes "
+        "(-l %d)\n", argv[0], sim_config.data_len);
+    return EXIT_FAILURE;
+  }
+  if(sim_config.aggregate && sim_config.n_nodes > 0 &&
+     sim_config.n_nodes <= 255 &&
+     sim_config.data_len + (sim_config.n_nodes + 7) / 8 > 44) {
+    fprintf(stderr, "%s: an aggregation over %d nodes needs a data length "
+        "of at most %d bytes (-l %d)\n", argv[0], sim_config.n_nodes,
+        44 - (sim_config.n_nodes + 7) / 8, sim_config.data_len);
+    return EXIT_FAILURE;
+  }
+  if(sim_config.n_nodes < 1 || sim_config.n_floods < 1 ||
+     sim_config.initiator < 0 || sim_config.initiator >= sim_config.n_nodes ||
+     sim_config.tx_max < 1 || sim_config.tx_max > 255 ||
+     sim_config.ntx_min < 0 || sim_config.ntx_min > sim_config.tx_max ||
+     sim_config.wakeup < 0 || sim_config.wakeup > 255 ||
+     (sim_config.wakeup && (sim_config.burst || sim_config.aggregate)) ||
+     sim_config.data_len < 1 || sim_config.data_len > 44 ||
+     sim_config.burst < 0 || sim_config.burst > 255 ||
+     (sim_config.burst && sim_config.data_len > 43) ||
+     (sim_config.aggregate &&
+      (sim_config.burst || sim_config.n_nodes > 255 ||
+       sim_config.data_len + (sim_config.n_nodes + 7) / 8 > 44)) ||
+     sim_config.capture < 0 || sim_config.capture > 1 ||
+     (sim_config.jam_channel &&
+      (sim_config.jam_channel < 11 || sim_config.jam_channel > 26)) ||
+     sim_config.duration <= 0 || sim_config.duration >= sim_config.period ||
+     sim_config.n_workers < 1) {
+    usage(argv[0]);
+  }
+  /* size the Glossy phase (and, if needed, the period) for bursts and
+     aggregations, or warn if the given one cuts them short */
+  min = phase_min();
+  if(duration_set) {
+    if(sim_config.duration < min) {
+      fprintf(stderr, "warning: %s needs a Glossy phase of at least "
+          "%lu ms, packets beyond %lu ms are lost\n",
+          sim_config.burst ? "a burst" : "an aggregation",
+          (unsigned long)((min + 999999) / 1000000),
+          (unsigned long)(sim_config.duration / 1000000));
+    }
+  } else if(sim_config.duration < min + min / 4) {
+    sim_config.duration = (min + min / 4 + 999999) / 1000000 * 1000000;
+    if(sim_config.period <= sim_config.duration + SIM_NS_PER_SECOND / 20) {
+      sim_config.period = sim_config.duration + SIM_NS_PER_SECOND / 20;
+    }
+    /* phase durations are kept in 16-bit 32 kHz ticks */
+    if(sim_config.duration >= 2 * SIM_NS_PER_SECOND) {
+      usage(argv[0]);
+    }
+    fprintf(stderr, "Glossy phase of %lu ms, period of %lu ms\n",
+        (unsigned long)(sim_config.duration / 1000000),
+        (unsigned long)(sim_config.period / 1000000));
+  }
+  if(sim_config.n_workers > sim_config.n_nodes) {
+    sim_config.n_workers = sim_config.n_nodes;
+  }
+  if(sim_config.image == NULL) {
+    ssize_t len = readlink("/proc/self/exe", image, sizeof(image) - 32);
+    char *slash;
+    if(len < 0) {
+      perror("readlink");
+      return EXIT_FAILURE;
+    }
+    image[len] = '\0';
+    slash = strrchr(image, '/');
+    strcpy(slash ? slash + 1 : image, "glossy-node.so");
+    sim_config.image = image;
+  }
+
+  sim_nodes = calloc(sim_config.n_nodes, sizeof(*sim_nodes));
+  if(sim_nodes == NULL) {
+    perror("calloc");
+    return EXIT_FAILURE;
+  }
+  rnd = sim_config.seed;
+  for(i = 0; i < sim_config.n_nodes; i++) {
+    struct sim_node *n = &sim_nodes[i];
+    n->index = i;
+    /* random clock offset and drift */
+    n->phase = (int64_t)(uniform(&rnd) * SIM_NS_PER_SECOND);
+    n->drift_ppb = (int64_t)((2 * uniform(&rnd) - 1) * sim_config.drift_ppm * 1000);
+    n->rng = (sim_config.seed + 1) * 0x9e3779b97f4a7c15ULL ^ (uint64_t)(i + 1);
+  }
+  build_topology(&rnd);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  sim_engine_run();
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  print_results((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+  return EXIT_SUCCESS;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \file
+ *         Glossy simulator, internal definitions.
+ */
+
+#ifndef GLOSSY_SIM_H_
+#define GLOSSY_SIM_H_
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ucontext.h>
+
+#include "sim.h"
+
+/* Simulated time is kept in nanoseconds. */
+#define SIM_NS_PER_SECOND   1000000000LL
+#define SIM_NEVER           INT64_MAX
+
+/* Clocks of the Tmote Sky: DCO and 32 kHz crystal. */
+#define SIM_F_DCO           4194304LL
+#define SIM_F_ACLK          32768LL
+#define SIM_DCO_PER_ACLK    (SIM_F_DCO / SIM_F_ACLK)
+
+/* IEEE 802.15.4 timing at 2.4 GHz (one byte every 32 us). */
+#define SIM_BYTE_NS         32000LL
+/* Turnaround to transmit or to receive: 12 symbol periods. */
+#define SIM_TURNAROUND_NS   192000LL
+/* Preamble (4 bytes) and SFD (1 byte). */
+#define SIM_SHR_NS          (5 * SIM_BYTE_NS)
+/* A receiver must listen since at least this long before the SFD
+   to synchronize on a preamble. */
+#define SIM_SYNC_NS         (3 * SIM_BYTE_NS)
+/* Transmissions whose SFDs are closer than this interfere
+   constructively. */
+#define SIM_CI_WINDOW_NS    500LL
+
+/*
+ * Conservative lookahead. A transmission starts 192 us (TX turnaround)
+ * after STXON, so nothing a node does during a window of that length can
+ * reach another node before the window is over. Every Glossy slot
+ * (T_slot_h) contains one turnaround, so the window never exceeds it.
+ *
+ * The content of a frame, however, is written to the TXFIFO while the
+ * frame is already on air (Glossy relays start the transmission first),
+ * and receivers read it as it arrives. Half a turnaround publishes each
+ * byte in time as long as it is written at least one byte time before
+ * it is sent (SIM_TX_MARGIN_NS).
+ */
+#define SIM_WINDOW_NS       (SIM_TURNAROUND_NS / 2)
+/* A byte written to the TXFIFO later than this before it is sent
+   corrupts the frame (underflow). */
+#define SIM_TX_MARGIN_NS    SIM_BYTE_NS
+
+/* Length of a Glossy slot with a payload of len bytes (Glossy header,
+   data, relay counter and FCS): turnaround, SHR, length field and
+   payload. The processing between reception and relay comes on top. */
+#define SIM_SLOT_NS(len)    (SIM_TURNAROUND_NS + SIM_SHR_NS + (1 + (len)) * SIM_BYTE_NS)
+/* Slots between two packets of a burst, as GLOSSY_BURST_SLOTS in
+   core/dev/glossy.h (with GLOSSY_BURST_HOPS 4). */
+#define SIM_BURST_SLOTS(n)  (2 * (n) + 4)
+
+/* Frequency field of FSCTRL, and its value for an IEEE 802.15.4 channel. */
+#define SIM_FREQ_MASK       0x3ff
+#define SIM_FREQ(channel)   (5 * ((channel) - 11) + 357)
+
+/* Transmissions kept by each sender for its receivers. */
+#define SIM_TX_RING         16
+/* Receivers forget transmissions older than this. */
+#define SIM_INBOX_HISTORY_NS 8000000LL
+
+#define SIM_STACK_SIZE      (64 * 1024)
+
+/**
+ * A transmission as seen by receivers. Written by the sender only
+ * between windows (sim_radio_publish()), read by receivers afterwards.
+ */
+struct sim_frame {
+  int64_t t_stxon;
+  int64_t t_sfd;
+  int64_t t_end;            /**< SIM_NEVER until latched. */
+  int64_t t_abort;          /**< SIM_NEVER unless aborted. */
+  uint32_t window;          /**< Window in which it was published. */
+  uint8_t latched;          /**< Length and content are valid. */
+  uint8_t len;              /**< Length field (FCS included). */
+  uint16_t freq;            /**< Frequency (FSCTRL) of the transmission. */
+  uint8_t data[128];        /**< Length field and MPDU without FCS. */
+};
+
+/**
+ * Sender-side state of a transmission, private to the sender.
+ */
+struct sim_tx {
+  int64_t t_stxon, t_abort, t_end;
+  uint8_t state;
+  uint8_t len;
+  uint8_t written;          /**< Bytes of data taken from the TXFIFO. */
+  uint16_t freq;
+  uint8_t data[128];
+  struct sim_frame frame;
+};
+
+/**
+ * A transmission a receiver may hear.
+ */
+struct sim_rx {
+  const struct sim_frame *f;
+  float prr;
+  int8_t heard;             /**< -1 until the link has been sampled. */
+};
+
+struct sim_link {
+  int peer;
+  float prr;
+};
+
+struct sim_radio {
+  int64_t t;                /**< State is valid up to this time. */
+  uint8_t mode, xosc;
+  int64_t rx_ready;         /**< Receiver synchronizes from this time on. */
+  int64_t on_since;
+  int64_t on_ns;            /**< Total time spent listening or transmitting. */
+  int64_t t_edge;           /**< SFD edge caused by a command strobe. */
+
+  /* SPI decoder */
+  uint8_t selected, access, reg_addr, reg_read;
+  uint16_t rx_freq;         /**< Frequency (FSCTRL) calibrated by SRXON. */
+  uint16_t regs[64];
+  uint8_t txfifo[128];
+  uint8_t txfifo_len;
+  uint8_t rxfifo[128];
+  uint8_t rxfifo_len, rxfifo_read;
+  uint8_t fifop;            /**< Level of the FIFOP pin at the last update. */
+
+  /* Transmission in progress, if any */
+  struct sim_tx *tx;
+  uint8_t tx_sfd;
+  struct sim_tx ring[SIM_TX_RING];
+  int ring_next;
+  struct sim_tx *dirty[4];  /**< Transmissions not final for receivers. */
+  int n_dirty;
+  struct sim_frame *published[4];
+  int n_published;          /**< Published in the last window. */
+
+  /* Reception */
+  struct sim_rx *inbox;
+  int inbox_len, inbox_size;
+  int rx_next;              /**< First frame not yet considered. */
+  int lock_first, lock_last;/**< Frames being received, if locked. */
+  int lock_src;             /**< The one whose content is received. */
+  uint8_t locked, lock_flushed, lock_bytes;
+  int64_t lock_sfd, lock_end;
+  int8_t lock_capture;      /**< Capture of differing contents, -1 if not drawn yet. */
+  int64_t t_first_ok;       /**< End of the first correct reception. */
+};
+
+struct sim_image;
+struct sim_worker;
+
+struct sim_result {
+  uint8_t rx_cnt;
+  uint8_t packets;          /**< Packets received (out of one or a burst). */
+  uint8_t relay_cnt;
+  uint16_t T_slot_h;
+  int64_t latency;          /**< SIM_NEVER if nothing was received. */
+  int64_t radio_on;
+  int64_t irq;              /**< Time spent serving interrupts. */
+};
+
+enum {
+  SIM_NODE_RUNNING,
+  SIM_NODE_SLEEPING
+};
+
+struct sim_node {
+  int index;
+  struct sim_worker *worker;
+  ucontext_t ctx;
+  void *stack;
+  uint8_t *data;            /**< This node's copy of the image data. */
+  uint8_t state;
+  int64_t wake;
+
+  /* CPU and clocks */
+  int64_t now;              /**< Global time. */
+  int64_t dco;              /**< Local DCO count at now. */
+  int64_t phase;            /**< Local clock offset, in ns. */
+  int64_t drift_ppb;        /**< Local clock drift. */
+  uint64_t rng;
+  int64_t irq_checked;      /**< Interrupt sources evaluated up to here. */
+  uint8_t irq_pending;
+  uint8_t in_isr;
+  uint8_t tar_reads;        /**< Back-to-back 32 kHz counter reads. */
+  int64_t irq_dco;          /**< DCO cycles spent serving interrupts. */
+
+  struct sim_radio radio;
+
+  struct sim_link *links;   /**< Nodes this node can hear. */
+  int n_links, links_size;
+
+  /* Current flood */
+  int flood;
+  int64_t flood_start;
+  int64_t radio_on_start;
+  int64_t irq_start;
+  struct sim_result *results;
+};
+
+struct sim_image {
+  void *handle;
+  uintptr_t base;
+  uint8_t *rw;
+  size_t rw_size;
+  void (*main)(struct sim_node *n);
+  void (*isr)(void);
+  void (*port1_isr)(void);  /**< NULL if the image does not use FIFOP. */
+  unsigned short (*read_sr)(void);
+  volatile uint16_t *tbiv;
+  volatile uint16_t *tbccr1, *tbcctl1;
+  volatile uint16_t *tbccr4, *tbcctl4;
+  volatile uint16_t *tbccr5, *tbcctl5;
+  volatile uint8_t *p1ie, *p1ifg;
+};
+
+struct sim_worker {
+  int index;
+  pthread_t thread;
+  int first, last;          /**< Nodes [first, last) run on this worker. */
+  struct sim_image image;
+  ucontext_t ctx;
+  struct sim_node *current;
+  uint32_t window;
+  int64_t t_start, t_end;
+  int running;              /**< Nodes still running at the window end. */
+  int64_t wake;             /**< Earliest wake-up of the sleeping nodes. */
+  unsigned long windows;
+};
+
+struct sim_config {
+  int n_nodes;
+  int n_workers;
+  int n_floods;
+  int initiator;
+  int tx_max;
+  int data_len;
+  int burst;
+  int aggregate;
+  int sync;
+  int64_t period;
+  int64_t duration;
+  int64_t guard;
+  double drift_ppm;
+  double capture;
+  int hopping;
+  unsigned hopping_seed;
+  unsigned blacklist;
+  int jam_channel;
+  int ntx_min;
+  int wakeup;
+  int trace;
+  unsigned long seed;
+  const char *image;
+};
+
+extern struct sim_config sim_config;
+extern struct sim_node *sim_nodes;
+
+/* sim-engine.c */
+void sim_engine_run(void);
+unsigned long sim_engine_windows(void);
+int64_t sim_flood_time(int flood);
+void sim_node_yield(struct sim_node *n);
+uint32_t sim_random(struct sim_node *n);
+
+/* sim-cpu.c */
+void sim_cpu_init(struct sim_node *n);
+void sim_cpu_set_time(struct sim_node *n, int64_t t);
+void sim_cpu_consume(struct sim_node *n, unsigned ticks);
+void sim_cpu_wait_until(struct sim_node *n, int64_t t);
+
+/* sim-radio.c */
+void sim_radio_init(struct sim_node *n);
+int64_t sim_radio_run_until(struct sim_node *n, int64_t t);
+int64_t sim_radio_on_time(struct sim_node *n);
+int64_t sim_radio_next_fifop(struct sim_node *n);
+int sim_radio_fifop_edge(struct sim_node *n);
+void sim_radio_publish(struct sim_node *n, int64_t t_end, uint32_t window);
+void sim_radio_collect(struct sim_node *n, int64_t t_now);
+
+#endif /* GLOSSY_SIM_H_ */
@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \file
+ *         Glossy simulator, CPU and timer model.
+ *
+ *         Node code runs natively; simulated time only advances when it
+ *         touches the hardware (timers, radio pins, SPI), by the number
+ *         of DCO cycles that access takes on a Tmote Sky. Timer B1
+ *         interrupts (SFD captures, compares 4 and 5) are served at the
+ *         exact instant they occur, after the interrupt latency of the
+ *         MSP430, so that Glossy's compensation of the latency (T_irq)
+ *         is exercised as on the hardware. The Port 1 interrupt (FIFOP,
+ *         lower priority) is served while P1IFG.0 and P1IE.0 are set.
+ */
+
+#include <legacymsp430.h>
+
+#include "glossy-sim.h"
+
+/* Cost of hardware accesses, in DCO cycles. */
+#define COST_TAR            6   /* read Timer A (rtimer_arch_now()) */
+#define COST_TAR_EXT        40  /* read Timer A and its wraps (rtimer_arch_now_ext()) */
+#define COST_TBR            3   /* read Timer B */
+#define COST_CAPTURE        10  /* set up and read both capture units */
+/* Interrupt entry: constant part (as assumed by Glossy) and maximum
+   additional delay for completing the current instruction. */
+#define ISR_ENTRY           21
+#define ISR_JITTER          4
+#define COST_RETI           5
+
+#define IRQ_CCR1            0x01
+#define IRQ_CCR4            0x02
+#define IRQ_CCR5            0x04
+#define IRQ_FIFOP           0x08
+
+/* FIFOP on P1.0 */
+#define P1_FIFOP            0x01
+
+/*---------------------------------------------------------------------------*/
+static int64_t
+dco_at(struct sim_node *n, int64_t t)
+{
+  __int128 local = t + n->phase + (__int128)t * n->drift_ppb / SIM_NS_PER_SECOND;
+  return (int64_t)(local * SIM_F_DCO / SIM_NS_PER_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+/* First instant at which the local DCO count reaches c. */
+static int64_t
+time_of_dco(struct sim_node *n, int64_t c)
+{
+  __int128 local = ((__int128)c * SIM_NS_PER_SECOND + SIM_F_DCO - 1) / SIM_F_DCO;
+  int64_t t = (int64_t)((local - n->phase) * SIM_NS_PER_SECOND /
+                        (SIM_NS_PER_SECOND + n->drift_ppb));
+
+  if(t < 0) {
+    t = 0;
+  }
+  while(dco_at(n, t) < c) {
+    t++;
+  }
+  while(t > 0 && dco_at(n, t - 1) >= c) {
+    t--;
+  }
+  return t;
+}
+/*---------------------------------------------------------------------------*/
+/* Next instant after irq_checked at which Timer B matches ccr. */
+static int64_t
+compare_time(struct sim_node *n, uint16_t ccr)
+{
+  int64_t d = dco_at(n, n->irq_checked);
+  int64_t delta = (ccr - d) & 0xffff;
+
+  return time_of_dco(n, d + (delta ? delta : 0x10000));
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Let the radio and the compare units run up to lim. Returns the time of
+ * the first interrupt the CPU has to serve right away, or SIM_NEVER.
+ * Interrupts that occur while another one is served are kept pending;
+ * those occurring while they are masked are lost.
+ */
+static int64_t
+next_interrupt(struct sim_node *n, int64_t lim)
+{
+  struct sim_image *img = &n->worker->image;
+
+  while(1) {
+    int64_t t_c4 = SIM_NEVER, t_c5 = SIM_NEVER, t_fp = SIM_NEVER, t, t_edge;
+    uint8_t src;
+    int enabled;
+
+    if(*img->tbcctl4 & CCIE) {
+      t_c4 = compare_time(n, *img->tbccr4);
+    }
+    if(*img->tbcctl5 & CCIE) {
+      t_c5 = compare_time(n, *img->tbccr5);
+    }
+    if(img->port1_isr != NULL) {
+      t_fp = sim_radio_next_fifop(n);
+    }
+    t = lim < t_c4 ? lim : t_c4;
+    t = t < t_c5 ? t : t_c5;
+    t = t < t_fp ? t : t_fp;
+
+    t_edge = sim_radio_run_until(n, t);
+    if(t_edge != SIM_NEVER) {
+      t = t_edge;
+      src = IRQ_CCR1;
+      if(*img->tbcctl1 & CAP) {
+        *img->tbccr1 = (uint16_t)dco_at(n, t_edge);
+      }
+      enabled = *img->tbcctl1 & CCIE;
+    } else if(t_c4 <= t && t_c4 <= t_c5) {
+      src = IRQ_CCR4;
+      enabled = 1;
+    } else if(t_c5 <= t) {
+      src = IRQ_CCR5;
+      enabled = 1;
+    } else if(t_fp <= t) {
+      n->irq_checked = t;
+      /* the flag stays set until the handler clears it */
+      if(sim_radio_fifop_edge(n) && (*img->p1ie & P1_FIFOP) &&
+         !n->in_isr && (img->read_sr() & GIE)) {
+        return t;
+      }
+      continue;
+    } else {
+      n->irq_checked = lim;
+      return SIM_NEVER;
+    }
+    n->irq_checked = t;
+
+    if(!enabled || (!n->in_isr && !(img->read_sr() & GIE))) {
+      continue;
+    }
+    n->irq_pending |= src;
+    if(!n->in_isr) {
+      return t;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void advance(struct sim_node *n, int64_t ticks);
+
+static int
+serve(struct sim_node *n)
+{
+  struct sim_image *img = &n->worker->image;
+  uint8_t pending = n->irq_pending, src;
+  int64_t before = n->dco;
+
+  if(img->port1_isr != NULL && (*img->p1ie & *img->p1ifg & P1_FIFOP)) {
+    pending |= IRQ_FIFOP;
+  }
+  if(!pending || n->in_isr || !(img->read_sr() & GIE)) {
+    return 0;
+  }
+  /* Timer B first (lowest vector first, as reported by TBIV), then Port 1 */
+  src = pending & -pending;
+  n->irq_pending &= ~src;
+
+  n->in_isr = 1;
+  advance(n, ISR_ENTRY + sim_random(n) % (ISR_JITTER + 1));
+  n->tar_reads = 0;
+  if(src == IRQ_FIFOP) {
+    img->port1_isr();
+  } else {
+    if(src == IRQ_CCR1) {
+      *img->tbiv = TBIV_TBCCR1;
+    } else if(src == IRQ_CCR4) {
+      *img->tbiv = TBIV_TBCCR4;
+    } else {
+      *img->tbiv = TBIV_TBCCR5;
+    }
+    img->isr();
+  }
+  advance(n, COST_RETI);
+  n->in_isr = 0;
+  n->irq_dco += n->dco - before;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+advance(struct sim_node *n, int64_t ticks)
+{
+  int64_t target = n->dco + ticks;
+
+  while(n->dco < target) {
+    int64_t before = n->dco;
+    int64_t t_target, t_lim, t_ev;
+
+    if(serve(n)) {
+      /* the interrupted access completes after the handler returns */
+      target += n->dco - before;
+      continue;
+    }
+
+    t_target = time_of_dco(n, target);
+    t_lim = t_target < n->worker->t_end ? t_target : n->worker->t_end;
+    t_ev = next_interrupt(n, t_lim);
+    if(t_ev != SIM_NEVER) {
+      n->now = t_ev;
+      n->dco = dco_at(n, t_ev);
+    } else if(t_lim < t_target) {
+      n->now = t_lim;
+      n->dco = dco_at(n, t_lim);
+      sim_node_yield(n);
+    } else {
+      n->now = t_target;
+      n->dco = target;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_cpu_init(struct sim_node *n)
+{
+  n->now = 0;
+  n->dco = dco_at(n, 0);
+  n->irq_checked = 0;
+  n->irq_pending = 0;
+  n->in_isr = 0;
+  n->tar_reads = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_cpu_set_time(struct sim_node *n, int64_t t)
+{
+  n->now = t;
+  n->dco = dco_at(n, t);
+  n->irq_checked = t;
+  n->irq_pending = 0;
+  while(sim_radio_run_until(n, t) != SIM_NEVER);
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_cpu_consume(struct sim_node *n, unsigned ticks)
+{
+  n->tar_reads = 0;
+  advance(n, ticks);
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_cpu_wait_until(struct sim_node *n, int64_t t)
+{
+  n->tar_reads = 0;
+  advance(n, t > n->now ? dco_at(n, t) - n->dco + 1 : 1);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+sim_cpu_now(struct sim_node *n)
+{
+  uint16_t now = (uint16_t)(n->dco / SIM_DCO_PER_ACLK);
+
+  if(n->tar_reads < 2) {
+    n->tar_reads++;
+    advance(n, COST_TAR);
+  } else {
+    /* Nothing else but the 32 kHz counter is being polled: the value
+       cannot change before the next tick, so skip to it. */
+    advance(n, SIM_DCO_PER_ACLK - n->dco % SIM_DCO_PER_ACLK);
+  }
+  return now;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+sim_cpu_now_ext(struct sim_node *n)
+{
+  uint32_t now = (uint32_t)(n->dco / SIM_DCO_PER_ACLK);
+
+  sim_cpu_consume(n, COST_TAR_EXT);
+  return now;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+sim_cpu_now_dco(struct sim_node *n)
+{
+  uint16_t now = (uint16_t)n->dco;
+
+  sim_cpu_consume(n, COST_TBR);
+  return now;
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_cpu_delay_dco(struct sim_node *n, unsigned ticks)
+{
+  sim_cpu_consume(n, ticks);
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_cpu_capture_next_tick(struct sim_node *n, uint16_t *t_cap_h, uint16_t *t_cap_l)
+{
+  sim_cpu_consume(n, SIM_DCO_PER_ACLK - n->dco % SIM_DCO_PER_ACLK);
+  *t_cap_h = (uint16_t)n->dco;
+  *t_cap_l = (uint16_t)(n->dco / SIM_DCO_PER_ACLK);
+  sim_cpu_consume(n, COST_CAPTURE);
+}
+/*---------------------------------------------------------------------------*/
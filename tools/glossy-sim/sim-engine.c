@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \file
+ *         Glossy simulator, parallel execution engine.
+ *
+ *         Nodes are split into contiguous groups, one per worker thread.
+ *         Each node runs the node image as a coroutine. Since the image
+ *         keeps its state in static variables, every worker loads its own
+ *         copy of the image and swaps the writable segment of the image
+ *         with the node's private copy around each context switch.
+ *
+ *         Workers advance in lock-step windows of SIM_WINDOW_NS
+ *         (conservative synchronization): during a window each worker
+ *         runs its nodes up to the end of the window; then transmissions
+ *         started during the window are published, and finally each
+ *         worker delivers them to the inboxes of its own nodes. When all
+ *         nodes sleep, time jumps to the earliest wake-up.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "glossy-sim.h"
+
+static struct sim_worker *workers;
+static pthread_barrier_t barrier;
+static __thread struct sim_worker *worker;
+
+/*---------------------------------------------------------------------------*/
+uint32_t
+sim_random(struct sim_node *n)
+{
+  /* xorshift64* */
+  uint64_t x = n->rng;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  n->rng = x;
+  return (uint32_t)((x * 2685821657736338717ULL) >> 32);
+}
+/*---------------------------------------------------------------------------*/
+int64_t
+sim_flood_time(int flood)
+{
+  return sim_config.period * (flood + 1);
+}
+/*---------------------------------------------------------------------------*/
+static int
+find_rw_segment(struct dl_phdr_info *info, size_t size, void *data)
+{
+  struct sim_image *img = data;
+  int i;
+
+  if(info->dlpi_addr != img->base) {
+    return 0;
+  }
+  for(i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+    if(ph->p_type == PT_LOAD && (ph->p_flags & PF_W)) {
+      img->rw = (uint8_t *)(info->dlpi_addr + ph->p_vaddr);
+      img->rw_size = ph->p_memsz;
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+image_symbol(struct sim_image *img, const char *name)
+{
+  void *sym = dlsym(img->handle, name);
+
+  if(sym == NULL) {
+    fprintf(stderr, "node image: missing symbol %s\n", name);
+    exit(EXIT_FAILURE);
+  }
+  return sym;
+}
+/*---------------------------------------------------------------------------*/
+static void
+load_image(struct sim_image *img, const void *so, size_t len)
+{
+  struct link_map *lm;
+  char path[64];
+  int fd;
+
+  /* dlopen() maps an object only once per file name: give each worker
+     its own file, kept open so that the names are not reused, so that
+     each gets its own copy of the image data */
+  fd = memfd_create("glossy-node", 0);
+  if(fd < 0 || write(fd, so, len) != (ssize_t)len) {
+    perror("memfd");
+    exit(EXIT_FAILURE);
+  }
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+  img->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if(img->handle == NULL) {
+    fprintf(stderr, "node image: %s\n", dlerror());
+    exit(EXIT_FAILURE);
+  }
+  dlinfo(img->handle, RTLD_DI_LINKMAP, &lm);
+  img->base = lm->l_addr;
+  if(!dl_iterate_phdr(find_rw_segment, img)) {
+    fprintf(stderr, "node image: no writable segment\n");
+    exit(EXIT_FAILURE);
+  }
+
+  img->main = image_symbol(img, "sim_node_main");
+  img->isr = image_symbol(img, "timerb1_interrupt");
+  /* only with GLOSSY_CONF_RX_FIFOP */
+  img->port1_isr = dlsym(img->handle, "port1_interrupt");
+  img->read_sr = image_symbol(img, "read_sr");
+  img->tbiv = image_symbol(img, "TBIV");
+  img->tbccr1 = image_symbol(img, "TBCCR1");
+  img->tbcctl1 = image_symbol(img, "TBCCTL1");
+  img->tbccr4 = image_symbol(img, "TBCCR4");
+  img->tbcctl4 = image_symbol(img, "TBCCTL4");
+  img->tbccr5 = image_symbol(img, "TBCCR5");
+  img->tbcctl5 = image_symbol(img, "TBCCTL5");
+  img->p1ie = image_symbol(img, "P1IE");
+  img->p1ifg = image_symbol(img, "P1IFG");
+}
+/*---------------------------------------------------------------------------*/
+static void *
+read_file(const char *name, size_t *len)
+{
+  FILE *f = fopen(name, "rb");
+  void *buf;
+
+  if(f == NULL) {
+    perror(name);
+    exit(EXIT_FAILURE);
+  }
+  fseek(f, 0, SEEK_END);
+  *len = ftell(f);
+  rewind(f);
+  buf = malloc(*len);
+  if(buf == NULL || fread(buf, 1, *len, f) != *len) {
+    perror(name);
+    exit(EXIT_FAILURE);
+  }
+  fclose(f);
+  return buf;
+}
+/*---------------------------------------------------------------------------*/
+static void
+node_entry(void)
+{
+  struct sim_node *n = worker->current;
+
+  n->worker->image.main(n);
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_node_yield(struct sim_node *n)
+{
+  swapcontext(&n->ctx, &n->worker->ctx);
+}
+/*---------------------------------------------------------------------------*/
+static void
+resume(struct sim_worker *w, struct sim_node *n)
+{
+  if(n->state == SIM_NODE_SLEEPING) {
+    n->state = SIM_NODE_RUNNING;
+    sim_cpu_set_time(n, n->wake);
+  }
+  memcpy(w->image.rw, n->data, w->image.rw_size);
+  w->current = n;
+  swapcontext(&w->ctx, &n->ctx);
+  memcpy(n->data, w->image.rw, w->image.rw_size);
+}
+/*---------------------------------------------------------------------------*/
+static void *
+worker_thread(void *arg)
+{
+  struct sim_worker *w = arg;
+  int i;
+
+  worker = w;
+  while(1) {
+    int running = 0;
+    int64_t wake = SIM_NEVER;
+
+    /* run the nodes up to the end of the window */
+    for(i = w->first; i < w->last; i++) {
+      struct sim_node *n = &sim_nodes[i];
+      if(n->state == SIM_NODE_RUNNING || n->wake < w->t_end) {
+        resume(w, n);
+      }
+    }
+    pthread_barrier_wait(&barrier);
+
+    /* publish the transmissions of the window */
+    w->running = 0;
+    w->wake = SIM_NEVER;
+    for(i = w->first; i < w->last; i++) {
+      struct sim_node *n = &sim_nodes[i];
+      sim_radio_publish(n, w->t_end, w->window);
+      if(n->state == SIM_NODE_RUNNING) {
+        w->running++;
+      } else if(n->wake < w->wake) {
+        w->wake = n->wake;
+      }
+    }
+    pthread_barrier_wait(&barrier);
+
+    /* deliver them to the receivers */
+    for(i = w->first; i < w->last; i++) {
+      sim_radio_collect(&sim_nodes[i], w->t_end);
+    }
+    for(i = 0; i < sim_config.n_workers; i++) {
+      running += workers[i].running;
+      if(workers[i].wake < wake) {
+        wake = workers[i].wake;
+      }
+    }
+    w->windows++;
+    pthread_barrier_wait(&barrier);
+
+    if(running) {
+      w->t_start = w->t_end;
+    } else if(wake != SIM_NEVER) {
+      w->t_start = wake > w->t_end ? wake : w->t_end;
+    } else {
+      break;
+    }
+    w->t_end = w->t_start + SIM_WINDOW_NS;
+    w->window++;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_node_next_flood(struct sim_node *n, struct sim_flood *f)
+{
+  int initiator = n->index == sim_config.initiator;
+
+  n->state = SIM_NODE_SLEEPING;
+  if(n->flood >= sim_config.n_floods) {
+    n->wake = SIM_NEVER;
+    sim_node_yield(n);
+  }
+  n->wake = sim_flood_time(n->flood) + (initiator ? sim_config.guard : 0);
+  sim_node_yield(n);
+
+  f->seq_no = n->flood;
+  f->duration = sim_config.duration * SIM_F_ACLK / SIM_NS_PER_SECOND;
+  f->id = n->index + 1;
+  f->initiator = initiator;
+  f->sync = sim_config.sync;
+  f->tx_max = sim_config.tx_max;
+  f->data_len = sim_config.data_len;
+  f->burst = sim_config.burst;
+  f->aggregate = sim_config.aggregate;
+  f->n_nodes = sim_config.n_nodes;
+  f->index = n->index;
+  f->hopping = sim_config.hopping;
+  f->hopping_seed = sim_config.hopping_seed;
+  f->blacklist = sim_config.blacklist;
+  f->ntx_min = sim_config.ntx_min;
+  f->wakeup = sim_config.wakeup;
+  f->trace = sim_config.trace == n->index;
+
+  n->flood_start = n->now;
+  n->radio.t_first_ok = SIM_NEVER;
+  n->radio_on_start = sim_radio_on_time(n);
+  n->irq_start = n->irq_dco;
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_node_flood_done(struct sim_node *n, uint8_t rx_cnt, uint8_t packets,
+                    uint8_t relay_cnt, uint16_t T_slot_h)
+{
+  struct sim_result *res = &n->results[n->flood];
+  int64_t t_init = sim_flood_time(n->flood) + sim_config.guard;
+
+  res->rx_cnt = rx_cnt;
+  res->packets = packets;
+  res->relay_cnt = relay_cnt;
+  res->T_slot_h = T_slot_h;
+  res->latency = (rx_cnt && n->radio.t_first_ok != SIM_NEVER) ?
+    n->radio.t_first_ok - t_init : SIM_NEVER;
+  res->radio_on = sim_radio_on_time(n) - n->radio_on_start;
+  res->irq = (n->irq_dco - n->irq_start) * SIM_NS_PER_SECOND / SIM_F_DCO;
+  n->flood++;
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_engine_run(void)
+{
+  int n_workers = sim_config.n_workers;
+  size_t len;
+  void *so;
+  int i, w;
+
+  so = read_file(sim_config.image, &len);
+  workers = calloc(n_workers, sizeof(*workers));
+  if(workers == NULL) {
+    perror("calloc");
+    exit(EXIT_FAILURE);
+  }
+
+  for(w = 0; w < n_workers; w++) {
+    struct sim_worker *wk = &workers[w];
+    wk->index = w;
+    wk->first = (int)((long)sim_config.n_nodes * w / n_workers);
+    wk->last = (int)((long)sim_config.n_nodes * (w + 1) / n_workers);
+    wk->t_start = 0;
+    wk->t_end = SIM_WINDOW_NS;
+    wk->window = 1;
+    load_image(&wk->image, so, len);
+
+    for(i = wk->first; i < wk->last; i++) {
+      struct sim_node *n = &sim_nodes[i];
+      n->worker = wk;
+      n->data = malloc(wk->image.rw_size);
+      n->stack = malloc(SIM_STACK_SIZE);
+      n->results = calloc(sim_config.n_floods, sizeof(*n->results));
+      if(n->data == NULL || n->stack == NULL || n->results == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+      }
+      /* every node starts from the pristine image data */
+      memcpy(n->data, wk->image.rw, wk->image.rw_size);
+      getcontext(&n->ctx);
+      n->ctx.uc_stack.ss_sp = n->stack;
+      n->ctx.uc_stack.ss_size = SIM_STACK_SIZE;
+      n->ctx.uc_link = NULL;
+      makecontext(&n->ctx, node_entry, 0);
+      n->state = SIM_NODE_RUNNING;
+      sim_cpu_init(n);
+      sim_radio_init(n);
+    }
+  }
+  free(so);
+
+  pthread_barrier_init(&barrier, NULL, n_workers);
+  for(w = 0; w < n_workers; w++) {
+    if(pthread_create(&workers[w].thread, NULL, worker_thread, &workers[w])) {
+      perror("pthread_create");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for(w = 0; w < n_workers; w++) {
+    pthread_join(workers[w].thread, NULL);
+  }
+  pthread_barrier_destroy(&barrier);
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+sim_engine_windows(void)
+{
+  return workers[0].windows;
+}
+/*---------------------------------------------------------------------------*/
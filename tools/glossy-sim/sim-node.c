@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \file
+ *         Node image of the Glossy simulator.
+ *
+ *         This file is linked with core/dev/glossy.c, the Contiki kernel
+ *         and the native register file into a shared object. It provides
+ *         the architecture functions Glossy relies on (rtimer, CC2420
+ *         pins and SPI, watchdog) by forwarding them to the simulator,
+ *         and runs the node: one Glossy phase per flood, as
+ *         apps/glossy-test does.
+ */
+
+#include "contiki.h"
+#include "glossy.h"
+#include "sim.h"
+
+static struct sim_node *self;
+
+static struct sim_flood flood;
+static uint8_t flood_data[255 * 128];
+static uint8_t bitmap[32];
+static uint8_t agg_expected[255];
+static struct rtimer rt;
+static uint8_t rx_cnt;
+
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+rtimer_arch_now(void)
+{
+  return sim_cpu_now(self);
+}
+/*---------------------------------------------------------------------------*/
+rtimer_ext_clock_t
+rtimer_arch_now_ext(void)
+{
+  return sim_cpu_now_ext(self);
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+rtimer_arch_now_dco(void)
+{
+  return sim_cpu_now_dco(self);
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_delay_dco(unsigned short ticks)
+{
+  sim_cpu_delay_dco(self, ticks);
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_capture_next_tick(rtimer_clock_t *t_cap_h, rtimer_clock_t *t_cap_l)
+{
+  sim_cpu_capture_next_tick(self, t_cap_h, t_cap_l);
+}
+/*---------------------------------------------------------------------------*/
+void
+cc2420_arch_select(int s)
+{
+  sim_radio_select(self, s);
+}
+/*---------------------------------------------------------------------------*/
+int
+cc2420_arch_selected(void)
+{
+  return sim_radio_selected(self);
+}
+/*---------------------------------------------------------------------------*/
+unsigned char
+cc2420_arch_spi(unsigned char c)
+{
+  return sim_radio_spi(self, c);
+}
+/*---------------------------------------------------------------------------*/
+int
+cc2420_arch_fifo(void)
+{
+  return sim_radio_fifo(self);
+}
+/*---------------------------------------------------------------------------*/
+int
+cc2420_arch_fifop(void)
+{
+  return sim_radio_fifop(self);
+}
+/*---------------------------------------------------------------------------*/
+int
+cc2420_arch_cca(void)
+{
+  return sim_radio_cca(self);
+}
+/*---------------------------------------------------------------------------*/
+int
+cc2420_arch_sfd(void)
+{
+  return sim_radio_sfd(self);
+}
+/*---------------------------------------------------------------------------*/
+void
+clock_delay(unsigned int i)
+{
+  sim_cpu_delay_dco(self, i);
+}
+/*---------------------------------------------------------------------------*/
+void
+watchdog_start(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+watchdog_stop(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+glossy_cb(struct rtimer *t, void *ptr)
+{
+  rx_cnt = glossy_stop();
+}
+/*---------------------------------------------------------------------------*/
+/* Aggregation: write the contribution of the node and the aggregate
+   expected over the whole network, and return the merge operator. */
+static const struct glossy_merge_op *
+agg_init(void)
+{
+  uint16_t value, result;
+  int i;
+
+  memset(flood_data, 0, flood.data_len);
+  memset(agg_expected, 0, flood.data_len);
+  if(flood.aggregate == SIM_AGG_OR) {
+    flood_data[(flood.index >> 3) % flood.data_len] = 1 << (flood.index & 7);
+    for(i = 0; i < flood.n_nodes; i++) {
+      agg_expected[(i >> 3) % flood.data_len] |= 1 << (i & 7);
+    }
+    return &glossy_op_or_u8;
+  }
+  value = flood.index + 1;
+  result = flood.aggregate == SIM_AGG_MAX ? flood.n_nodes : 1;
+  for(i = 0; i + 1 < flood.data_len; i += 2) {
+    flood_data[i] = value & 0xff;
+    flood_data[i + 1] = value >> 8;
+    agg_expected[i] = result & 0xff;
+    agg_expected[i + 1] = result >> 8;
+  }
+  return flood.aggregate == SIM_AGG_MAX ? &glossy_op_max_u16 : &glossy_op_min_u16;
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_node_main(struct sim_node *n)
+{
+  self = n;
+
+  msp430_cpu_init();
+  process_init();
+  energest_init();
+  process_start(&glossy_process, NULL);
+
+  while(1) {
+    sim_node_next_flood(self, &flood);
+    if(flood.ntx_min && flood.seq_no == 0) {
+      glossy_ntx_init(flood.ntx_min, flood.tx_max, 95);
+    }
+    if(flood.ntx_min && !flood.initiator) {
+      flood.tx_max = glossy_ntx_get();
+    }
+    if(flood.wakeup && !flood.initiator) {
+      /* sleep until shortly before the flood is expected to arrive;
+         the end of the phase stays the same */
+      if(flood.seq_no == 0) {
+        glossy_wakeup_init(1, flood.wakeup);
+      }
+      rtimer_clock_t offset = glossy_wakeup_offset_l();
+      rtimer_clock_t t_wake = RTIMER_NOW() + offset;
+      while(RTIMER_CLOCK_LT(RTIMER_NOW(), t_wake));
+      flood.duration -= offset;
+    }
+    if(flood.hopping) {
+      /* all nodes know the sequence number, hence the channel */
+      if(flood.seq_no == 0) {
+        glossy_hopping_init(flood.hopping_seed);
+        glossy_hopping_set_blacklist(flood.blacklist, 0);
+      }
+      glossy_hopping_set_seq(flood.seq_no);
+    }
+    uint8_t packets = 0;
+    int i;
+
+    if(flood.initiator) {
+      for(i = 0; i < (flood.burst ? flood.burst : 1); i++) {
+        memcpy(&flood_data[i * flood.data_len], &flood.seq_no, sizeof(flood.seq_no));
+      }
+    }
+    if(flood.aggregate) {
+      glossy_start_aggregate(flood_data, flood.data_len, agg_init(), bitmap,
+          flood.n_nodes, flood.index, flood.initiator, flood.sync,
+          flood.tx_max, 0, RTIMER_NOW() + flood.duration,
+          glossy_cb, &rt, NULL, flood.id);
+    } else if(flood.burst) {
+      glossy_start_burst(flood_data, flood.data_len, flood.burst, bitmap,
+          flood.initiator, flood.sync, flood.tx_max, 0,
+          RTIMER_NOW() + flood.duration, glossy_cb, &rt, NULL, flood.id);
+    } else {
+      glossy_start(flood_data, flood.data_len, flood.initiator, flood.sync,
+          flood.tx_max, 0, RTIMER_NOW() + flood.duration,
+          glossy_cb, &rt, NULL, flood.id);
+    }
+    /* Glossy busy-waits in its process until the phase is over and then
+       calls glossy_cb(). */
+    while(process_run() > 0);
+    if(flood.aggregate) {
+      /* the aggregate of all the nodes counts as the packet */
+      packets = is_agg_complete() &&
+        memcmp(flood_data, agg_expected, flood.data_len) == 0;
+    } else if(flood.burst) {
+      for(i = 0; i < flood.burst; i++) {
+        packets += (bitmap[i >> 3] >> (i & 7)) & 1;
+      }
+    } else {
+      packets = rx_cnt ? 1 : 0;
+    }
+    if(flood.ntx_min && !flood.initiator) {
+      glossy_ntx_update();
+    }
+    if(flood.wakeup && !flood.initiator) {
+      glossy_wakeup_update();
+    }
+    if(flood.trace) {
+      /* SLIP frames on the standard output, for tools/sky/glossy-trace */
+      glossy_trace_dump();
+    }
+    sim_node_flood_done(self, rx_cnt, packets, get_relay_cnt(), get_T_slot_h());
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,789 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \file
+ *         Glossy simulator, CC2420 and radio medium model.
+ *
+ *         Each node has a model of the CC2420 as seen through its SPI
+ *         interface and pins (same command decoding as the native
+ *         target's dev/cc2420-arch.c), extended with timing: a
+ *         transmission starts 192 us after STXON, raises SFD after the
+ *         preamble and lasts 32 us per byte, and received bytes enter
+ *         the RXFIFO at the rate they arrive. FIFOP follows the RXFIFO
+ *         threshold (FIFOP_THR of IOCFG0) and its rising edges set P1IFG.0.
+ *
+ *         A receiver synchronizes on the first transmissions whose SFDs
+ *         fall within SIM_CI_WINDOW_NS of each other (constructive
+ *         interference): it hears them if at least one of the links
+ *         delivers the packet. The packet is received correctly if all
+ *         the transmissions heard carry the same content and no other
+ *         audible transmission overlaps with it. If their contents
+ *         differ, the receiver still gets the first one with probability
+ *         sim_config.capture (capture effect, on which the aggregation
+ *         mode relies). Only transmissions on the frequency the receiver
+ *         calibrated at SRXON are heard.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <legacymsp430.h>
+
+#include "dev/cc2420_const.h"
+#include "glossy-sim.h"
+
+#define REG_ADDR_MASK     0x3f
+#define REG_READ          0x40
+#define RAM_ACCESS        0x80
+
+/* Cost of hardware accesses, in DCO cycles. */
+#define COST_SPI          20  /* one byte at SMCLK / 2, loop included */
+#define COST_CS           2
+#define COST_PIN          4
+
+/* FIFOP on P1.0 */
+#define P1_FIFOP          0x01
+#define FIFOP_THR_MASK    0x7f
+
+/* A poll of an empty RXFIFO waits at most this long for the next byte. */
+#define POLL_MAX_NS       SIM_BYTE_NS
+
+/* Second footer byte: CRC flag and correlation value. */
+#define FOOTER1_CRC_OK    0x80
+#define RSSI_BYTE         0xd8  /* -40 dBm */
+#define CORRELATION       0x6c
+
+enum {
+  MODE_IDLE,
+  MODE_RX,
+  MODE_TX
+};
+
+enum {
+  ACCESS_COMMAND,
+  ACCESS_REG_MSB,
+  ACCESS_REG_LSB,
+  ACCESS_TXFIFO,
+  ACCESS_RXFIFO,
+  ACCESS_RAM
+};
+
+/* sim_tx state flags */
+#define TX_ON_AIR         0x01  /* preamble started, content taken */
+#define TX_OVER           0x02
+#define TX_PUBLISHED      0x04
+
+/*---------------------------------------------------------------------------*/
+static int
+frame_void(const struct sim_frame *f)
+{
+  /* aborted during the TX turnaround: never reached the air */
+  return f->t_abort < f->t_stxon + SIM_TURNAROUND_NS;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_mode(struct sim_radio *r, uint8_t mode, int64_t t)
+{
+  if(r->mode != MODE_IDLE) {
+    r->on_ns += t - r->on_since;
+  }
+  r->mode = mode;
+  r->on_since = t;
+}
+/*---------------------------------------------------------------------------*/
+static int
+heard(struct sim_node *n, struct sim_rx *rx)
+{
+  /* other channels are not heard, a jammed channel is lost */
+  if(rx->f->freq != n->radio.rx_freq ||
+     (sim_config.jam_channel &&
+      rx->f->freq == SIM_FREQ(sim_config.jam_channel))) {
+    return 0;
+  }
+  if(rx->heard < 0) {
+    rx->heard = (sim_random(n) & 0xffffff) < (uint32_t)(rx->prr * 0x1000000);
+  }
+  return rx->heard;
+}
+/*---------------------------------------------------------------------------*/
+static int
+crc_ok(struct sim_node *n)
+{
+  struct sim_radio *r = &n->radio;
+  const struct sim_frame *src = r->inbox[r->lock_src].f;
+  int64_t t_begin = r->lock_sfd - SIM_SHR_NS;
+  int i, differ = 0;
+
+  for(i = r->lock_first; i <= r->lock_last; i++) {
+    const struct sim_frame *f = r->inbox[i].f;
+    if(r->inbox[i].heard != 1) {
+      continue;
+    }
+    if(f->t_abort < r->lock_end) {
+      return 0;
+    }
+    if(f->len != src->len || memcmp(f->data, src->data, src->len) != 0) {
+      differ = 1;
+    }
+  }
+  if(differ) {
+    if(r->lock_capture < 0) {
+      r->lock_capture = (sim_random(n) & 0xffffff) <
+        (uint32_t)(sim_config.capture * 0x1000000);
+    }
+    if(!r->lock_capture) {
+      return 0;
+    }
+  }
+
+  for(i = 0; i < r->inbox_len; i++) {
+    const struct sim_frame *f = r->inbox[i].f;
+    if(i == r->lock_first) {
+      i = r->lock_last;
+      continue;
+    }
+    if(f->t_sfd - SIM_SHR_NS >= r->lock_end) {
+      break;
+    }
+    if(frame_void(f) || f->t_abort <= t_begin ||
+       (f->latched && f->t_end <= t_begin)) {
+      continue;
+    }
+    if(heard(n, &r->inbox[i])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* A frame is being received and its last byte has not arrived yet. */
+static int
+rx_in_progress(struct sim_radio *r)
+{
+  const struct sim_frame *f;
+
+  if(!r->locked || r->lock_flushed) {
+    return 0;
+  }
+  f = r->inbox[r->lock_src].f;
+  return !f->latched || r->lock_bytes <= f->len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+fifop_level(struct sim_radio *r)
+{
+  int unread = r->rxfifo_len - r->rxfifo_read;
+
+  /* above the threshold, or the end of a frame in the RXFIFO */
+  return unread > (r->regs[CC2420_IOCFG0] & FIFOP_THR_MASK) ||
+    (unread > 0 && !rx_in_progress(r));
+}
+/*---------------------------------------------------------------------------*/
+/* Latch a rising edge of FIFOP in P1IFG, as the port does. */
+static void
+fifop_update(struct sim_node *n)
+{
+  struct sim_radio *r = &n->radio;
+  uint8_t level = fifop_level(r);
+
+  if(level && !r->fifop) {
+    *n->worker->image.p1ifg |= P1_FIFOP;
+  }
+  r->fifop = level;
+}
+/*---------------------------------------------------------------------------*/
+/* Move the bytes received up to t into the RXFIFO. */
+static void
+rx_fill(struct sim_node *n, int64_t t)
+{
+  struct sim_radio *r = &n->radio;
+  const struct sim_frame *f;
+  int64_t arrived;
+
+  if(!r->locked || r->lock_flushed) {
+    return;
+  }
+  f = r->inbox[r->lock_src].f;
+  arrived = (t - r->lock_sfd) / SIM_BYTE_NS;
+  if(arrived > f->len + 1) {
+    arrived = f->len + 1;
+  }
+  while(r->lock_bytes < arrived) {
+    uint8_t k = r->lock_bytes++, c;
+    if(k == 0) {
+      c = f->len;
+    } else if(k + 1 < f->len) {
+      c = f->data[k];
+    } else if(k + 1 == f->len) {
+      c = RSSI_BYTE;
+    } else {
+      c = crc_ok(n) ? (FOOTER1_CRC_OK | CORRELATION) : CORRELATION;
+    }
+    if(r->rxfifo_len == sizeof(r->rxfifo) && r->rxfifo_read > 0) {
+      /* the RXFIFO holds 128 bytes not read yet */
+      memmove(r->rxfifo, r->rxfifo + r->rxfifo_read, r->rxfifo_len - r->rxfifo_read);
+      r->rxfifo_len -= r->rxfifo_read;
+      r->rxfifo_read = 0;
+    }
+    if(r->rxfifo_len < sizeof(r->rxfifo)) {
+      r->rxfifo[r->rxfifo_len++] = c;
+    }
+  }
+  fifop_update(n);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rx_unlock(struct sim_node *n, int64_t t)
+{
+  struct sim_radio *r = &n->radio;
+
+  if(r->locked) {
+    rx_fill(n, t);
+    r->locked = 0;
+    r->t_edge = t;
+    fifop_update(n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tx_start(struct sim_node *n, int64_t t)
+{
+  struct sim_radio *r = &n->radio;
+  struct sim_tx *tx = &r->ring[r->ring_next];
+
+  r->ring_next = (r->ring_next + 1) % SIM_TX_RING;
+  tx->t_stxon = t;
+  tx->t_abort = SIM_NEVER;
+  tx->t_end = SIM_NEVER;
+  tx->state = 0;
+  tx->len = 0;
+  tx->freq = r->regs[CC2420_FSCTRL] & SIM_FREQ_MASK;
+  r->tx = tx;
+  r->tx_sfd = 0;
+  if(r->n_dirty < sizeof(r->dirty) / sizeof(r->dirty[0])) {
+    r->dirty[r->n_dirty++] = tx;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* A byte written to the TXFIFO while the frame is on air. */
+static void
+tx_write(struct sim_node *n, uint8_t c)
+{
+  struct sim_radio *r = &n->radio;
+  struct sim_tx *tx = r->tx;
+  uint8_t k = r->txfifo_len - 1;
+
+  if(tx == NULL || !(tx->state & TX_ON_AIR) || k < tx->written) {
+    return;
+  }
+  tx->data[k] = c;
+  tx->written = k + 1;
+  if(r->t > tx->t_stxon + SIM_TURNAROUND_NS + SIM_SHR_NS + k * SIM_BYTE_NS -
+     SIM_TX_MARGIN_NS && tx->t_abort == SIM_NEVER) {
+    /* too late: the CC2420 ran out of bytes to send */
+    tx->t_abort = r->t;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+tx_abort(struct sim_node *n, int64_t t)
+{
+  struct sim_radio *r = &n->radio;
+
+  if(r->tx) {
+    r->tx->t_abort = t;
+    r->tx->state |= TX_OVER;
+    if(r->tx_sfd) {
+      r->tx_sfd = 0;
+      r->t_edge = t;
+    }
+    r->tx = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+status_byte(struct sim_radio *r)
+{
+  uint8_t status = 0;
+  if(r->xosc) {
+    status |= BV(CC2420_XOSC16M_STABLE) | BV(CC2420_LOCK);
+  }
+  if(r->mode == MODE_RX && r->t >= r->rx_ready) {
+    status |= BV(CC2420_RSSI_VALID);
+  }
+  if(r->mode == MODE_TX) {
+    status |= BV(CC2420_TX_ACTIVE);
+  }
+  return status;
+}
+/*---------------------------------------------------------------------------*/
+static void
+strobe(struct sim_node *n, uint8_t s)
+{
+  struct sim_radio *r = &n->radio;
+  int64_t t = r->t;
+
+  switch(s) {
+  case CC2420_SXOSCON:
+    r->xosc = 1;
+    break;
+  case CC2420_SRXON:
+    if(r->xosc) {
+      tx_abort(n, t);
+      rx_unlock(n, t);
+      set_mode(r, MODE_RX, t);
+      r->rx_ready = t + SIM_TURNAROUND_NS;
+      r->rx_freq = r->regs[CC2420_FSCTRL] & SIM_FREQ_MASK;
+    }
+    break;
+  case CC2420_STXON:
+  case CC2420_STXONCCA:
+    if(r->xosc && r->tx == NULL) {
+      rx_unlock(n, t);
+      set_mode(r, MODE_TX, t);
+      tx_start(n, t);
+    }
+    break;
+  case CC2420_SRFOFF:
+  case CC2420_SXOSCOFF:
+    tx_abort(n, t);
+    rx_unlock(n, t);
+    set_mode(r, MODE_IDLE, t);
+    if(s == CC2420_SXOSCOFF) {
+      r->xosc = 0;
+    }
+    break;
+  case CC2420_SFLUSHRX:
+    rx_fill(n, t);
+    r->rxfifo_len = r->rxfifo_read = 0;
+    r->lock_flushed = r->locked;
+    fifop_update(n);
+    break;
+  case CC2420_SFLUSHTX:
+    r->txfifo_len = 0;
+    break;
+  default:
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_radio_init(struct sim_node *n)
+{
+  struct sim_radio *r = &n->radio;
+
+  memset(r, 0, sizeof(*r));
+  /* as left by cc2420_init() and cc2420_set_channel(RF_CHANNEL) in
+     contiki-sky-main.c: oscillator running, radio off, channel 26 */
+  r->xosc = 1;
+  r->regs[CC2420_FSCTRL] = 0x4000 | SIM_FREQ(26);
+  r->rx_freq = SIM_FREQ(26);
+  r->regs[CC2420_IOCFG0] = FIFOP_THR_MASK;
+  r->mode = MODE_IDLE;
+  r->t_edge = SIM_NEVER;
+  r->t_first_ok = SIM_NEVER;
+}
+/*---------------------------------------------------------------------------*/
+int64_t
+sim_radio_on_time(struct sim_node *n)
+{
+  struct sim_radio *r = &n->radio;
+
+  return r->on_ns + (r->mode != MODE_IDLE ? r->t - r->on_since : 0);
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Earliest time from now on at which FIFOP may rise because of the bytes
+ * being received, or SIM_NEVER. sim_radio_fifop_edge() tells whether it
+ * actually did, once the radio has been run up to that time.
+ */
+int64_t
+sim_radio_next_fifop(struct sim_node *n)
+{
+  struct sim_radio *r = &n->radio;
+  const struct sim_frame *f;
+  int need, k;
+
+  rx_fill(n, r->t);
+  if(r->fifop || !r->locked || r->lock_flushed) {
+    return SIM_NEVER;
+  }
+  f = r->inbox[r->lock_src].f;
+  need = (r->regs[CC2420_IOCFG0] & FIFOP_THR_MASK) + 1 -
+    (r->rxfifo_len - r->rxfifo_read);
+  k = r->lock_bytes + need;
+  if(f->latched && k > f->len + 1) {
+    /* the end of the frame raises it anyway */
+    k = f->len + 1;
+  }
+  return r->lock_sfd + k * SIM_BYTE_NS;
+}
+/*---------------------------------------------------------------------------*/
+int
+sim_radio_fifop_edge(struct sim_node *n)
+{
+  struct sim_radio *r = &n->radio;
+  uint8_t before = r->fifop;
+
+  rx_fill(n, r->t);
+  return r->fifop && !before;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Advance the radio up to lim. Stops at the first SFD edge, returning
+ * its time, or returns SIM_NEVER with the radio at lim.
+ */
+int64_t
+sim_radio_run_until(struct sim_node *n, int64_t lim)
+{
+  struct sim_radio *r = &n->radio;
+
+  if(r->t_edge != SIM_NEVER) {
+    int64_t t = r->t_edge;
+    r->t_edge = SIM_NEVER;
+    return t;
+  }
+
+  while(1) {
+    struct sim_tx *tx = r->tx;
+    int64_t t_next = SIM_NEVER;
+
+    if(tx != NULL) {
+      if(!(tx->state & TX_ON_AIR)) {
+        t_next = tx->t_stxon + SIM_TURNAROUND_NS;
+      } else if(!r->tx_sfd) {
+        t_next = tx->t_stxon + SIM_TURNAROUND_NS + SIM_SHR_NS;
+      } else {
+        t_next = tx->t_end;
+      }
+    } else if(r->locked) {
+      const struct sim_frame *f = r->inbox[r->lock_src].f;
+      /* the content (and so the length) is known one byte after the SFD */
+      if(f->latched) {
+        r->lock_end = f->t_end;
+        t_next = r->lock_end;
+      }
+    } else if(r->mode == MODE_RX) {
+      while(r->rx_next < r->inbox_len && r->inbox[r->rx_next].f->t_sfd < r->t) {
+        r->rx_next++;
+      }
+      if(r->rx_next < r->inbox_len) {
+        t_next = r->inbox[r->rx_next].f->t_sfd;
+      }
+    }
+
+    if(t_next > lim) {
+      r->t = lim;
+      return SIM_NEVER;
+    }
+    r->t = t_next;
+
+    if(tx != NULL) {
+      if(!(tx->state & TX_ON_AIR)) {
+        /* preamble starts: the frame is taken from the TXFIFO */
+        tx->len = r->txfifo_len ? r->txfifo[0] & 0x7f : 0;
+        memset(tx->data, 0, sizeof(tx->data));
+        memcpy(tx->data, r->txfifo, r->txfifo_len);
+        tx->written = r->txfifo_len;
+        tx->t_end = t_next + SIM_SHR_NS + (1 + tx->len) * SIM_BYTE_NS;
+        tx->state |= TX_ON_AIR;
+      } else if(!r->tx_sfd) {
+        r->tx_sfd = 1;
+        return t_next;
+      } else {
+        r->tx_sfd = 0;
+        tx->state |= TX_OVER;
+        r->tx = NULL;
+        /* back to receive mode after the transmission */
+        set_mode(r, MODE_RX, t_next);
+        r->rx_ready = t_next + SIM_TURNAROUND_NS;
+        return t_next;
+      }
+    } else if(r->locked) {
+      rx_fill(n, t_next);
+      r->locked = 0;
+      fifop_update(n);
+      if(!r->lock_flushed && r->t_first_ok == SIM_NEVER && crc_ok(n)) {
+        r->t_first_ok = t_next;
+      }
+      return t_next;
+    } else {
+      /* SFD of the next group of transmissions */
+      int first = r->rx_next, last = first, i, src = -1;
+
+      while(last + 1 < r->inbox_len &&
+            r->inbox[last + 1].f->t_sfd - t_next <= SIM_CI_WINDOW_NS) {
+        last++;
+      }
+      r->rx_next = last + 1;
+      if(r->rx_ready > t_next - SIM_SYNC_NS) {
+        continue;
+      }
+      for(i = first; i <= last; i++) {
+        if(!frame_void(r->inbox[i].f) && heard(n, &r->inbox[i]) && src < 0) {
+          src = i;
+        }
+      }
+      if(src >= 0) {
+        r->locked = 1;
+        r->lock_first = first;
+        r->lock_last = last;
+        r->lock_src = src;
+        r->lock_sfd = t_next;
+        r->lock_end = SIM_NEVER;
+        r->lock_bytes = 0;
+        r->lock_flushed = 0;
+        r->lock_capture = -1;
+        return t_next;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Between windows, with all nodes stopped: make the transmissions of
+ * node n visible to its receivers.
+ */
+void
+sim_radio_publish(struct sim_node *n, int64_t t_end, uint32_t window)
+{
+  struct sim_radio *r = &n->radio;
+  int i = 0;
+
+  r->n_published = 0;
+  while(i < r->n_dirty) {
+    struct sim_tx *tx = r->dirty[i];
+    struct sim_frame *f = &tx->frame;
+
+    if(!(tx->state & TX_PUBLISHED)) {
+      f->t_stxon = tx->t_stxon;
+      f->freq = tx->freq;
+      f->t_sfd = tx->t_stxon + SIM_TURNAROUND_NS + SIM_SHR_NS;
+      f->t_end = SIM_NEVER;
+      f->latched = 0;
+      f->window = window;
+      tx->state |= TX_PUBLISHED;
+      r->published[r->n_published++] = f;
+    }
+    f->t_abort = tx->t_abort;
+    if((tx->state & TX_ON_AIR) && !f->latched) {
+      f->len = tx->len;
+      f->t_end = tx->t_end;
+      f->latched = 1;
+    }
+    if(tx->state & TX_ON_AIR) {
+      /* bytes written since the previous window */
+      memcpy(f->data, tx->data, tx->written);
+    }
+    if(tx->state & TX_OVER) {
+      r->dirty[i] = r->dirty[--r->n_dirty];
+    } else {
+      i++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Between windows: add the transmissions published by the nodes node n
+ * can hear to its inbox, and forget the old ones.
+ */
+void
+sim_radio_collect(struct sim_node *n, int64_t t_now)
+{
+  struct sim_radio *r = &n->radio;
+  int i, j, old = 0;
+
+  while(old < r->inbox_len && (!r->locked || old < r->lock_first) &&
+        r->inbox[old].f->t_sfd < t_now - SIM_INBOX_HISTORY_NS) {
+    old++;
+  }
+  if(old > 0) {
+    memmove(r->inbox, r->inbox + old, (r->inbox_len - old) * sizeof(r->inbox[0]));
+    r->inbox_len -= old;
+    r->rx_next = r->rx_next > old ? r->rx_next - old : 0;
+    r->lock_first -= old;
+    r->lock_last -= old;
+    r->lock_src -= old;
+  }
+
+  for(i = 0; i < n->n_links; i++) {
+    struct sim_radio *peer = &sim_nodes[n->links[i].peer].radio;
+    for(j = 0; j < peer->n_published; j++) {
+      struct sim_rx rx;
+      int k;
+      if(r->inbox_len == r->inbox_size) {
+        r->inbox_size = r->inbox_size ? 2 * r->inbox_size : 16;
+        r->inbox = realloc(r->inbox, r->inbox_size * sizeof(r->inbox[0]));
+        if(r->inbox == NULL) {
+          abort();
+        }
+      }
+      rx.f = peer->published[j];
+      rx.prr = n->links[i].prr;
+      rx.heard = -1;
+      /* keep the inbox sorted by SFD time */
+      for(k = r->inbox_len; k > 0 && r->inbox[k - 1].f->t_sfd > rx.f->t_sfd; k--) {
+        r->inbox[k] = r->inbox[k - 1];
+      }
+      r->inbox[k] = rx;
+      r->inbox_len++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+sim_radio_select(struct sim_node *n, int s)
+{
+  n->radio.selected = s;
+  n->radio.access = ACCESS_COMMAND;
+  sim_cpu_consume(n, COST_CS);
+}
+/*---------------------------------------------------------------------------*/
+int
+sim_radio_selected(struct sim_node *n)
+{
+  return n->radio.selected;
+}
+/*---------------------------------------------------------------------------*/
+unsigned char
+sim_radio_spi(struct sim_node *n, unsigned char c)
+{
+  struct sim_radio *r = &n->radio;
+  uint8_t ret = status_byte(r);
+
+  if(r->selected) {
+    switch(r->access) {
+    case ACCESS_COMMAND:
+      if(c & RAM_ACCESS) {
+        r->access = ACCESS_RAM;
+      } else if((c & REG_ADDR_MASK) < CC2420_MAIN) {
+        strobe(n, c & REG_ADDR_MASK);
+      } else if((c & REG_ADDR_MASK) == CC2420_TXFIFO) {
+        r->access = ACCESS_TXFIFO;
+      } else if((c & REG_ADDR_MASK) == CC2420_RXFIFO) {
+        r->access = ACCESS_RXFIFO;
+      } else {
+        r->reg_addr = c & REG_ADDR_MASK;
+        r->reg_read = c & REG_READ;
+        r->access = ACCESS_REG_MSB;
+      }
+      break;
+    case ACCESS_REG_MSB:
+      if(r->reg_read) {
+        ret = r->regs[r->reg_addr] >> 8;
+      } else {
+        r->regs[r->reg_addr] = (r->regs[r->reg_addr] & 0x00ff) | ((uint16_t)c << 8);
+      }
+      r->access = ACCESS_REG_LSB;
+      break;
+    case ACCESS_REG_LSB:
+      if(r->reg_read) {
+        ret = r->regs[r->reg_addr] & 0xff;
+      } else {
+        r->regs[r->reg_addr] = (r->regs[r->reg_addr] & 0xff00) | c;
+        if(r->reg_addr == CC2420_IOCFG0) {
+          rx_fill(n, r->t);
+          fifop_update(n);
+        }
+      }
+      r->access = ACCESS_COMMAND;
+      break;
+    case ACCESS_TXFIFO:
+      if(r->txfifo_len < sizeof(r->txfifo)) {
+        r->txfifo[r->txfifo_len++] = c;
+        tx_write(n, c);
+      }
+      break;
+    case ACCESS_RXFIFO:
+      rx_fill(n, r->t);
+      ret = (r->rxfifo_read < r->rxfifo_len) ? r->rxfifo[r->rxfifo_read++] : 0;
+      fifop_update(n);
+      break;
+    case ACCESS_RAM:
+      break;
+    }
+  } else {
+    ret = 0;
+  }
+  sim_cpu_consume(n, COST_SPI);
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+int
+sim_radio_fifo(struct sim_node *n)
+{
+  struct sim_radio *r = &n->radio;
+  int fifo;
+
+  rx_fill(n, r->t);
+  fifo = r->rxfifo_read < r->rxfifo_len;
+  if(fifo) {
+    sim_cpu_consume(n, COST_PIN);
+  } else {
+    /* Polling an empty FIFO: nothing changes before the next byte. */
+    int64_t t = r->t + POLL_MAX_NS;
+    if(r->locked && !r->lock_flushed) {
+      int64_t t_byte = r->lock_sfd + (r->lock_bytes + 1) * SIM_BYTE_NS;
+      t = t_byte < t ? t_byte : t;
+    }
+    sim_cpu_wait_until(n, t);
+  }
+  return fifo;
+}
+/*---------------------------------------------------------------------------*/
+int
+sim_radio_fifop(struct sim_node *n)
+{
+  struct sim_radio *r = &n->radio;
+
+  rx_fill(n, r->t);
+  sim_cpu_consume(n, COST_PIN);
+  return fifop_level(r);
+}
+/*---------------------------------------------------------------------------*/
+int
+sim_radio_cca(struct sim_node *n)
+{
+  int cca = n->radio.mode == MODE_RX && !n->radio.locked;
+
+  sim_cpu_consume(n, COST_PIN);
+  return cca;
+}
+/*---------------------------------------------------------------------------*/
+int
+sim_radio_sfd(struct sim_node *n)
+{
+  int sfd = n->radio.tx_sfd || n->radio.locked;
+
+  sim_cpu_consume(n, COST_PIN);
+  return sfd;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \file
+ *         Interface between the Glossy simulator and its node image.
+ *
+ *         The node image (sim-node.c linked with Glossy and the Contiki
+ *         kernel) reaches the simulated hardware only through the
+ *         functions below, which the simulator exports. In turn, the
+ *         image exports sim_node_main() and the Timer B1 interrupt
+ *         vector, plus the Timer B registers the interrupt model reads
+ *         and writes.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+
+struct sim_node;
+
+/**
+ * Parameters of one Glossy phase, as handed to a node.
+ */
+struct sim_flood {
+  uint32_t seq_no;        /**< Flood sequence number. */
+  uint16_t duration;      /**< Glossy phase duration, in 32 kHz ticks. */
+  uint16_t id;            /**< Node id appended to the packet by Glossy. */
+  uint8_t initiator;      /**< Not zero at the initiator. */
+  uint8_t sync;           /**< Glossy sync flag. */
+  uint8_t tx_max;         /**< Maximum number of transmissions (N). */
+  uint8_t data_len;       /**< Length of the flooding data, in bytes. */
+  uint8_t burst;          /**< Packets per Glossy phase, 0 for a single flood. */
+  uint8_t aggregate;      /**< Merge operator (SIM_AGG_*), 0 for a plain flood. */
+  uint16_t n_nodes;       /**< Number of nodes taking part in the simulation. */
+  uint16_t index;         /**< Index of the node, between 0 and n_nodes - 1. */
+  uint8_t hopping;        /**< Not zero for per-flood channel hopping. */
+  uint16_t hopping_seed;  /**< Seed of the hopping sequence. */
+  uint16_t blacklist;     /**< Channels excluded from hopping (bit i: 11 + i). */
+  uint8_t ntx_min;        /**< Minimum adaptive N at receivers, 0 for a fixed N. */
+  uint8_t wakeup;         /**< Maximum wake-up margin of receivers, in slots,
+                               0 to listen from the flood start. */
+  uint8_t trace;          /**< Not zero to dump the event trace of the node. */
+};
+
+/* Merge operators of the aggregation mode. */
+enum {
+  SIM_AGG_OFF,
+  SIM_AGG_OR,             /**< Set of the nodes (bit i: node i). */
+  SIM_AGG_MAX,            /**< Maximum of the node ids (16-bit fields). */
+  SIM_AGG_MIN             /**< Minimum of the node ids (16-bit fields). */
+};
+
+/* Timers: 32 kHz Timer A, DCO-sourced Timer B and DCO busy waits. */
+uint16_t sim_cpu_now(struct sim_node *n);
+uint32_t sim_cpu_now_ext(struct sim_node *n);
+uint16_t sim_cpu_now_dco(struct sim_node *n);
+void sim_cpu_delay_dco(struct sim_node *n, unsigned ticks);
+void sim_cpu_capture_next_tick(struct sim_node *n,
+                               uint16_t *t_cap_h, uint16_t *t_cap_l);
+
+/* CC2420 SPI interface and pins. */
+void sim_radio_select(struct sim_node *n, int s);
+int sim_radio_selected(struct sim_node *n);
+unsigned char sim_radio_spi(struct sim_node *n, unsigned char c);
+int sim_radio_fifo(struct sim_node *n);
+int sim_radio_fifop(struct sim_node *n);
+int sim_radio_cca(struct sim_node *n);
+int sim_radio_sfd(struct sim_node *n);
+
+/**
+ * \brief      Wait for the next Glossy phase
+ * \param n    The calling node
+ * \param f    Filled in with the parameters of the phase
+ *
+ *             Sleeps until the phase starts. After the last phase of
+ *             the simulation the function never returns.
+ */
+void sim_node_next_flood(struct sim_node *n, struct sim_flood *f);
+
+/**
+ * \brief      Report the outcome of a Glossy phase
+ */
+void sim_node_flood_done(struct sim_node *n, uint8_t rx_cnt, uint8_t packets,
+                         uint8_t relay_cnt, uint16_t T_slot_h);
+
+/* Exported by the node image. */
+void sim_node_main(struct sim_node *n);
+
+#endif /* SIM_H_ */
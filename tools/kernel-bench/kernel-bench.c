@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \file
+ *         Dispatch cost of the Contiki process kernel on the host.
+ *
+ *         For a growing number of running processes, measures the time
+ *         taken by process_run() to serve one poll and one posted event,
+ *         and checks that the polls and events of a high-priority
+ *         process are served before those of the normal ones. The cost
+ *         of a dispatch should not depend on the number of processes.
+ *
+ *         For a growing number of pending event timers, measures the
+ *         time taken to set a timer, to stop one and to deliver one on
+ *         expiry, and checks that the timers are delivered in order of
+ *         expiration.
+ *
+ *         The clock is the tickless MSP430 one, run on a simulated
+ *         Timer A. Over many wraps of TAR, checks that the clock and
+ *         the extended rtimer time follow the elapsed ticks, and that
+ *         event timers expire in their own tick when only the clock
+ *         polls them. Checks that real-time tasks posted on the
+ *         extended rtimer clock, up to 30 s ahead, run in order at
+ *         their exact time.
+ *
+ *         Usage: kernel-bench [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+
+#define MAX_PROCS     1024
+#define MAX_TIMERS    4096
+/* The timers are set to expire within this many ticks. */
+#define TIMER_TICKS   256
+
+static struct process procs[MAX_PROCS];
+static unsigned long calls;
+static struct process *order[4];
+static int n_order;
+
+/* Timer A ticks per clock tick */
+#define TICK          (RTIMER_ARCH_SECOND / CLOCK_SECOND)
+
+static struct etimer timers[MAX_TIMERS];
+static clock_time_t last_expiration;
+static int out_of_order;
+
+#define MAX_RTIMERS   3
+
+static struct rtimer rtimers[MAX_RTIMERS];
+static struct rtimer *rtimer_order[MAX_RTIMERS];
+static rtimer_ext_clock_t rtimer_run_at[MAX_RTIMERS];
+static int n_rtimer;
+
+/* The Timer A interrupts of cpu/msp430, raised by timer_advance(). */
+void timera0(void);
+void timera1(void);
+
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(bench_thread(struct pt *pt, process_event_t ev, process_data_t data))
+{
+  PT_BEGIN(pt);
+  while(1) {
+    calls++;
+    if(n_order < sizeof(order) / sizeof(order[0])) {
+      order[n_order++] = process_current;
+    }
+    PT_YIELD(pt);
+  }
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(timer_thread(struct pt *pt, process_event_t ev, process_data_t data))
+{
+  PT_BEGIN(pt);
+  while(1) {
+    if(ev == PROCESS_EVENT_TIMER) {
+      clock_time_t t = etimer_expiration_time(data);
+
+      calls++;
+      if(t < last_expiration || t != clock_time()) {
+        out_of_order++;
+      }
+      last_expiration = t;
+    }
+    PT_YIELD(pt);
+  }
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rtimer_task(struct rtimer *t, void *ptr)
+{
+  if(n_rtimer < MAX_RTIMERS) {
+    rtimer_order[n_rtimer] = t;
+    rtimer_run_at[n_rtimer] = RTIMER_NOW_EXT();
+  }
+  n_rtimer++;
+}
+/*---------------------------------------------------------------------------*/
+/* Let the given number of ticks elapse on Timer A, raising the
+   interrupts of the compare registers whose value is reached. */
+static void
+timer_advance(unsigned long ticks)
+{
+  unsigned long step, to_ccr0, to_ccr1;
+
+  while(ticks > 0) {
+    to_ccr0 = (unsigned short)(TACCR0 - TAR - 1) + 1UL;
+    to_ccr1 = (unsigned short)(TACCR1 - TAR - 1) + 1UL;
+    step = ticks;
+    if(step > to_ccr0) {
+      step = to_ccr0;
+    }
+    if(step > to_ccr1) {
+      step = to_ccr1;
+    }
+    TAR += step;
+    ticks -= step;
+    /* CCR0 has the higher priority */
+    if(TAR == TACCR0 && (TACCTL0 & CCIE)) {
+      timera0();
+    }
+    if(TAR == TACCR1 && (TACCTL1 & CCIE)) {
+      TAIV = 2;
+      timera1();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_procs(int n)
+{
+  int i;
+
+  process_init();
+  for(i = 0; i < n; i++) {
+    procs[i].name = "bench";
+    procs[i].thread = bench_thread;
+    procs[i].prio = PROCESS_PRIO_NORMAL;
+    process_start(&procs[i], NULL);
+  }
+  while(process_run() > 0);
+}
+/*---------------------------------------------------------------------------*/
+static double
+now_ns(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+/* Average time to serve a poll (or an event) to the first started
+   process, which is the last one in the process list. */
+static double
+bench_dispatch(int n, long rounds, int poll)
+{
+  double t0;
+  long r;
+
+  start_procs(n);
+  calls = 0;
+  t0 = now_ns();
+  for(r = 0; r < rounds; r++) {
+    if(poll) {
+      process_poll(&procs[0]);
+    } else {
+      process_post(&procs[0], PROCESS_EVENT_CONTINUE, NULL);
+    }
+    process_run();
+  }
+  t0 = now_ns() - t0;
+  if(calls != rounds) {
+    fprintf(stderr, "%lu calls for %ld %s\n", calls, rounds, poll ? "polls" : "events");
+    exit(EXIT_FAILURE);
+  }
+  return t0 / rounds;
+}
+/*---------------------------------------------------------------------------*/
+/* Average time to set, to stop and to deliver one of n event timers,
+   in t[0], t[1] and t[2]. Every other timer is stopped before it
+   expires. */
+static void
+bench_etimer(int n, double t[3])
+{
+  double t0;
+  int i;
+
+  process_init();
+  process_start(&etimer_process, NULL);
+  procs[0].name = "timers";
+  procs[0].thread = timer_thread;
+  procs[0].prio = PROCESS_PRIO_NORMAL;
+  process_start(&procs[0], NULL);
+  while(process_run() > 0);
+
+  memset(timers, 0, sizeof(timers));
+  srand(n);
+  calls = 0;
+  last_expiration = clock_time();
+
+  /* as if set by the timer process */
+  process_current = &procs[0];
+  t0 = now_ns();
+  for(i = 0; i < n; i++) {
+    etimer_set(&timers[i], 1 + rand() % TIMER_TICKS);
+  }
+  t[0] = (now_ns() - t0) / n;
+  t0 = now_ns();
+  for(i = 0; i < n; i += 2) {
+    etimer_stop(&timers[i]);
+  }
+  t[1] = (now_ns() - t0) / ((n + 1) / 2);
+  process_current = PROCESS_NONE;
+
+  t0 = now_ns();
+  for(i = 0; i <= TIMER_TICKS; i++) {
+    timer_advance(TICK);
+    etimer_request_poll();
+    while(process_run() > 0);
+  }
+  t[2] = (now_ns() - t0) / (n / 2);
+  if(calls != n / 2 || etimer_pending()) {
+    fprintf(stderr, "%lu of %d timers expired\n", calls, n / 2);
+    exit(EXIT_FAILURE);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_priorities(void)
+{
+  start_procs(2);
+  process_set_prio(&procs[1], PROCESS_PRIO_HIGH);
+
+  /* requested first, served last */
+  n_order = 0;
+  process_poll(&procs[0]);
+  process_poll(&procs[1]);
+  process_run();
+  if(n_order != 2 || order[0] != &procs[1] || order[1] != &procs[0]) {
+    return 0;
+  }
+  n_order = 0;
+  process_post(&procs[0], PROCESS_EVENT_CONTINUE, NULL);
+  process_post(&procs[1], PROCESS_EVENT_CONTINUE, NULL);
+  while(process_run() > 0);
+  return n_order == 2 && order[0] == &procs[1] && order[1] == &procs[0];
+}
+/*---------------------------------------------------------------------------*/
+/* Tickless clock: over about a hundred wraps of TAR, the clock and
+   the extended rtimer time must follow the elapsed ticks, which they
+   only do if the clock wakes up at least every half wrap to count
+   them. Then event timers from one tick to 30 s must expire in their
+   own tick, the etimer process being polled by the clock only. */
+static int
+check_clock(void)
+{
+  static const clock_time_t delays[] = {
+    1, 2, CLOCK_SECOND / 2, 3 * CLOCK_SECOND + 1, 30 * CLOCK_SECOND
+  };
+  const int n = sizeof(delays) / sizeof(delays[0]);
+  rtimer_ext_clock_t ext0, elapsed;
+  clock_time_t clock0;
+  unsigned long step;
+  int i;
+
+  ext0 = RTIMER_NOW_EXT();
+  clock0 = clock_time();
+  elapsed = 0;
+  srand(1);
+  for(i = 0; i < 64; i++) {
+    step = 1 + rand() % (3 * RTIMER_ARCH_SECOND);
+    timer_advance(step);
+    elapsed += step;
+    if(RTIMER_NOW_EXT() - ext0 != elapsed ||
+       clock_time() - clock0 != (ext0 + elapsed) / TICK - ext0 / TICK) {
+      printf("clock: %lu ticks counted for %lu\n",
+             (unsigned long)(RTIMER_NOW_EXT() - ext0), (unsigned long)elapsed);
+      return 0;
+    }
+  }
+
+  process_init();
+  process_start(&etimer_process, NULL);
+  procs[0].name = "timers";
+  procs[0].thread = timer_thread;
+  procs[0].prio = PROCESS_PRIO_NORMAL;
+  process_start(&procs[0], NULL);
+  while(process_run() > 0);
+
+  memset(timers, 0, sizeof(timers));
+  calls = 0;
+  out_of_order = 0;
+  last_expiration = clock_time();
+  process_current = &procs[0];
+  for(i = 0; i < n; i++) {
+    etimer_set(&timers[i], delays[i]);
+  }
+  process_current = PROCESS_NONE;
+
+  /* As the main loop of the sky: program the wakeup before sleeping,
+     and run the processes again only once an interrupt polled one. */
+  clock_schedule_wakeup();
+  for(i = 0; i <= delays[n - 1]; i++) {
+    timer_advance(TICK);
+    if(process_nevents() > 0) {
+      while(process_run() > 0);
+      clock_schedule_wakeup();
+    }
+  }
+  if(calls != n || out_of_order) {
+    printf("clock: %lu of %d timers expired, %d late\n", calls, n, out_of_order);
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Extended rtimer clock: tasks 1000 ticks, 3 s and 30 s ahead,
+   posted in every order, must run in order, each at its own time.
+   The last two lie beyond a wrap of TAR, where their 16-bit times
+   alias earlier ones. */
+static int
+check_rtimer(void)
+{
+  static const rtimer_ext_clock_t delays[MAX_RTIMERS] = {
+    1000, 3 * RTIMER_ARCH_SECOND + 7, 30 * RTIMER_ARCH_SECOND
+  };
+  static const int posts[][MAX_RTIMERS] = {
+    {0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+  };
+  rtimer_ext_clock_t start;
+  int i, j, k;
+
+  for(j = 0; j < sizeof(posts) / sizeof(posts[0]); j++) {
+    start = RTIMER_NOW_EXT();
+    n_rtimer = 0;
+    for(i = 0; i < MAX_RTIMERS; i++) {
+      k = posts[j][i];
+      rtimer_set_ext(&rtimers[k], start + delays[k], 1, rtimer_task, NULL);
+    }
+    timer_advance(delays[MAX_RTIMERS - 1] + RTIMER_ARCH_SECOND);
+    if(n_rtimer != MAX_RTIMERS) {
+      printf("rtimer: %d of %d tasks run\n", n_rtimer, MAX_RTIMERS);
+      return 0;
+    }
+    for(i = 0; i < MAX_RTIMERS; i++) {
+      k = rtimer_order[i] - rtimers;
+      if(k != i || rtimer_run_at[i] != start + delays[k] ||
+         RTIMER_TIME_EXT(rtimer_order[i]) != start + delays[k]) {
+        printf("rtimer: task %d run at +%lu, task %d due at +%lu\n", k,
+               (unsigned long)(rtimer_run_at[i] - start), i,
+               (unsigned long)delays[i]);
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  long rounds = argc > 1 ? atol(argv[1]) : 1000000;
+  int n;
+
+  if(rounds < 1) {
+    fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  TAR = 0;
+  clock_init();
+  rtimer_init();
+
+  printf("processes  poll (ns)  event (ns)\n");
+  for(n = 1; n <= MAX_PROCS; n *= 4) {
+    double t_poll = bench_dispatch(n, rounds, 1);
+    double t_event = bench_dispatch(n, rounds, 0);
+    printf("%9d  %9.1f  %10.1f\n", n, t_poll, t_event);
+  }
+  printf("\ntimers  set (ns)  stop (ns)  expire (ns)\n");
+  for(n = 16; n <= MAX_TIMERS; n *= 4) {
+    double t[3];
+
+    bench_etimer(n, t);
+    printf("%6d  %8.1f  %9.1f  %11.1f\n", n, t[0], t[1], t[2]);
+  }
+  if(out_of_order) {
+    printf("timers: %d delivered out of order or late\n", out_of_order);
+    return EXIT_FAILURE;
+  }
+  printf("timers: ok\n");
+  if(!check_priorities()) {
+    printf("priorities: high-priority process not served first\n");
+    return EXIT_FAILURE;
+  }
+  printf("priorities: ok\n");
+  if(!check_clock()) {
+    return EXIT_FAILURE;
+  }
+  printf("clock: ok\n");
+  if(!check_rtimer()) {
+    return EXIT_FAILURE;
+  }
+  printf("rtimer: ok\n");
+  return EXIT_SUCCESS;
+}
+/*---------------------------------------------------------------------------*/
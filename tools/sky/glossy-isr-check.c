@@ -0,0 +1,695 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Check of the constant part of the service delay of the SFD
+ *         interrupt of Glossy (timerb1_interrupt() in core/dev/glossy.c).
+ *
+ *         The interrupt handler computes T_irq from the difference between
+ *         the DCO clock when it starts and the capture of the SFD, minus a
+ *         constant: the cycles from the SFD to the reading of TBR when the
+ *         interrupt is served immediately. If the compiler emits different
+ *         code, the constant changes and the relays are no longer aligned.
+ *
+ *         Reads the disassembly of the .glossy section, e.g.:
+ *
+ *           msp430-objdump -d -j .glossy glossy-test.sky | \
+ *             glossy-isr-check -s core/dev/glossy.c
+ *
+ *         counts the cycles (MSP430x1xx instruction timings) from the
+ *         acceptance of the interrupt to the reading of TBR and along the
+ *         relay path, through the NOP sled, to the STXON strobe. With -s it
+ *         compares the first count with the constant in the source file and
+ *         exits with status 1 if they differ; with -u it rewrites the
+ *         constant instead. cpu/msp430/Makefile.msp430 runs it with the
+ *         %.isr-check target, which applications build with
+ *         make TARGET=sky GLOSSY_ISR_CHECK=1.
+ *
+ *         With -d it prints instead the worst-case cycles from the SFD to
+ *         each function called by the handler (the dispatch latency).
+ *
+ *         Build with: cc -o glossy-isr-check glossy-isr-check.c
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_INSNS    2048
+#define MAX_PATHS    64
+#define LINE_LEN     256
+
+/* Cycles from the SFD capture to the first instruction of the handler. */
+#define IRQ_LATENCY  6
+
+enum mode { REG, IND, AUTOINC, IMM, MEM, NONE };
+
+struct insn {
+  unsigned long addr;
+  char op[16];
+  char src[64];
+  char dst[64];
+  char comment[64];
+  unsigned long target;  /* jumps: destination address */
+  int cycles;
+};
+
+static struct insn insns[MAX_INSNS];
+static int n_insns;
+
+static unsigned long tbr = 0x0190;   /* TBR */
+static unsigned long txbuf = 0x0077; /* U0TXBUF, CC2420 SPI */
+static int latency = IRQ_LATENCY;
+static int dispatch;
+
+/* Relay paths found by path_search(). */
+static int path[MAX_INSNS], path_len;
+static int path_cycles[MAX_PATHS], path_tbr[MAX_PATHS], path_calls[MAX_PATHS];
+static int n_paths;
+static char on_path[MAX_INSNS], reach[MAX_INSNS];
+
+/* Longest acyclic paths from the entry, for the dispatch latencies. */
+static int order[MAX_INSNS], n_order, rank[MAX_INSNS], longest[MAX_INSNS];
+/*---------------------------------------------------------------------------*/
+static void
+trim(char *s)
+{
+  char *p = s;
+  size_t n;
+
+  while(isspace((unsigned char)*p)) {
+    p++;
+  }
+  memmove(s, p, strlen(p) + 1);
+  n = strlen(s);
+  while(n > 0 && isspace((unsigned char)s[n - 1])) {
+    s[--n] = '\0';
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_reg(const char *s)
+{
+  if(!strcmp(s, "sp") || !strcmp(s, "pc") || !strcmp(s, "sr")) {
+    return 1;
+  }
+  return (s[0] == 'r' && isdigit((unsigned char)s[1]) &&
+          (s[2] == '\0' || (isdigit((unsigned char)s[2]) && s[3] == '\0')));
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_pc(const char *s)
+{
+  return !strcmp(s, "r0") || !strcmp(s, "pc");
+}
+/*---------------------------------------------------------------------------*/
+static enum mode
+operand_mode(const char *s, const char *comment)
+{
+  size_t n = strlen(s);
+
+  if(n == 0) {
+    return NONE;
+  }
+  if(is_reg(s)) {
+    return REG;
+  }
+  if(s[0] == '@') {
+    return s[n - 1] == '+' ? AUTOINC : IND;
+  }
+  if(s[0] == '#') {
+    /* constants 0, 1, 2, 4, 8 and -1 come from the constant generators */
+    return strstr(comment, "As==") ? REG : IMM;
+  }
+  /* indexed, symbolic or absolute */
+  return MEM;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_jump(const char *op)
+{
+  static const char *jumps[] = {
+    "jmp", "jne", "jnz", "jeq", "jz", "jnc", "jlo", "jc", "jhs",
+    "jn", "jge", "jl", NULL
+  };
+  int i;
+
+  for(i = 0; jumps[i]; i++) {
+    if(!strcmp(op, jumps[i])) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Cycles of an instruction (MSP430x1xx family user's guide, sec. 3.4.4). */
+static int
+insn_cycles(struct insn *in)
+{
+  /* format I: rows source (REG, IND, AUTOINC/IMM, MEM),
+     columns destination (register, PC, memory) */
+  static const int fmt1[4][3] = {
+    { 1, 2, 4 }, { 2, 2, 5 }, { 2, 3, 5 }, { 3, 3, 6 }
+  };
+  /* format II: rows as above, columns RRA/RRC/SWPB/SXT, PUSH, CALL */
+  static const int fmt2[5][3] = {
+    { 1, 3, 4 }, { 3, 4, 4 }, { 3, 5, 5 }, { 0, 4, 5 }, { 4, 5, 5 }
+  };
+  /* emulated instructions with a constant generator as source */
+  static const char *emul_cg[] = {
+    "clr", "inc", "incd", "dec", "decd", "inv", "tst", "adc", "sbc",
+    "dadc", NULL
+  };
+  static const char *emul_sr[] = {
+    "setc", "clrc", "setz", "clrz", "setn", "clrn", "dint", "eint", "nop",
+    NULL
+  };
+  enum mode s, d;
+  int i, row, col;
+  const char *dst;
+
+  if(is_jump(in->op)) {
+    return 2;
+  }
+  if(!strcmp(in->op, "reti")) {
+    return 5;
+  }
+  if(!strcmp(in->op, "ret")) {
+    return 3;
+  }
+  for(i = 0; emul_sr[i]; i++) {
+    if(!strcmp(in->op, emul_sr[i])) {
+      return 1;
+    }
+  }
+  if(!strcmp(in->op, "rrc") || !strcmp(in->op, "rra") ||
+     !strcmp(in->op, "swpb") || !strcmp(in->op, "sxt") ||
+     !strcmp(in->op, "push") || !strcmp(in->op, "call")) {
+    s = operand_mode(in->src, in->comment);
+    row = s == REG ? 0 : s == IND ? 1 : s == AUTOINC ? 2 : s == IMM ? 3 : 4;
+    col = !strcmp(in->op, "push") ? 1 : !strcmp(in->op, "call") ? 2 : 0;
+    return fmt2[row][col];
+  }
+  /* format I, possibly emulated */
+  s = operand_mode(in->src, in->comment);
+  dst = in->dst;
+  for(i = 0; emul_cg[i]; i++) {
+    if(!strcmp(in->op, emul_cg[i])) {
+      s = REG;
+      dst = in->src;
+    }
+  }
+  if(!strcmp(in->op, "rla") || !strcmp(in->op, "rlc")) {
+    /* add/addc dst, dst */
+    dst = in->src;
+  } else if(!strcmp(in->op, "pop")) {
+    s = AUTOINC;
+    dst = in->src;
+  } else if(!strcmp(in->op, "br")) {
+    dst = "pc";
+  }
+  d = operand_mode(dst, "");
+  row = s == REG ? 0 : s == IND ? 1 : (s == AUTOINC || s == IMM) ? 2 : 3;
+  col = is_pc(dst) ? 1 : d == REG ? 0 : 2;
+  return fmt1[row][col];
+}
+/*---------------------------------------------------------------------------*/
+/* Parse one line of objdump output, returns 1 for an instruction. */
+static int
+parse_line(char *line, struct insn *in)
+{
+  char *p, *tab, *ops, *semi, *comma;
+
+  p = line;
+  while(*p == ' ') {
+    p++;
+  }
+  if(!isxdigit((unsigned char)*p)) {
+    return 0;
+  }
+  in->addr = strtoul(p, &p, 16);
+  if(*p != ':') {
+    return 0;
+  }
+  /* address, bytes, mnemonic and operands are separated by tabs */
+  tab = strchr(p, '\t');
+  if(tab == NULL || (tab = strchr(tab + 1, '\t')) == NULL) {
+    /* continuation line with the remaining bytes of an instruction */
+    return 0;
+  }
+  tab++;
+  ops = tab;
+  while(*ops && !isspace((unsigned char)*ops)) {
+    ops++;
+  }
+  snprintf(in->op, sizeof(in->op), "%.*s", (int)(ops - tab), tab);
+  /* byte and word forms take the same time */
+  if((p = strchr(in->op, '.')) != NULL) {
+    *p = '\0';
+  }
+  in->comment[0] = '\0';
+  if((semi = strchr(ops, ';')) != NULL) {
+    snprintf(in->comment, sizeof(in->comment), "%s", semi + 1);
+    trim(in->comment);
+    *semi = '\0';
+  }
+  in->src[0] = in->dst[0] = '\0';
+  comma = strchr(ops, ',');
+  if(comma) {
+    *comma = '\0';
+    snprintf(in->dst, sizeof(in->dst), "%s", comma + 1);
+    trim(in->dst);
+  }
+  snprintf(in->src, sizeof(in->src), "%s", ops);
+  trim(in->src);
+  in->target = 0;
+  if(is_jump(in->op)) {
+    if((p = strstr(in->comment, "abs 0x")) != NULL) {
+      in->target = strtoul(p + 4, NULL, 16);
+    } else if(in->src[0] == '$' || in->src[0] == '.') {
+      in->target = in->addr + strtol(in->src + 1, NULL, 0);
+    }
+  }
+  in->cycles = insn_cycles(in);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+find_insn(unsigned long addr)
+{
+  int i;
+
+  for(i = 0; i < n_insns; i++) {
+    if(insns[i].addr == addr) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+abs_operand(const char *s)
+{
+  return s[0] == '&' ? strtoul(s + 1, NULL, 0) : (unsigned long)-1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_sled(const struct insn *in)
+{
+  /* add T_irq, r0: skips T_irq / 2 NOPs */
+  return !strcmp(in->op, "add") && is_pc(in->dst) &&
+         operand_mode(in->src, in->comment) != IMM;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_strobe_stxon(const struct insn *in)
+{
+  /* mov.b #4, &U0TXBUF (CC2420_STXON) */
+  return !strcmp(in->op, "mov") && !strcmp(in->src, "#4") &&
+         abs_operand(in->dst) == txbuf;
+}
+/*---------------------------------------------------------------------------*/
+static void
+path_found(void)
+{
+  int i, cycles = latency, tbr_cycles = -1, calls = 0, sled = 0;
+
+  for(i = 0; i < path_len; i++) {
+    struct insn *in = &insns[path[i]];
+    cycles += in->cycles;
+    if(tbr_cycles < 0 && (abs_operand(in->src) == tbr)) {
+      tbr_cycles = cycles;
+    }
+    calls += !strcmp(in->op, "call");
+    sled |= is_sled(in);
+  }
+  if(!sled || n_paths == MAX_PATHS) {
+    /* not the relay path (e.g., a transmission started by a timeout) */
+    return;
+  }
+  path_cycles[n_paths] = cycles;
+  path_tbr[n_paths] = tbr_cycles;
+  path_calls[n_paths] = calls;
+  n_paths++;
+}
+/*---------------------------------------------------------------------------*/
+/* Successors of instruction i in the control flow, returns their number.
+   Calls return; the relay paths end at the STXON strobe. */
+static int
+successors(int i, int *next)
+{
+  struct insn *in = &insns[i];
+
+  if((is_strobe_stxon(in) && !dispatch) ||
+     !strcmp(in->op, "ret") || !strcmp(in->op, "reti")) {
+    return 0;
+  }
+  if(is_jump(in->op)) {
+    next[0] = find_insn(in->target);
+    if(!strcmp(in->op, "jmp")) {
+      return next[0] >= 0;
+    }
+    /* conditional: both ways */
+    next[1] = i + 1;
+    if(next[0] < 0) {
+      next[0] = next[1];
+      return 1;
+    }
+    return 2;
+  }
+  if((is_pc(in->dst) || !strcmp(in->op, "br")) && !is_sled(in)) {
+    /* other computed branches: only to a known address */
+    next[0] = in->src[0] == '#' ? find_insn(strtoul(in->src + 1, NULL, 0)) : -1;
+    return next[0] >= 0;
+  }
+  /* the sled is entered with T_irq = 0: all the NOPs are executed */
+  next[0] = i + 1;
+  return next[0] < n_insns;
+}
+/*---------------------------------------------------------------------------*/
+/* Mark the instructions from which an STXON strobe can be reached. */
+static void
+compute_reach(void)
+{
+  int i, j, n, next[2], changed = 1;
+
+  for(i = 0; i < n_insns; i++) {
+    reach[i] = is_strobe_stxon(&insns[i]);
+  }
+  while(changed) {
+    changed = 0;
+    for(i = n_insns - 1; i >= 0; i--) {
+      n = successors(i, next);
+      for(j = 0; j < n && !reach[i]; j++) {
+        if(reach[next[j]]) {
+          reach[i] = 1;
+          changed = 1;
+        }
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Depth-first search of the acyclic paths from i to an STXON strobe. */
+static void
+path_search(int i)
+{
+  int j, n, next[2];
+
+  if(!reach[i] || on_path[i] || n_paths == MAX_PATHS) {
+    return;
+  }
+  on_path[i] = 1;
+  path[path_len++] = i;
+  if(is_strobe_stxon(&insns[i])) {
+    path_found();
+  } else {
+    n = successors(i, next);
+    for(j = 0; j < n; j++) {
+      path_search(next[j]);
+    }
+  }
+  path_len--;
+  on_path[i] = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+postorder(int i)
+{
+  int j, n, next[2];
+
+  rank[i] = -2;
+  n = successors(i, next);
+  for(j = 0; j < n; j++) {
+    if(rank[next[j]] == -1) {
+      postorder(next[j]);
+    }
+  }
+  order[n_order++] = i;
+}
+/*---------------------------------------------------------------------------*/
+/* Worst-case cycles from the SFD to each call of the handler, i.e., to the
+   first instruction of the functions it calls (loops taken once). */
+static int
+print_dispatch(void)
+{
+  int i, j, k, n, next[2], worst = 0;
+
+  for(i = 0; i < n_insns; i++) {
+    rank[i] = -1;
+    longest[i] = -1;
+  }
+  n_order = 0;
+  postorder(0);
+  /* reverse postorder: edges to an earlier rank close a loop */
+  for(k = 0; k < n_order; k++) {
+    rank[order[n_order - 1 - k]] = k;
+  }
+  longest[0] = latency + insns[0].cycles;
+  for(k = 0; k < n_order; k++) {
+    i = order[n_order - 1 - k];
+    n = successors(i, next);
+    for(j = 0; j < n; j++) {
+      if(rank[next[j]] > k && longest[i] + insns[next[j]].cycles > longest[next[j]]) {
+        longest[next[j]] = longest[i] + insns[next[j]].cycles;
+      }
+    }
+  }
+  for(i = 0; i < n_insns; i++) {
+    if(longest[i] >= 0 && !strcmp(insns[i].op, "call")) {
+      printf("call %s%s%s: after %d cycles at most\n", insns[i].src,
+             insns[i].comment[0] ? " ;" : "", insns[i].comment, longest[i]);
+      if(longest[i] > worst) {
+        worst = longest[i];
+      }
+    }
+  }
+  printf("worst-case dispatch: %d cycles\n", worst);
+  return worst;
+}
+/*---------------------------------------------------------------------------*/
+static int
+count_nops(void)
+{
+  int i, n = 0;
+
+  for(i = 0; i < n_insns && !is_sled(&insns[i]); i++);
+  for(i++; i < n_insns && !strcmp(insns[i].op, "nop"); i++) {
+    n++;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* Number that follows key in buf, -1 if not found.
+   If value is not negative, the number is replaced by value. */
+static int
+number_after(char *buf, size_t size, const char *key, int value)
+{
+  char *p = strstr(buf, key), digits[16];
+  size_t n, len;
+  int old;
+
+  if(p == NULL) {
+    return -1;
+  }
+  p += strlen(key);
+  old = atoi(p);
+  if(value >= 0) {
+    n = strspn(p, "0123456789");
+    len = snprintf(digits, sizeof(digits), "%d", value);
+    if(strlen(buf) + len - n >= size) {
+      return -1;
+    }
+    memmove(p + len, p + n, strlen(p + n) + 1);
+    memcpy(p, digits, len);
+  }
+  return old;
+}
+/*---------------------------------------------------------------------------*/
+/* Constant of the interrupt delay in the source file, -1 if not found.
+   If update is not negative, it is replaced by update. */
+static int
+source_constant(const char *file, int update)
+{
+  static char buf[1 << 17];
+  int constant, n;
+  FILE *f;
+
+  if((f = fopen(file, "r")) == NULL) {
+    perror(file);
+    return -1;
+  }
+  n = fread(buf, 1, sizeof(buf) - 16, f);
+  fclose(f);
+  buf[n] = '\0';
+  constant = number_after(buf, sizeof(buf), "RTIMER_NOW_DCO() - TBCCR1) - ", -1);
+  if(constant < 0) {
+    fprintf(stderr, "%s: interrupt delay constant not found\n", file);
+    return -1;
+  }
+  if(update < 0 || update == constant) {
+    return constant;
+  }
+  number_after(buf, sizeof(buf), "RTIMER_NOW_DCO() - TBCCR1) - ", update);
+  /* the comment that mentions it */
+  number_after(buf, sizeof(buf), "interrupt delay (currently ", update);
+  if((f = fopen(file, "w")) == NULL || fputs(buf, f) == EOF) {
+    perror(file);
+    return -1;
+  }
+  fclose(f);
+  return update;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  char line[LINE_LEN];
+  const char *source = NULL;
+  int c, i, in_isr = 0, update = 0, measured, constant, nops, status = 0;
+  FILE *in = stdin;
+
+  while((c = getopt(argc, argv, "s:udl:t:x:h")) != -1) {
+    switch(c) {
+    case 's':
+      source = optarg;
+      break;
+    case 'u':
+      update = 1;
+      break;
+    case 'd':
+      dispatch = 1;
+      break;
+    case 'l':
+      latency = atoi(optarg);
+      break;
+    case 't':
+      tbr = strtoul(optarg, NULL, 0);
+      break;
+    case 'x':
+      txbuf = strtoul(optarg, NULL, 0);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-s glossy.c [-u]] [-d] [-l latency] [-t TBR] [-x TXBUF] [file]\n"
+              "  -s file  compare the constant in the source file with the disassembly\n"
+              "  -u       rewrite the constant if it differs\n"
+              "  -d       print the worst-case cycles to each call of the handler instead\n"
+              "  -l n     cycles to accept the interrupt (default %d)\n"
+              "  -t addr  address of TBR (default 0x%04lx)\n"
+              "  -x addr  address of the SPI transmit buffer (default 0x%04lx)\n",
+              argv[0], IRQ_LATENCY, tbr, txbuf);
+      return c == 'h' ? 0 : 1;
+    }
+  }
+  if(optind < argc) {
+    in = fopen(argv[optind], "r");
+    if(in == NULL) {
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+
+  while(fgets(line, sizeof(line), in) != NULL) {
+    if(strstr(line, ">:")) {
+      /* start of a function */
+      in_isr = strstr(line, "<timerb1_interrupt>:") != NULL;
+      continue;
+    }
+    if(in_isr && n_insns < MAX_INSNS && parse_line(line, &insns[n_insns])) {
+      n_insns++;
+    }
+  }
+  if(n_insns == 0) {
+    fprintf(stderr, "timerb1_interrupt not found in the disassembly\n");
+    return 1;
+  }
+
+  if(dispatch) {
+    print_dispatch();
+    return 0;
+  }
+  compute_reach();
+  if(reach[0]) {
+    path_search(0);
+  }
+  if(n_paths == 0) {
+    fprintf(stderr, "no path through the NOP sled to the STXON strobe\n");
+    return 1;
+  }
+  for(i = 0; i < n_paths; i++) {
+    printf("relay path %d: TBR read after %d cycles, STXON strobe after %d cycles (T_irq = 0)%s\n",
+           i + 1, path_tbr[i], path_cycles[i], path_calls[i] ? ", with calls" : "");
+    if(path_tbr[i] != path_tbr[0] || path_cycles[i] != path_cycles[0]) {
+      /* the delay depends on the path, the sled cannot compensate for it */
+      status = 1;
+    }
+  }
+  if(status) {
+    fprintf(stderr, "relay paths with different delays\n");
+  }
+  nops = count_nops();
+  printf("NOP sled: %d NOPs\n", nops);
+  if(nops < 5) {
+    /* T_irq <= 8 skips up to 4 NOPs */
+    fprintf(stderr, "NOP sled shorter than the range of T_irq\n");
+    status = 1;
+  }
+  measured = path_tbr[0];
+  if(measured < 0) {
+    fprintf(stderr, "TBR (0x%04lx) not read on the relay path\n", tbr);
+    return 1;
+  }
+  if(source) {
+    constant = source_constant(source, -1);
+    if(constant < 0) {
+      return 1;
+    }
+    if(constant == measured) {
+      printf("interrupt delay constant %d DCO ticks: OK\n", constant);
+    } else if(update) {
+      if(source_constant(source, measured) < 0) {
+        return 1;
+      }
+      printf("interrupt delay constant %d DCO ticks: updated to %d in %s\n",
+             constant, measured, source);
+    } else {
+      fprintf(stderr, "interrupt delay constant is %d DCO ticks in %s, the code takes %d "
+              "(rebuild after running with -u)\n", constant, source, measured);
+      status = 1;
+    }
+  } else {
+    printf("interrupt delay constant: %d DCO ticks\n", measured);
+  }
+  return status;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \file
+ *         Decoder of the binary statistics records of glossy-test
+ *         (STATS_BINARY), to CSV.
+ *
+ *         Reads the serial output of a node from a file or from the
+ *         standard input, e.g.:
+ *
+ *           serialdump-linux -b115200 /dev/ttyUSB0 | glossy-stats > stats.csv
+ *
+ *         writes one CSV line per record to the standard output and
+ *         discards text and other frames.
+ *
+ *         Build with: cc -o glossy-stats glossy-stats.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+#define STATS_VERSION 2
+
+/* Fields after the header ('S', version, node id), in order. */
+static const struct {
+  const char *name;
+  int len;
+  int is_signed;
+} fields[] = {
+  { "seq_no", 4, 0 },
+  { "rx_cnt", 1, 0 },
+  { "latency_us", 4, 0 },
+  { "packets_received", 4, 0 },
+  { "packets_missed", 4, 0 },
+  { "avg_rel_milli_pct", 4, 0 },
+  { "avg_latency_us", 4, 0 },
+  { "avg_radio_on_us", 4, 0 },
+  { "avg_ntx_centi", 2, 0 },
+  { "avg_saved_us", 4, 0 },
+  { "avg_wakeup_centi_slots", 2, 0 },
+  { "period_skew", 2, 1 },
+  { "guard_us", 2, 0 },
+  { "lat_win_p50_us", 4, 0 },
+  { "lat_win_p90_us", 4, 0 },
+  { "lat_win_p99_us", 4, 0 },
+  { "lat_win_max_us", 4, 0 },
+  { "lat_all_p50_us", 4, 0 },
+  { "lat_all_p90_us", 4, 0 },
+  { "lat_all_p99_us", 4, 0 },
+  { "lat_all_max_us", 4, 0 },
+};
+#define N_FIELDS   (sizeof(fields) / sizeof(fields[0]))
+#define HEADER_LEN 4
+
+static unsigned long records, bad_records;
+
+/*---------------------------------------------------------------------------*/
+static void
+decode(const unsigned char *p, int len)
+{
+  unsigned sum = 0;
+  int i, j, pos, expected = HEADER_LEN + 2;
+
+  if(len < 1 || p[0] != 'S') {
+    /* another kind of frame (e.g., the Glossy event trace) */
+    return;
+  }
+  for(i = 0; i < N_FIELDS; i++) {
+    expected += fields[i].len;
+  }
+  for(i = 0; i < len - 2; i++) {
+    sum += p[i];
+  }
+  if(len != expected || p[1] != STATS_VERSION ||
+     (sum & 0xffff) != (unsigned)(p[len - 2] | (p[len - 1] << 8))) {
+    bad_records++;
+    return;
+  }
+  records++;
+  printf("%u", p[2] | (p[3] << 8));
+  pos = HEADER_LEN;
+  for(i = 0; i < N_FIELDS; i++) {
+    unsigned long v = 0;
+    for(j = fields[i].len - 1; j >= 0; j--) {
+      v = (v << 8) | p[pos + j];
+    }
+    pos += fields[i].len;
+    if(fields[i].is_signed && fields[i].len == 2) {
+      printf(",%d", (short)v);
+    } else {
+      printf(",%lu", v);
+    }
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  static unsigned char frame[2048];
+  int c, i, len = 0, in_frame = 0, esc = 0, overflow = 0;
+  FILE *in = stdin;
+
+  if(argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+    fprintf(stderr, "usage: %s [file]\n", argv[0]);
+    return 1;
+  }
+  if(argc == 2) {
+    in = fopen(argv[1], "rb");
+    if(in == NULL) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+
+  printf("node_id");
+  for(i = 0; i < N_FIELDS; i++) {
+    printf(",%s", fields[i].name);
+  }
+  printf("\n");
+
+  while((c = getc(in)) != EOF) {
+    if(!in_frame) {
+      if(c == SLIP_END) {
+        in_frame = 1;
+        len = 0;
+        overflow = 0;
+      }
+      continue;
+    }
+    if(c == SLIP_END) {
+      if(len == 0) {
+        /* two END in a row: the first one closed a frame we missed */
+        continue;
+      }
+      if(overflow) {
+        bad_records++;
+      } else {
+        decode(frame, len);
+      }
+      in_frame = 0;
+      continue;
+    }
+    if(esc) {
+      c = c == SLIP_ESC_END ? SLIP_END : c == SLIP_ESC_ESC ? SLIP_ESC : c;
+      esc = 0;
+    } else if(c == SLIP_ESC) {
+      esc = 1;
+      continue;
+    }
+    if(len < (int)sizeof(frame)) {
+      frame[len++] = c;
+    } else {
+      overflow = 1;
+    }
+  }
+  fflush(stdout);
+  fprintf(stderr, "%lu records, %lu corrupted\n", records, bad_records);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2011, ETH Zurich.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+
+/**
+ * \file
+ *         Decoder of the Glossy event trace (glossy_trace_dump()).
+ *
+ *         Reads the serial output of a node from a file or from the
+ *         standard input, e.g.:
+ *
+ *           serialdump-linux -b115200 /dev/ttyUSB0 | glossy-trace
+ *
+ *         copies text to the standard output and replaces each trace frame
+ *         (SLIP) with the timeline of the corresponding Glossy phase.
+ *
+ *         Build with: cc -o glossy-trace glossy-trace.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+#define TRACE_VERSION 1
+#define HEADER_LEN    6
+#define RECORD_LEN    6
+
+static const char *events[] = {
+  "?", "BEGIN_RX", "END_RX", "BEGIN_TX", "END_TX", "LATE_RX", "TIMER",
+  "RX_FIFOP"
+};
+static const char *states[] = {
+  "OFF", "WAITING", "RECEIVING", "RECEIVED", "TRANSMITTING",
+  "TRANSMITTED", "ABORTED"
+};
+
+static double f_dco = 4194304.0;
+static unsigned long frames, bad_frames;
+
+/*---------------------------------------------------------------------------*/
+static void
+decode(const unsigned char *p, int len)
+{
+  unsigned sum = 0, n, lost, id;
+  unsigned long t = 0;
+  unsigned t_last = 0;
+  int i;
+
+  if(len < HEADER_LEN + 2 || p[0] != 'T') {
+    bad_frames++;
+    return;
+  }
+  for(i = 0; i < len - 2; i++) {
+    sum += p[i];
+  }
+  n = p[4];
+  if(p[1] != TRACE_VERSION || len != HEADER_LEN + n * RECORD_LEN + 2 ||
+     (sum & 0xffff) != (unsigned)(p[len - 2] | (p[len - 1] << 8))) {
+    bad_frames++;
+    return;
+  }
+  frames++;
+  id = p[2] | (p[3] << 8);
+  lost = p[5];
+  printf("glossy trace, node %u: %u events%s", id, n, lost ? "" : "\n");
+  if(lost) {
+    printf(", %u%s earlier ones overwritten\n", lost, lost == 0xff ? "+" : "");
+  }
+  printf("   time [us]     delta  event     state         relay  T_irq  tbiv\n");
+  for(i = 0; i < n; i++) {
+    const unsigned char *r = &p[HEADER_LEN + i * RECORD_LEN];
+    unsigned ev = r[0] >> 4, st = r[0] & 0x0f;
+    unsigned t_cap = r[2] | (r[3] << 8);
+    unsigned delta = i ? (t_cap - t_last) & 0xffff : 0;
+
+    /* DCO ticks, 16-bit: consecutive events are less than 15 ms apart */
+    t += delta;
+    t_last = t_cap;
+    printf("%12.2f %9.2f  %-9s %-13s %5u %6u %5u\n",
+        t * 1e6 / f_dco, delta * 1e6 / f_dco,
+        ev < sizeof(events) / sizeof(events[0]) ? events[ev] : "?",
+        st < sizeof(states) / sizeof(states[0]) ? states[st] : "?",
+        r[1], r[4], r[5]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  static unsigned char frame[2048];
+  int c, len = 0, in_frame = 0, esc = 0, overflow = 0;
+  FILE *in = stdin;
+
+  while((c = getopt(argc, argv, "f:h")) != -1) {
+    switch(c) {
+    case 'f':
+      f_dco = atof(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-f dco_hz] [file]\n"
+          "  -f dco_hz  frequency of the DCO, in Hz (%.0f)\n", argv[0], f_dco);
+      return 1;
+    }
+  }
+  if(optind < argc) {
+    in = fopen(argv[optind], "rb");
+    if(in == NULL) {
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+
+  while((c = getc(in)) != EOF) {
+    if(!in_frame) {
+      if(c == SLIP_END) {
+        in_frame = 1;
+        len = 0;
+        overflow = 0;
+      } else {
+        putchar(c);
+      }
+      continue;
+    }
+    if(c == SLIP_END) {
+      if(len == 0) {
+        /* two END in a row: the first one closed a frame we missed */
+        continue;
+      }
+      if(overflow) {
+        bad_frames++;
+      } else {
+        decode(frame, len);
+      }
+      in_frame = 0;
+      continue;
+    }
+    if(esc) {
+      c = c == SLIP_ESC_END ? SLIP_END : c == SLIP_ESC_ESC ? SLIP_ESC : c;
+      esc = 0;
+    } else if(c == SLIP_ESC) {
+      esc = 1;
+      continue;
+    }
+    if(len < (int)sizeof(frame)) {
+      frame[len++] = c;
+    } else {
+      overflow = 1;
+    }
+  }
+  fflush(stdout);
+  fprintf(stderr, "%lu trace frames, %lu corrupted\n", frames, bad_frames);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/